@@ -0,0 +1,84 @@
+#include <angel/utils/permutation.hpp>
+#include <angel/utils/stopwatch.hpp>
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "experiments.hpp"
+
+/* applies perm as a chain of transpositions, one pass over the table each */
+void permute_by_swaps( kitty::dynamic_truth_table& tt, std::vector<uint32_t> const& perm )
+{
+  std::vector<uint32_t> var_at( perm.size() ), position( perm.size() );
+  std::iota( var_at.begin(), var_at.end(), 0u );
+  std::iota( position.begin(), position.end(), 0u );
+  for ( auto v = 0u; v < perm.size(); ++v )
+  {
+    auto const from = position[v];
+    auto const to = perm[v];
+    if ( from != to )
+    {
+      kitty::swap_inplace( tt, from, to );
+      std::swap( var_at[from], var_at[to] );
+      position[var_at[from]] = from;
+      position[var_at[to]] = to;
+    }
+  }
+}
+
+int main()
+{
+  constexpr uint32_t const min_num_variables = 6u;
+  constexpr uint32_t const max_num_variables = 20u;
+
+  experiments::experiment<uint32_t, uint32_t, double, double, double>
+  exp( "permutation_kernel", "variables", "permutations", "swap chain: time", "one pass: time", "speedup" );
+
+  std::mt19937 random_engine( 0xcafeaffe );
+  for ( auto num_vars = min_num_variables; num_vars <= max_num_variables; ++num_vars )
+  {
+    /* about 2^26 truth table bits per measurement */
+    uint32_t const num_permutations = std::max( 4u, 1u << ( 26u - std::min( num_vars, 24u ) ) );
+
+    kitty::dynamic_truth_table tt( num_vars );
+    kitty::create_random( tt, num_vars );
+
+    std::vector<std::vector<uint32_t>> perms( num_permutations, std::vector<uint32_t>( num_vars ) );
+    for ( auto& perm : perms )
+    {
+      std::iota( perm.begin(), perm.end(), 0u );
+      std::shuffle( perm.begin(), perm.end(), random_engine );
+    }
+
+    angel::stopwatch<>::duration_type time_swaps{0}, time_one_pass{0};
+    uint64_t checksum{0u};
+    for ( auto const& perm : perms )
+    {
+      /* both variants create a new truth table */
+      auto const swapped = angel::call_with_stopwatch( time_swaps, [&]() {
+        auto copy = tt;
+        permute_by_swaps( copy, perm );
+        return copy;
+      } );
+      auto const permuted = angel::call_with_stopwatch( time_one_pass, [&]() { return angel::permute_variables( tt, perm ); } );
+      if ( swapped != permuted )
+      {
+        fmt::print( "[e] permutations differ for {} variables\n", num_vars );
+        return 1;
+      }
+      checksum += kitty::count_ones( permuted );
+    }
+    (void)checksum;
+
+    exp( num_vars, num_permutations, angel::to_seconds( time_swaps ), angel::to_seconds( time_one_pass ),
+         angel::to_seconds( time_swaps ) / std::max( angel::to_seconds( time_one_pass ), 1e-9 ) );
+  }
+
+  exp.save();
+  exp.table();
+
+  return 0;
+}
@@ -3,10 +3,16 @@
 #include <angel/dependency_analysis/esop_based_dependency_analysis.hpp>
 #include <angel/dependency_analysis/no_deps.hpp>
 #include <angel/quantum_state_preparation/qsp_deps.hpp>
+#include <angel/quantum_state_preparation/qsp_deps_batch.hpp>
 #include <angel/quantum_state_preparation/qsp_bdd.hpp>
+#include <angel/reordering/annealing_reordering.hpp>
+#include <angel/reordering/dependency_guided_reordering.hpp>
+#include <angel/reordering/dp_reordering.hpp>
 #include <angel/reordering/exhaustive_reordering.hpp>
 #include <angel/reordering/greedy_reordering.hpp>
 #include <angel/reordering/no_reordering.hpp>
 #include <angel/reordering/random_reordering.hpp>
+#include <angel/reordering/sifting_reordering.hpp>
 #include <angel/utils/function_extractor.hpp>
+#include <angel/utils/parallel_for.hpp>
 #include <angel/utils/stopwatch.hpp>
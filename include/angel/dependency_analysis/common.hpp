@@ -56,6 +56,8 @@ struct dependency_analysis_types
     XNOR  = 4,
     AND   = 5,
     NAND  = 6,
+    /* any function of up to four fanins: the fanins followed by its truth table, see `pattern_catalog` */
+    LUT   = 7,
   };
 
   using fanins = std::vector<uint32_t>;
@@ -85,6 +87,8 @@ struct dependency_analysis_types
       return "AND";
     case pattern_kind::NAND:
       return "~AND";
+    case pattern_kind::LUT:
+      return "LUT";
     default:
       std::abort();
     }
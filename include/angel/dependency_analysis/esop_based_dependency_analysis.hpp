@@ -45,7 +45,12 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <map>
+#include <numeric>
+#include <string>
 #include <vector>
 
 namespace angel
@@ -69,6 +74,12 @@ struct esop_deps_analysis_stats
   {
     *this = {};
   }
+
+  void merge( esop_deps_analysis_stats const& other )
+  {
+    total_time += other.total_time;
+    num_patterns += other.num_patterns;
+  }
 };
 
 struct esop_deps_analysis_result_type
@@ -120,19 +131,23 @@ public:
 
     /* create column vectors */
     uint32_t const num_vars = function.num_vars();
+    auto const minterms = kitty::get_minterms( function );
     std::vector<dependency_analysis_types::column> columns{num_vars};
     for ( auto i = 0u; i < columns.size(); ++i )
     {
       columns[i].index = i;
+      columns[i].tt.resize( minterms.size() );
     }
 
-    kitty::dynamic_truth_table minterm{function.num_vars()};
-    for ( auto const& m : kitty::get_minterms( function ) )
+    /* bits are set by index; partial_truth_table::add_bit shifts an int and corrupts the columns from the 32nd minterm on */
+    for ( auto j = 0u; j < minterms.size(); ++j )
     {
-      minterm._bits[0] = m;
-      for ( auto i = 0; i < minterm.num_vars(); ++i )
+      for ( auto i = 0u; i < num_vars; ++i )
       {
-        columns[i].tt.add_bit( kitty::get_bit( minterm, i ) );
+        if ( ( minterms[j] >> i ) & 1u )
+        {
+          kitty::set_bit( columns[i].tt, j );
+        }
       }
     }
 
@@ -145,6 +160,7 @@ public:
 
     /* collect divisors */
     std::vector<dependency_analysis_types::column> columns_copy;
+    minterm_partition partition;
     for ( auto i = 0u; i < columns.size(); ++i )
     {
       /* copy the original columns */
@@ -203,13 +219,15 @@ public:
       {
         current_entropy = 0u;
         indices.clear();
+        partition.reset( target.tt );
 
         for ( auto k = j; k < columns_copy.size() && !found; ++k )
         {
           indices.push_back( columns_copy[k].index );
           current_entropy += columns_copy[k].entropy;
+          partition.refine( target.tt, columns_copy[k].tt );
 
-          if ( current_entropy >= target.entropy )
+          if ( current_entropy >= target.entropy && partition.is_covered() )
           {
             auto const pattern = on_candidate( columns, target.index, indices );
             if ( pattern )
@@ -237,60 +255,125 @@ private:
       functions.push_back( columns[i].tt );
     }
 
-    if ( is_covered_with_divisors( columns[target_index].tt, functions ) )
+    auto const result = easy::compute_exact_esop_cover_from_divisors( columns[target_index].tt, functions );
+    if ( result.esop_cover )
     {
-      auto const result = easy::compute_exact_esop_cover_from_divisors( columns[target_index].tt, functions );
-      if ( result.esop_cover )
+      /* re-encode ESOP cover */
+      std::vector<std::vector<uint32_t>> esop_cover;
+      std::vector<uint32_t> new_cube;
+      for ( auto const& cube : *result.esop_cover )
       {
-        /* re-encode ESOP cover */
-        std::vector<std::vector<uint32_t>> esop_cover;
-        std::vector<uint32_t> new_cube;
-        for ( auto const& cube : *result.esop_cover )
+        new_cube.clear();
+        for ( auto i = 0u; i < divisor_indices.size(); ++i )
         {
-          new_cube.clear();
-          for ( auto i = 0u; i < divisor_indices.size(); ++i )
+          if ( cube.get_mask( i ) )
           {
-            if ( cube.get_mask( i ) )
-            {
-              new_cube.push_back( cube.get_bit( i ) ? 2u * divisor_indices[i] : 2u * divisor_indices[i] + 1 );
-            }
+            new_cube.push_back( cube.get_bit( i ) ? 2u * divisor_indices[i] : 2u * divisor_indices[i] + 1 );
           }
-          esop_cover.push_back( new_cube );
         }
-        return esop_cover;
+        esop_cover.push_back( new_cube );
       }
+      return esop_cover;
     }
     return std::nullopt;
   }
 
-  bool is_covered_with_divisors( kitty::partial_truth_table const& target, std::vector<kitty::partial_truth_table> const& divisors ) const
+  /*! \brief Partition of the minterms by their values in the divisors appended so far.
+   *
+   * The target is a function of the divisors (and an ESOP cover of it
+   * exists) if and only if all minterms in a class have the same target
+   * value.  Appending a divisor splits every class in two, which is one pass
+   * over the minterms instead of comparing all pairs of minterms.  Only the
+   * minterms of classes with both target values are kept, since the other
+   * classes can no longer become mixed.
+   */
+  class minterm_partition
   {
-    /* iterate over all bit pairs of target */
-    for ( uint32_t i = 0u; i < uint32_t( target.num_bits() ); ++i )
+  public:
+    /* all minterms in one class */
+    void reset( kitty::partial_truth_table const& target )
+    {
+      rows.resize( target.num_bits() );
+      std::iota( rows.begin(), rows.end(), 0u );
+      row_class.assign( target.num_bits(), 0u );
+      num_classes = 1u;
+    }
+
+    /* splits every mixed class by the values of its minterms in `divisor` */
+    void refine( kitty::partial_truth_table const& target, kitty::partial_truth_table const& divisor )
     {
-      for ( uint32_t j = i + 1u; j < uint32_t( target.num_bits() ); ++j )
+      if ( rows.empty() )
+        return;
+
+      /* new class of ( class, divisor value ) and its target value, or `mixed` */
+      split.assign( 2u * num_classes, none );
+      values.clear();
+      for ( auto const& r : rows )
       {
-        if ( get_bit( target, i ) != get_bit( target, j ) )
+        auto& c = split[2u * row_class[r] + ( kitty::get_bit( divisor, r ) ? 1u : 0u )];
+        uint8_t const value = kitty::get_bit( target, r ) ? 1u : 0u;
+        if ( c == none )
         {
-          /* check if this bit pair is distinguished by a divisor */
-          bool found = false;
-          for ( const auto& d : divisors )
-          {
-            if ( get_bit( d, i ) != get_bit( d, j ) )
-            {
-              found = true;
-              break;
-            }
-          }
-
-          if ( !found )
-          {
-            return false;
-          }
+          c = static_cast<uint32_t>( values.size() );
+          values.push_back( value );
         }
+        else if ( values[c] != value )
+        {
+          values[c] = mixed;
+        }
+        row_class[r] = c;
       }
+
+      /* keep the minterms of mixed classes, renumbered from 0 */
+      split.assign( values.size(), none );
+      num_classes = 0u;
+      auto const end = std::remove_if( rows.begin(), rows.end(), [&]( auto const& r ) {
+        if ( values[row_class[r]] != mixed )
+          return true;
+        auto& c = split[row_class[r]];
+        if ( c == none )
+          c = num_classes++;
+        row_class[r] = c;
+        return false;
+      } );
+      rows.erase( end, rows.end() );
+    }
+
+    /* whether the target is a function of the divisors */
+    bool is_covered() const
+    {
+      return rows.empty();
     }
-    return true;
+
+  private:
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+    static constexpr uint8_t mixed = 2u;
+
+    /* minterms in mixed classes and the class of every minterm */
+    std::vector<uint32_t> rows;
+    std::vector<uint32_t> row_class;
+    uint32_t num_classes{0u};
+
+    std::vector<uint32_t> split;
+    std::vector<uint8_t> values;
+  };
+
+public:
+  /*! \brief Parameters of this analysis, e.g., to construct another instance with the same configuration. */
+  esop_deps_analysis_params const& parameters() const
+  {
+    return ps;
+  }
+
+  /*! \brief Parameters that affect the found dependencies, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return {};
+  }
+
+  esop_deps_analysis_stats& statistics() const
+  {
+    return st;
   }
 
 private:
@@ -0,0 +1,184 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file linear_dependencies.hpp
+
+  \brief XOR dependencies of any arity by Gaussian elimination over GF(2)
+*/
+
+#pragma once
+
+#include "common.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Finds the cheapest XOR, XNOR, or EQUAL dependency of every column over the columns above it.
+ *
+ * A column is an XOR (XNOR) of other columns if it is a linear combination
+ * of them (and of the all-ones column) over GF(2).  The columns are
+ * inserted from the last one down into an echelon basis, which records for
+ * every basis row the combination of columns it represents.  A column that
+ * reduces to zero is a linear combination of the columns above it; all its
+ * combinations differ by the relations found among those columns before
+ * (the kernel), and the cheapest one under `cost` is selected.  Up to
+ * `max_kernel_size` relations are combined exhaustively, beyond that
+ * relations are added greedily while they reduce the cost.
+ *
+ * `columns` holds `num_vars` columns of `num_words` words each, only the
+ * bits in `last_mask` of the last word of a column are used.  Returns for
+ * every column the selected pattern, with literals as in
+ * `pattern_deps_analysis`, or `std::nullopt`.  Needs `cost( pattern )` to
+ * return a totally ordered value, e.g., a pair of CNOT and NOT gates.
+ */
+template<typename Cost>
+std::vector<std::optional<dependency_analysis_types::pattern>> linear_dependencies( std::vector<uint64_t> const& columns, uint32_t num_vars, uint32_t num_words,
+                                                                                   uint64_t last_mask, Cost&& cost, uint32_t max_kernel_size = 10u )
+{
+  assert( num_vars < 64u );
+  std::vector<std::optional<dependency_analysis_types::pattern>> result( num_vars );
+  if ( num_words == 0u || last_mask == 0u )
+    return result;
+
+  /* bit v of a combination is column v, bit num_vars is the all-ones column */
+  uint64_t const ones = uint64_t( 1u ) << num_vars;
+  auto const mask = [&]( uint32_t w ) { return w + 1u == num_words ? last_mask : ~uint64_t( 0u ); };
+
+  /* basis rows in insertion order, each with its pivot bit and combination */
+  std::vector<uint64_t> rows;
+  std::vector<uint32_t> pivots;
+  std::vector<uint64_t> combinations;
+  std::vector<uint64_t> kernel;
+
+  std::vector<uint64_t> row( num_words );
+  /* reduces row by the basis, returns its combination or inserts it */
+  auto const insert = [&]( uint64_t combination ) -> std::optional<uint64_t> {
+    for ( auto r = 0u; r < pivots.size(); ++r )
+    {
+      if ( ( row[pivots[r] / 64u] >> ( pivots[r] % 64u ) ) & 1u )
+      {
+        for ( auto w = 0u; w < num_words; ++w )
+          row[w] ^= rows[r * num_words + w];
+        combination ^= combinations[r];
+      }
+    }
+    for ( auto w = 0u; w < num_words; ++w )
+    {
+      if ( row[w] )
+      {
+        pivots.emplace_back( w * 64u + __builtin_ctzll( row[w] ) );
+        combinations.emplace_back( combination );
+        rows.insert( rows.end(), row.begin(), row.end() );
+        return std::nullopt;
+      }
+    }
+    return combination;
+  };
+
+  auto const to_pattern = [&]( uint64_t combination ) {
+    std::vector<uint32_t> fanins;
+    for ( auto v = 0u; v < num_vars; ++v )
+    {
+      if ( ( combination >> v ) & 1u )
+        fanins.emplace_back( 2u * v );
+    }
+    bool const complemented = ( combination & ones ) != 0u;
+    if ( fanins.size() == 1u )
+    {
+      return dependency_analysis_types::pattern{dependency_analysis_types::pattern_kind::EQUAL, {fanins[0] + ( complemented ? 1u : 0u )}};
+    }
+    return dependency_analysis_types::pattern{complemented ? dependency_analysis_types::pattern_kind::XNOR : dependency_analysis_types::pattern_kind::XOR, fanins};
+  };
+
+  for ( auto w = 0u; w < num_words; ++w )
+    row[w] = mask( w );
+  insert( ones );
+
+  for ( auto i = num_vars; i-- > 0u; )
+  {
+    for ( auto w = 0u; w < num_words; ++w )
+      row[w] = columns[i * num_words + w] & mask( w );
+
+    auto const relation = insert( uint64_t( 1u ) << i );
+    if ( !relation )
+      continue;
+
+    /* columns above i whose combination is column i */
+    auto best = *relation ^ ( uint64_t( 1u ) << i );
+    kernel.emplace_back( *relation );
+    if ( ( best & ( ones - 1u ) ) == 0u )
+      continue; /* column i is constant */
+
+    auto const cost_of = [&]( uint64_t combination ) { return cost( to_pattern( combination ) ); };
+    auto best_cost = cost_of( best );
+    auto const num_relations = static_cast<uint32_t>( kernel.size() ) - 1u;
+    if ( num_relations <= max_kernel_size )
+    {
+      /* all combinations of the relations, in Gray code order */
+      auto combination = best;
+      for ( uint64_t g = 1u; g < ( uint64_t( 1u ) << num_relations ); ++g )
+      {
+        combination ^= kernel[__builtin_ctzll( g )];
+        if ( ( combination & ( ones - 1u ) ) == 0u )
+          continue;
+        if ( auto const c = cost_of( combination ); c < best_cost )
+        {
+          best = combination;
+          best_cost = c;
+        }
+      }
+    }
+    else
+    {
+      for ( auto improved = true; improved; )
+      {
+        improved = false;
+        for ( auto r = 0u; r < num_relations; ++r )
+        {
+          auto const combination = best ^ kernel[r];
+          if ( ( combination & ( ones - 1u ) ) == 0u )
+            continue;
+          if ( auto const c = cost_of( combination ); c < best_cost )
+          {
+            best = combination;
+            best_cost = c;
+            improved = true;
+          }
+        }
+      }
+    }
+    result[i] = to_pattern( best );
+  }
+
+  return result;
+}
+
+} /* namespace angel */
@@ -1,6 +1,7 @@
 #include <map>
 #include <fmt/format.h>
 #include <iostream>
+#include <string>
 
 namespace angel
 {
@@ -21,6 +22,11 @@ struct no_deps_analysis_stats
   {
     *this = {};
   }
+
+  void merge( no_deps_analysis_stats const& other )
+  {
+    total_time += other.total_time;
+  }
 };
 
 struct no_deps_analysis_result_type
@@ -54,6 +60,23 @@ public:
     return no_deps_analysis_result_type{};
   }
 
+  /*! \brief Parameters of this analysis, e.g., to construct another instance with the same configuration. */
+  no_deps_analysis_params const& parameters() const
+  {
+    return ps;
+  }
+
+  /*! \brief Parameters that affect the found dependencies, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return {};
+  }
+
+  no_deps_analysis_stats& statistics() const
+  {
+    return st;
+  }
+
 private:
   no_deps_analysis_params const& ps;
   no_deps_analysis_stats& st;
@@ -35,11 +35,21 @@
 #pragma once
 
 #include "common.hpp"
+#include "linear_dependencies.hpp"
+#include "pattern_catalog.hpp"
 
+#include "../utils/onset_columns.hpp"
 #include "../utils/stopwatch.hpp"
 
 #include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <map>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace angel
 {
@@ -51,6 +61,19 @@ struct pattern_deps_analysis_params
   /* A value between 1u and 5u */
   uint32_t max_pattern_size{5};
 
+  /* find XOR/XNOR/EQUAL patterns of any size by Gaussian elimination (see
+     `linear_dependencies`) instead of in the tuple search, which then only
+     looks for AND/NAND patterns */
+  bool use_linear_dependencies{false};
+
+  /* number of relations among the fanins that are combined exhaustively to
+     find the cheapest linear pattern */
+  uint32_t max_kernel_size{10u};
+
+  /* match tuples of up to four fanins against `pattern_catalog`, which also
+     finds LUT patterns, i.e., any other function of the fanins */
+  bool use_pattern_catalog{false};
+
   /* Be verbose. */
   bool verbose = true;
 }; /* dependency_analysis_params */
@@ -63,6 +86,7 @@ struct pattern_deps_analysis_stats
   stopwatch<>::duration_type pattern3_time{0};
   stopwatch<>::duration_type pattern4_time{0};
   stopwatch<>::duration_type pattern5_time{0};
+  stopwatch<>::duration_type linear_time{0};
 
   /* number of patterns analysed by the algorithm */
   uint32_t num_analysed_patterns{0};
@@ -77,6 +101,9 @@ struct pattern_deps_analysis_stats
   uint32_t num_4tuples{0};
   uint32_t num_5tuples{0};
 
+  /* patterns found by Gaussian elimination */
+  uint32_t num_linear_patterns{0};
+
   void report() const
   {
     fmt::print( "[i] total analysis time =        {:8.2f}s\n", to_seconds( total_time ) );
@@ -85,6 +112,7 @@ struct pattern_deps_analysis_stats
     fmt::print( "[i]   patterns from triples =    {:8.2f}s\n", to_seconds( pattern3_time ) );
     fmt::print( "[i]   patterns from 4-tuples =   {:8.2f}s\n", to_seconds( pattern4_time ) );
     fmt::print( "[i]   patterns from 5-tuples =   {:8.2f}s\n", to_seconds( pattern5_time ) );
+    fmt::print( "[i]   linear patterns =          {:8.2f}s ({} patterns)\n", to_seconds( linear_time ), num_linear_patterns );
     fmt::print( "[i] computed patterns: {:8d} / {:8d}\n", num_patterns, num_analysed_patterns );
     fmt::print( "[i] iterations: {} singletons + {} pairs + {} triples + {} 4-tuples + {} 5-tuples\n",
                 num_singletons, num_2tuples, num_3tuples, num_4tuples, num_5tuples );
@@ -94,6 +122,26 @@ struct pattern_deps_analysis_stats
   {
     *this = {};
   }
+
+  void merge( pattern_deps_analysis_stats const& other )
+  {
+    total_time += other.total_time;
+    pattern1_time += other.pattern1_time;
+    pattern2_time += other.pattern2_time;
+    pattern3_time += other.pattern3_time;
+    pattern4_time += other.pattern4_time;
+    pattern5_time += other.pattern5_time;
+    linear_time += other.linear_time;
+    num_analysed_patterns += other.num_analysed_patterns;
+    num_patterns += other.num_patterns;
+    num_constants += other.num_constants;
+    num_singletons += other.num_singletons;
+    num_2tuples += other.num_2tuples;
+    num_3tuples += other.num_3tuples;
+    num_4tuples += other.num_4tuples;
+    num_5tuples += other.num_5tuples;
+    num_linear_patterns += other.num_linear_patterns;
+  }
 }; /* dependency_analysis_stats */
 
 struct pattern_deps_analysis_result_type
@@ -129,33 +177,52 @@ public:
   {
   }
 
+  /*! \brief Finds the cheapest pattern of every variable over the variables above it.
+   *
+   * The fanin tuples of a target are enumerated in lexicographic order by a
+   * depth-first search that carries the XOR and the ANDs (one per polarity)
+   * of the current tuple, such that every larger tuple costs one word-wise
+   * operation per accumulator.  AND prefixes that no longer cover the target
+   * or its complement are not extended, since further fanins only remove
+   * minterms.  Columns are compared as packed 64-bit words.  Constants and
+   * EQUAL patterns are read off the classes of equal or complemented columns,
+   * which `classify_columns` finds in one hashed pass over all columns.
+   *
+   * With `use_linear_dependencies`, XOR, XNOR, and EQUAL patterns of any
+   * size are found by `linear_dependencies` first, and the tuple search only
+   * looks for AND and NAND patterns.
+   *
+   * With `use_pattern_catalog`, the target is projected onto every tuple of
+   * up to four fanins instead: the ANDs of all polarities of the tuple give
+   * the values of the fanins in every minterm, hence the (partial) function
+   * of the fanins that the target must be, if any.  Its cheapest completion
+   * is looked up in `pattern_catalog` and becomes a pattern if it depends on
+   * all fanins of the tuple.
+   */
   pattern_deps_analysis_result_type run( function_type const& function )
   {
     stopwatch t( st.total_time );
 
-    /* create column vectors */
-    uint32_t const num_vars = function.num_vars();
-    std::vector<dependency_analysis_types::column> columns{num_vars};
-    for ( auto i = 0u; i < columns.size(); ++i )
-    {
-      columns[i].index = i;
-    }
+    /* create column vectors of the onset minterms */
+    num_vars = function.num_vars();
+    num_words = pack_onset_columns( function, column_words, last_mask );
+
+    /* EQUAL patterns and constants: equal or complemented columns are found by hashing */
+    classes = call_with_stopwatch( st.pattern1_time, [&]() {
+      return classify_columns( column_words, num_vars, num_words, last_mask );
+    } );
+    xor_words.assign( ( max_tuple_size + 1u ) * num_words, 0u );
+    and_words.assign( ( 2u << max_tuple_size ) * num_words, 0u );
 
-    kitty::dynamic_truth_table minterm{function.num_vars()};
-    for ( auto const& m : kitty::get_minterms( function ) )
+    /* XOR/XNOR/EQUAL patterns of any size */
+    std::vector<std::optional<dependency_analysis_types::pattern>> linear;
+    if ( ps.use_linear_dependencies )
     {
-      minterm._bits[0] = m;
-      for ( auto i = 0; i < minterm.num_vars(); ++i )
-      {
-        columns[i].tt.add_bit( kitty::get_bit( minterm, i ) );
-      }
+      linear = call_with_stopwatch( st.linear_time, [&]() {
+        return linear_dependencies( column_words, num_vars, num_words, last_mask, [&]( auto const& p ) { return cost( p ); }, ps.max_kernel_size );
+      } );
     }
 
-    // for ( const auto& c : columns )
-    // {
-    //   kitty::print_binary( c.tt ); std::cout << std::endl;
-    // }
-
     pattern_deps_analysis_result_type result;
     for ( auto i = 0u; i < num_vars; ++i )
     {
@@ -163,81 +230,30 @@ public:
       patterns.clear();
 
       /* skip constants */
-      if ( kitty::is_const0( columns[i].tt ) )
+      if ( classes.constant[i] )
       {
-        result.dependencies[i] = std::make_pair( dependency_analysis_types::pattern_kind::CONST, std::vector<uint32_t>{ 0 } );
+        result.dependencies[i] = std::make_pair( dependency_analysis_types::pattern_kind::CONST, std::vector<uint32_t>{ classes.polarity[i] } );
         continue;
       }
-      else if ( kitty::is_const0( ~columns[i].tt ) )
+
+      if ( ps.use_linear_dependencies && linear[i] )
       {
-        result.dependencies[i] = std::make_pair( dependency_analysis_types::pattern_kind::CONST, std::vector<uint32_t>{ 1 } );
-        continue;
+        patterns.emplace_back( *linear[i] );
+        ++st.num_linear_patterns;
       }
 
-      bool success = false;
-      for ( auto j = i + 1u; j < num_vars; ++j )
+      if ( !ps.select_first || patterns.empty() )
       {
-        ++st.num_singletons;
-        success = call_with_stopwatch( st.pattern1_time, [&]() {
-          return check_unary_patterns( columns, i, j );
-        } );
-        if ( ps.select_first && success )
-          goto evaluate;
-
-        if ( ps.max_pattern_size < 2u )
-          continue;
-
-        for ( auto k = j + 1u; k < num_vars; ++k )
-        {
-          ++st.num_2tuples;
-          success = call_with_stopwatch( st.pattern2_time, [&]() {
-            return check_nary_patterns( columns, i, {j, k} );
-          } );
-          if ( ps.select_first && success )
-            goto evaluate;
-
-          if ( ps.max_pattern_size < 3u )
-            continue;
-
-          for ( auto l = k + 1u; l < num_vars; ++l )
-          {
-            ++st.num_3tuples;
-            success = call_with_stopwatch( st.pattern3_time, [&]() {
-              return check_nary_patterns( columns, i, {j, k, l} );
-            } );
-            if ( ps.select_first && success )
-              goto evaluate;
-
-            if ( ps.max_pattern_size < 4u )
-              continue;
-
-            for ( auto m = l + 1u; m < num_vars; ++m )
-            {
-              ++st.num_4tuples;
-              success = call_with_stopwatch( st.pattern4_time, [&]() {
-                return check_nary_patterns( columns, i, {j, k, l, m} );
-              } );
-              if ( ps.select_first && success )
-                goto evaluate;
-
-              if ( ps.max_pattern_size < 5u )
-                continue;
-
-              for ( auto n = m + 1u; n < num_vars; ++n )
-              {
-                ++st.num_5tuples;
-                success = call_with_stopwatch( st.pattern5_time, [&]() {
-                  return check_nary_patterns( columns, i, {j, k, l, m, n} );
-                } );
-                if ( ps.select_first && success )
-                  goto evaluate;
-              }
-            }
-          }
-        }
+        /* time spent in the tuples of each size, including their extensions */
+        std::array<stopwatch<>::duration_type, max_tuple_size + 2u> time{};
+        extend( i, 0u, i + 1u, time );
+        st.pattern1_time += time[1] - time[2];
+        st.pattern2_time += time[2] - time[3];
+        st.pattern3_time += time[3] - time[4];
+        st.pattern4_time += time[4] - time[5];
+        st.pattern5_time += time[5];
       }
 
-    evaluate:
       /* evaluate patterns */
       std::sort( std::begin( patterns ), std::end( patterns ),
                  [&]( const auto& a, const auto& b ) {
@@ -283,15 +299,7 @@ public:
                      return false;
                    }
 
-                   for ( auto i = 0u; i < a.second.size(); ++i )
-                   {
-                     if ( a.second[i] < b.second[i] )
-                     {
-                       return true;
-                     }
-                   }
-
-                   return false;
+                   return a.second < b.second;
                  } );
 
       // for ( const auto& p : patterns )
@@ -351,109 +359,279 @@ private:
       }
       return {( 1u << n ), polarity_counter + ( 1u << n )};
     }
+    case dependency_analysis_types::pattern_kind::LUT:
+    {
+      return pattern_catalog::get( p.second.size() - 1u ).cost( p.second.back() );
+    }
     default:
       std::abort();
     }
   }
 
-  bool check_unary_patterns( std::vector<dependency_analysis_types::column> const& columns, uint32_t target_index, uint32_t other_index )
+  static constexpr uint32_t max_tuple_size = 5u;
+
+  uint64_t const* column( uint32_t index ) const
   {
-    bool found = false;
-    if ( columns[target_index].tt == columns[other_index].tt )
+    return &column_words[index * num_words];
+  }
+
+  struct comparison
+  {
+    /* target == words, target == ~words */
+    bool equal;
+    bool complement;
+    /* target <= words, ~target <= words */
+    bool covers;
+    bool covers_complement;
+  };
+
+  /* compares the target with `words` (all zeros if `nullptr`) on the onset minterms */
+  comparison compare( uint64_t const* target, uint64_t const* words ) const
+  {
+    uint64_t target_outside{0u}, complement_outside{0u}, target_inside{0u}, complement_inside{0u};
+    for ( auto w = 0u; w < num_words; ++w )
     {
-      patterns.emplace_back( dependency_analysis_types::pattern_kind::EQUAL, std::vector<uint32_t>{2u * other_index} );
-      found = true;
+      auto const mask = w + 1u == num_words ? last_mask : ~uint64_t( 0u );
+      auto const x = words ? words[w] : uint64_t( 0u );
+      target_outside |= target[w] & ~x & mask;
+      complement_outside |= ~target[w] & ~x & mask;
+      target_inside |= target[w] & x & mask;
+      complement_inside |= ~target[w] & x & mask;
     }
-    else if ( columns[target_index].tt == ~columns[other_index].tt )
+    return {target_outside == 0u && complement_inside == 0u, target_inside == 0u && complement_outside == 0u,
+            target_outside == 0u, complement_outside == 0u};
+  }
+
+  /* fanins of the current tuple, with complement flags from `polarity` */
+  std::vector<uint32_t> fanins( uint32_t size, uint32_t polarity = 0u ) const
+  {
+    std::vector<uint32_t> result( size );
+    for ( auto f = 0u; f < size; ++f )
     {
-      patterns.emplace_back( dependency_analysis_types::pattern_kind::EQUAL, std::vector<uint32_t>{2u * other_index + 1u} );
-      found = true;
+      result[f] = 2u * tuple[f] + ( ( polarity >> f ) & 1u );
     }
-    return found;
+    return result;
   }
 
-  bool check_nary_patterns( std::vector<dependency_analysis_types::column> const& columns, uint32_t target_index, std::vector<uint32_t> const& other_indices )
+  /* visits the tuples that extend the first `depth` fanins by one column from `start` on; returns whether to stop */
+  bool extend( uint32_t target, uint32_t depth, uint32_t start, std::array<stopwatch<>::duration_type, max_tuple_size + 2u>& time )
   {
-    bool found = false;
+    uint32_t const size = depth + 1u;
+    uint32_t* const counters[] = {&st.num_singletons, &st.num_2tuples, &st.num_3tuples, &st.num_4tuples, &st.num_5tuples};
 
-    /* xor */
-    if ( columns[target_index].tt == nary_xor( columns, other_indices ) )
+    stopwatch t( time[size] );
+    for ( auto x = start; x < num_vars; ++x )
     {
-      std::vector<uint32_t> fanins( other_indices.size() );
-      for ( auto i = 0u; i < other_indices.size(); ++i )
+      ++*counters[depth];
+      tuple[depth] = x;
+
+      bool success = false;
+      if ( size == 1u )
+      {
+        success = check_unary_patterns( target, x );
+      }
+      else
+      {
+        success = check_nary_patterns( target, size );
+      }
+      if ( ps.select_first && success )
+        return true;
+
+      if ( size < std::min( ps.max_pattern_size, max_tuple_size ) && extend( target, size, x + 1u, time ) )
+        return true;
+    }
+    return false;
+  }
+
+  /* EQUAL patterns of the column of the first fanin, initializes the accumulators of the tuples of size 1 */
+  bool check_unary_patterns( uint32_t target_index, uint32_t other_index )
+  {
+    /* accumulators are only needed if the tuple is extended */
+    if ( std::min( ps.max_pattern_size, max_tuple_size ) > 1u )
+    {
+      auto const* other = column( other_index );
+      auto* xor_acc = &xor_words[num_words];
+      auto* and_positive = &and_words[2u * num_words];
+      auto* and_negative = &and_words[3u * num_words];
+      for ( auto w = 0u; w < num_words; ++w )
+      {
+        xor_acc[w] = other[w];
+        and_positive[w] = other[w];
+        and_negative[w] = ~other[w];
+      }
+
+      if ( ps.use_pattern_catalog )
+      {
+        /* projections only need the ANDs that are not empty */
+        viable[2u] = !classes.constant[other_index] || classes.polarity[other_index];
+        viable[3u] = !classes.constant[other_index] || !classes.polarity[other_index];
+      }
+      else
       {
-        fanins[i] = 2u * other_indices[i];
+        auto const target = column( target_index );
+        auto const c = compare( target, other );
+        auto const c_negative = compare( target, and_negative );
+        viable[2u] = c.covers || c.covers_complement;
+        viable[3u] = c_negative.covers || c_negative.covers_complement;
       }
-      patterns.emplace_back( dependency_analysis_types::pattern_kind::XOR, fanins );
-      found = true;
     }
-    if ( ~columns[target_index].tt == nary_xor( columns, other_indices ) )
+
+    /* both columns are in the same class of `classify_columns` */
+    if ( ps.use_linear_dependencies || classes.representative[target_index] != classes.representative[other_index] )
+    {
+      return false;
+    }
+    patterns.emplace_back( dependency_analysis_types::pattern_kind::EQUAL, std::vector<uint32_t>{2u * other_index + ( classes.polarity[target_index] ^ classes.polarity[other_index] )} );
+    return true;
+  }
+
+  /* XOR/XNOR and AND/NAND patterns of the current tuple, extends the accumulators of its prefix by its last fanin */
+  bool check_nary_patterns( uint32_t target_index, uint32_t size )
+  {
+    if ( ps.use_pattern_catalog && size <= pattern_catalog::max_num_fanins )
+    {
+      return check_catalog_patterns( target_index, size );
+    }
+
+    bool found = false;
+    auto const target = column( target_index );
+    auto const* last = column( tuple[size - 1u] );
+
+    /* xor, unless found by `linear_dependencies` */
+    if ( !ps.use_linear_dependencies )
     {
-      std::vector<uint32_t> fanins( other_indices.size() );
-      for ( auto i = 0u; i < other_indices.size(); ++i )
+      auto const* prefix_xor = &xor_words[( size - 1u ) * num_words];
+      auto* xor_acc = &xor_words[size * num_words];
+      for ( auto w = 0u; w < num_words; ++w )
+      {
+        xor_acc[w] = prefix_xor[w] ^ last[w];
+      }
+      auto const x = compare( target, xor_acc );
+      if ( x.equal )
+      {
+        patterns.emplace_back( dependency_analysis_types::pattern_kind::XOR, fanins( size ) );
+        found = true;
+      }
+      if ( x.complement )
       {
-        fanins[i] = 2u * other_indices[i];
+        patterns.emplace_back( dependency_analysis_types::pattern_kind::XNOR, fanins( size ) );
+        found = true;
       }
-      patterns.emplace_back( dependency_analysis_types::pattern_kind::XNOR, fanins );
-      found = true;
     }
 
-    /* and */
-    for ( uint32_t polarity = 0u; polarity < ( 1u << other_indices.size() ); ++polarity )
+    /* and, polarity bit f complements fanin f; node ( 1 << size ) + polarity */
+    uint32_t const last_bit = 1u << ( size - 1u );
+    for ( uint32_t polarity = 0u; polarity < ( 1u << size ); ++polarity )
     {
-      /* convert polarity to complement flags */
-      std::vector<bool> complement;
-      auto copy_polarity = polarity;
-      for ( auto i = 0u; i < other_indices.size(); ++i )
+      auto const node = ( 1u << size ) + polarity;
+      auto const prefix = ( 1u << ( size - 1u ) ) + ( polarity & ( last_bit - 1u ) );
+      viable[node] = false;
+      if ( !viable[prefix] )
+        continue;
+
+      auto const* prefix_and = &and_words[prefix * num_words];
+      auto* and_acc = &and_words[node * num_words];
+      auto const complement = ( polarity & last_bit ) ? ~uint64_t( 0u ) : uint64_t( 0u );
+      for ( auto w = 0u; w < num_words; ++w )
       {
-        complement.push_back( ( copy_polarity & 1u ) );
-        copy_polarity >>= 1u;
+        and_acc[w] = prefix_and[w] & ( last[w] ^ complement );
       }
 
-      if ( columns[target_index].tt == nary_and( columns, other_indices, complement ) )
+      auto const a = compare( target, and_acc );
+      viable[node] = a.covers || a.covers_complement;
+      if ( a.equal )
       {
-        std::vector<uint32_t> fanins( other_indices.size() );
-        for ( auto i = 0u; i < other_indices.size(); ++i )
-        {
-          fanins[i] = 2u * other_indices[i] + complement[i];
-        }
-        patterns.emplace_back( dependency_analysis_types::pattern_kind::AND, fanins );
+        patterns.emplace_back( dependency_analysis_types::pattern_kind::AND, fanins( size, polarity ) );
         found = true;
       }
-      if ( columns[target_index].tt == ~nary_and( columns, other_indices, complement ) )
+      if ( a.complement )
       {
-        std::vector<uint32_t> fanins( other_indices.size() );
-        for ( auto i = 0u; i < other_indices.size(); ++i )
-        {
-          fanins[i] = 2u * other_indices[i] + complement[i];
-        }
-        patterns.emplace_back( dependency_analysis_types::pattern_kind::NAND, fanins );
+        patterns.emplace_back( dependency_analysis_types::pattern_kind::NAND, fanins( size, polarity ) );
         found = true;
       }
     }
     return found;
   }
 
-  kitty::partial_truth_table nary_and( std::vector<dependency_analysis_types::column> const& columns, std::vector<uint32_t> const& other_indices, std::vector<bool> const& complement )
+  /* cheapest pattern of the catalog that agrees with the projection of the target onto the current tuple */
+  bool check_catalog_patterns( uint32_t target_index, uint32_t size )
   {
-    /* compute nary and */
-    auto result = complement[0u] ? ~columns[other_indices[0u]].tt : columns[other_indices[0u]].tt;
-    for ( auto i = 1u; i < other_indices.size(); ++i )
+    auto const target = column( target_index );
+    auto const* last = column( tuple[size - 1u] );
+
+    /* the xor accumulator is still extended for tuples beyond the catalog */
+    auto const* prefix_xor = &xor_words[( size - 1u ) * num_words];
+    auto* xor_acc = &xor_words[size * num_words];
+    for ( auto w = 0u; w < num_words; ++w )
     {
-      result &= complement[i] ? ~columns[other_indices[i]].tt : columns[other_indices[i]].tt;
+      xor_acc[w] = prefix_xor[w] ^ last[w];
     }
-    return result;
-  }
 
-  kitty::partial_truth_table nary_xor( std::vector<dependency_analysis_types::column> const& columns, std::vector<uint32_t> const& other_indices )
-  {
-    /* compute nary and */
-    auto result = columns[other_indices[0u]].tt;
-    for ( auto i = 1u; i < other_indices.size(); ++i )
+    /* the AND of polarity p holds the minterms in which the fanins have the values ~p; empty
+       ANDs are don't cares and stay empty in larger tuples, hence they are not extended */
+    uint32_t const last_bit = 1u << ( size - 1u );
+    uint32_t function{0u}, care{0u};
+    bool consistent = true;
+    for ( uint32_t polarity = 0u; polarity < ( 1u << size ); ++polarity )
     {
-      result ^= columns[other_indices[i]].tt;
+      auto const node = ( 1u << size ) + polarity;
+      auto const prefix = ( 1u << ( size - 1u ) ) + ( polarity & ( last_bit - 1u ) );
+      viable[node] = false;
+      if ( !viable[prefix] )
+        continue;
+
+      auto const* prefix_and = &and_words[prefix * num_words];
+      auto* and_acc = &and_words[node * num_words];
+      auto const complement = ( polarity & last_bit ) ? ~uint64_t( 0u ) : uint64_t( 0u );
+      uint64_t ones{0u}, zeros{0u};
+      for ( auto w = 0u; w < num_words; ++w )
+      {
+        auto const mask = w + 1u == num_words ? last_mask : ~uint64_t( 0u );
+        and_acc[w] = prefix_and[w] & ( last[w] ^ complement );
+        ones |= target[w] & and_acc[w] & mask;
+        zeros |= ~target[w] & and_acc[w] & mask;
+      }
+      viable[node] = ones || zeros;
+
+      uint32_t const values = ~polarity & ( ( 1u << size ) - 1u );
+      function |= ( ones ? 1u : 0u ) << values;
+      care |= ( ones || zeros ? 1u : 0u ) << values;
+      consistent = consistent && !( ones && zeros );
     }
-    return result;
+    if ( !consistent )
+      return false;
+
+    /* patterns that do not depend on all fanins are found for a smaller tuple */
+    auto const& catalog = pattern_catalog::get( size );
+    auto const match = catalog.lookup( function, care );
+    if ( !catalog.has_full_support( match ) )
+      return false;
+
+    auto const kind = catalog.kind( match );
+    if ( ps.use_linear_dependencies && ( kind == dependency_analysis_types::pattern_kind::XOR || kind == dependency_analysis_types::pattern_kind::XNOR ) )
+      return false;
+
+    patterns.emplace_back( catalog.pattern( match, std::vector<uint32_t>( tuple.begin(), tuple.begin() + size ) ) );
+    return true;
+  }
+
+public:
+  /*! \brief Parameters of this analysis, e.g., to construct another instance with the same configuration. */
+  pattern_deps_analysis_params const& parameters() const
+  {
+    return ps;
+  }
+
+  /*! \brief Parameters that affect the found dependencies, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return fmt::format( "{} {} {} {} {}", ps.select_first, ps.max_pattern_size, ps.use_linear_dependencies, ps.max_kernel_size,
+                        ps.use_pattern_catalog );
+  }
+
+  pattern_deps_analysis_stats& statistics() const
+  {
+    return st;
   }
 
 private:
@@ -461,6 +639,21 @@ private:
   pattern_deps_analysis_stats& st;
 
   std::vector<dependency_analysis_types::pattern> patterns;
+
+  /* packed columns of the onset minterms of the current function */
+  uint32_t num_vars{0};
+  uint32_t num_words{0};
+  uint64_t last_mask{0};
+  std::vector<uint64_t> column_words;
+  column_classes classes;
+
+  /* search state: fanins of the current tuple, XOR of its first k fanins at
+     offset k, AND of its first k fanins with polarity p at node ( 1 << k ) + p,
+     and whether that AND may still become a pattern */
+  std::array<uint32_t, max_tuple_size> tuple{};
+  std::vector<uint64_t> xor_words;
+  std::vector<uint64_t> and_words;
+  std::array<bool, 2u << max_tuple_size> viable{};
 }; /* dependency_analysis_impl */
 
 } /* namespace angel */
@@ -0,0 +1,444 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file pattern_catalog.hpp
+
+  \brief Cheapest patterns of all functions of up to four fanins
+*/
+
+#pragma once
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Patterns and costs of all functions of `k <= 4` fanins.
+ *
+ * A function of `k` fanins is a truth table of `2^k` bits, bit `v` is its
+ * value if fanin `f` has value `( v >> f ) & 1`.  Every function is mapped
+ * to the cheapest gates that compute it on a target under the cost model of
+ * `esop_gate_cost`: either an ESOP of the fanins, whose first cube is
+ * cheaper than the others, or one gate per minterm, which is implemented as
+ * a uniformly controlled rotation with `2^k` CNOTs.  The cheapest ESOPs of
+ * all functions are found by one shortest path search over the functions,
+ * in which every cube is an edge.
+ *
+ * Functions that are EQUAL, XOR, XNOR, AND, or NAND patterns keep their
+ * kinds and costs as in `pattern_deps_analysis`; all other functions, e.g.,
+ * majorities, multiplexers, or AND-XOR forms, are LUT patterns.  Costs are
+ * pairs of CNOTs and NOTs, a complemented control of a multiple-controlled
+ * gate adds two NOTs, a complemented control of a CNOT one.
+ */
+class pattern_catalog
+{
+public:
+  static constexpr uint32_t max_num_fanins = 4u;
+
+  /*! \brief Catalog of the functions of `num_fanins` fanins, built on first use. */
+  static pattern_catalog const& get( uint32_t num_fanins )
+  {
+    switch ( num_fanins )
+    {
+    case 1u:
+    {
+      static pattern_catalog const catalog( 1u );
+      return catalog;
+    }
+    case 2u:
+    {
+      static pattern_catalog const catalog( 2u );
+      return catalog;
+    }
+    case 3u:
+    {
+      static pattern_catalog const catalog( 3u );
+      return catalog;
+    }
+    default:
+    {
+      assert( num_fanins == max_num_fanins );
+      static pattern_catalog const catalog( max_num_fanins );
+      return catalog;
+    }
+    }
+  }
+
+  uint32_t num_fanins() const
+  {
+    return k;
+  }
+
+  /*! \brief CNOTs and NOTs of the cheapest gates that compute `function`. */
+  std::pair<uint32_t, uint32_t> cost( uint32_t function ) const
+  {
+    return {costs[function] >> 16u, costs[function] & 0xffffu};
+  }
+
+  /*! \brief Whether `function` depends on all fanins. */
+  bool has_full_support( uint32_t function ) const
+  {
+    for ( auto f = 0u; f < k; ++f )
+    {
+      /* bits of the minterms in which fanin f is 0 */
+      uint32_t mask{0u};
+      for ( auto v = 0u; v < ( 1u << k ); ++v )
+      {
+        mask |= ( ( v >> f ) & 1u ) ? 0u : ( 1u << v );
+      }
+      if ( ( ( function >> ( 1u << f ) ) ^ function ) & mask )
+        continue;
+      return false;
+    }
+    return true;
+  }
+
+  /*! \brief Cheapest function that agrees with `function` on the bits in `care`.
+   *
+   * Complete functions are looked up directly.  Otherwise, all completions of
+   * the don't cares are compared if there are few of them, else the first
+   * function that agrees is taken from all functions in order of cost.
+   */
+  uint32_t lookup( uint32_t function, uint32_t care ) const
+  {
+    function &= care;
+    uint32_t const dont_cares = full & ~care;
+    if ( dont_cares == 0u )
+    {
+      return function;
+    }
+
+    if ( __builtin_popcount( dont_cares ) <= max_enumerated_dont_cares )
+    {
+      auto best = function;
+      for ( auto subset = dont_cares; subset; subset = ( subset - 1u ) & dont_cares )
+      {
+        auto const candidate = function | subset;
+        if ( costs[candidate] < costs[best] || ( costs[candidate] == costs[best] && candidate < best ) )
+        {
+          best = candidate;
+        }
+      }
+      return best;
+    }
+
+    for ( auto const& candidate : by_cost )
+    {
+      if ( ( ( candidate ^ function ) & care ) == 0u )
+      {
+        return candidate;
+      }
+    }
+    return function;
+  }
+
+  /*! \brief Kind of the pattern of `function`, which must depend on all fanins. */
+  dependency_analysis_types::pattern_kind kind( uint32_t function ) const
+  {
+    using pattern_kind = dependency_analysis_types::pattern_kind;
+    if ( k == 1u )
+      return pattern_kind::EQUAL;
+    if ( function == parity )
+      return pattern_kind::XOR;
+    if ( function == ( parity ^ full ) )
+      return pattern_kind::XNOR;
+    if ( __builtin_popcount( function ) == 1 )
+      return pattern_kind::AND;
+    if ( __builtin_popcount( function ^ full ) == 1 )
+      return pattern_kind::NAND;
+    return pattern_kind::LUT;
+  }
+
+  /*! \brief Pattern of `function` over the variables `fanins`, `function` must depend on all fanins. */
+  dependency_analysis_types::pattern pattern( uint32_t function, std::vector<uint32_t> const& fanins ) const
+  {
+    using pattern_kind = dependency_analysis_types::pattern_kind;
+    assert( fanins.size() == k && has_full_support( function ) );
+
+    /* EQUAL and AND patterns complement the fanins that are 0 in their only minterm, NAND in the one of the complement */
+    auto const p = kind( function );
+    uint32_t positive = ( 1u << k ) - 1u;
+    if ( p == pattern_kind::EQUAL || p == pattern_kind::AND )
+    {
+      positive = __builtin_ctz( function );
+    }
+    else if ( p == pattern_kind::NAND )
+    {
+      positive = __builtin_ctz( function ^ full );
+    }
+
+    std::vector<uint32_t> literals( k );
+    for ( auto f = 0u; f < k; ++f )
+    {
+      literals[f] = 2u * fanins[f] + ( ( ( positive >> f ) & 1u ) ? 0u : 1u );
+    }
+    if ( p == pattern_kind::LUT )
+    {
+      literals.emplace_back( function );
+    }
+    return {p, literals};
+  }
+
+  /*! \brief Cubes of the cheapest gates that compute `function`, over the literals `2f + c` of the fanins.
+   *
+   * The gates are applied in the order of the cubes; an empty cube is a NOT.
+   */
+  std::vector<std::vector<uint32_t>> recipe( uint32_t function ) const
+  {
+    std::vector<std::vector<uint32_t>> result;
+    if ( function == 0u )
+      return result;
+
+    if ( first_cube[function] == minterm_gates )
+    {
+      /* one gate per minterm of the function, or of its complement followed by a NOT */
+      uint32_t const num_ones = __builtin_popcount( function );
+      uint32_t const num_zeros = __builtin_popcount( function ^ full );
+      auto const onset = num_ones >= 2u && ( num_zeros < 2u || num_ones <= num_zeros + 1u );
+      auto const minterms = onset ? function : function ^ full;
+      for ( auto v = 0u; v < ( 1u << k ); ++v )
+      {
+        if ( ( minterms >> v ) & 1u )
+        {
+          result.emplace_back( cube_literals( cube_index( v, ( 1u << k ) - 1u ) ) );
+        }
+      }
+      if ( !onset )
+      {
+        result.insert( result.begin() + 1u, std::vector<uint32_t>{} );
+      }
+      return result;
+    }
+
+    result.emplace_back( cube_literals( first_cube[function] ) );
+    for ( auto rest = function ^ cubes[first_cube[function]]; rest; )
+    {
+      auto const c = predecessor[rest];
+      result.emplace_back( cube_literals( c ) );
+      rest ^= cubes[c];
+    }
+    return result;
+  }
+
+private:
+  explicit pattern_catalog( uint32_t num_fanins )
+      : k( num_fanins ), full( ( 1u << ( 1u << num_fanins ) ) - 1u )
+  {
+    assert( num_fanins >= 1u && num_fanins <= max_num_fanins );
+    uint32_t const num_functions = full + 1u;
+
+    /* cube c has digit 1 (2) in base 3 at position f if fanin f is positive (complemented) */
+    uint32_t num_cubes = 1u;
+    for ( auto f = 0u; f < k; ++f )
+    {
+      num_cubes *= 3u;
+    }
+    cubes.resize( num_cubes );
+    std::vector<uint32_t> first_costs( num_cubes ), rest_costs( num_cubes );
+    for ( auto c = 0u; c < num_cubes; ++c )
+    {
+      auto const [positive, negative] = cube_polarities( c );
+      for ( auto v = 0u; v < ( 1u << k ); ++v )
+      {
+        if ( ( v & positive ) == positive && ( v & negative ) == 0u )
+        {
+          cubes[c] |= 1u << v;
+        }
+      }
+
+      uint32_t const n = __builtin_popcount( positive | negative );
+      uint32_t const num_negative = __builtin_popcount( negative );
+      switch ( n )
+      {
+      case 0u:
+        first_costs[c] = rest_costs[c] = pack( 0u, 1u );
+        break;
+      case 1u:
+        first_costs[c] = rest_costs[c] = pack( 1u, num_negative );
+        break;
+      default:
+        first_costs[c] = pack( 1u << n, ( 1u << n ) + 2u * num_negative );
+        rest_costs[c] = pack( ( 1u << ( n + 1u ) ) - 2u, ( 1u << ( n + 1u ) ) - 2u + 2u * num_negative );
+        break;
+      }
+    }
+
+    /* cheapest XOR of non-first cubes of every function; ESOPs with more CNOTs than one gate per minterm are not needed */
+    constexpr auto unreachable = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> distance( num_functions, unreachable );
+    predecessor.assign( num_functions, 0u );
+    using entry = std::pair<uint32_t, uint32_t>;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+    distance[0u] = 0u;
+    queue.emplace( 0u, 0u );
+    while ( !queue.empty() )
+    {
+      auto const [d, s] = queue.top();
+      queue.pop();
+      if ( d != distance[s] )
+        continue;
+
+      for ( auto c = 0u; c < num_cubes; ++c )
+      {
+        auto const next = d + rest_costs[c];
+        auto const t = s ^ cubes[c];
+        if ( next < distance[t] && ( next >> 16u ) <= ( 1u << k ) )
+        {
+          distance[t] = next;
+          predecessor[t] = c;
+          queue.emplace( next, t );
+        }
+      }
+    }
+
+    /* cheapest first cube of every function, or one gate per minterm */
+    for ( auto v = 0u; v < ( 1u << k ); ++v )
+    {
+      parity |= ( __builtin_popcount( v ) & 1u ) << v;
+    }
+    costs.assign( num_functions, 0u );
+    first_cube.assign( num_functions, minterm_gates );
+    for ( auto g = 1u; g < num_functions; ++g )
+    {
+      costs[g] = k >= 2u ? pack( 1u << k, 0u ) : unreachable;
+      for ( auto c = 0u; c < num_cubes; ++c )
+      {
+        if ( auto const d = distance[g ^ cubes[c]]; d != unreachable && first_costs[c] + d < costs[g] )
+        {
+          costs[g] = first_costs[c] + d;
+          first_cube[g] = c;
+        }
+      }
+
+      /* costs of the kinds of `pattern_deps_analysis` */
+      if ( k >= 2u && has_full_support( g ) )
+      {
+        switch ( kind( g ) )
+        {
+        case dependency_analysis_types::pattern_kind::XOR:
+          costs[g] = pack( k, 0u );
+          break;
+        case dependency_analysis_types::pattern_kind::XNOR:
+          costs[g] = pack( k, 1u );
+          break;
+        case dependency_analysis_types::pattern_kind::AND:
+          costs[g] = pack( 1u << k, ( 1u << k ) + 2u * ( k - __builtin_popcount( __builtin_ctz( g ) ) ) );
+          break;
+        case dependency_analysis_types::pattern_kind::NAND:
+          costs[g] = pack( 1u << k, ( 1u << k ) + 1u + 2u * ( k - __builtin_popcount( __builtin_ctz( g ^ full ) ) ) );
+          break;
+        default:
+          break;
+        }
+      }
+    }
+
+    /* functions in order of cost, for partial functions with many don't cares */
+    if ( ( 1u << k ) > max_enumerated_dont_cares )
+    {
+      by_cost.resize( num_functions );
+      for ( auto g = 0u; g < num_functions; ++g )
+      {
+        by_cost[g] = g;
+      }
+      std::stable_sort( by_cost.begin(), by_cost.end(), [&]( auto a, auto b ) { return costs[a] < costs[b]; } );
+    }
+  }
+
+  static uint32_t pack( uint32_t cnots, uint32_t nots )
+  {
+    return ( cnots << 16u ) | nots;
+  }
+
+  /* positive and complemented fanins of cube c */
+  std::pair<uint32_t, uint32_t> cube_polarities( uint32_t c ) const
+  {
+    uint32_t positive{0u}, negative{0u};
+    for ( auto f = 0u; f < k; ++f, c /= 3u )
+    {
+      if ( c % 3u == 1u )
+        positive |= 1u << f;
+      else if ( c % 3u == 2u )
+        negative |= 1u << f;
+    }
+    return {positive, negative};
+  }
+
+  /* cube of the fanins in `vars` with the values of minterm v */
+  uint32_t cube_index( uint32_t v, uint32_t vars ) const
+  {
+    uint32_t c{0u};
+    for ( auto f = k; f-- > 0u; )
+    {
+      c = 3u * c + ( ( ( vars >> f ) & 1u ) ? ( ( ( v >> f ) & 1u ) ? 1u : 2u ) : 0u );
+    }
+    return c;
+  }
+
+  std::vector<uint32_t> cube_literals( uint32_t c ) const
+  {
+    auto const [positive, negative] = cube_polarities( c );
+    std::vector<uint32_t> literals;
+    for ( auto f = 0u; f < k; ++f )
+    {
+      if ( ( ( positive | negative ) >> f ) & 1u )
+      {
+        literals.emplace_back( 2u * f + ( ( negative >> f ) & 1u ) );
+      }
+    }
+    return literals;
+  }
+
+private:
+  static constexpr uint32_t max_enumerated_dont_cares = 10u;
+  static constexpr uint32_t minterm_gates = std::numeric_limits<uint32_t>::max();
+
+  uint32_t k;
+  uint32_t full;
+  uint32_t parity{0u};
+
+  /* truth table of every cube */
+  std::vector<uint32_t> cubes;
+
+  /* packed cost (CNOTs in the upper, NOTs in the lower 16 bits), first cube, and last non-first cube of every function */
+  std::vector<uint32_t> costs;
+  std::vector<uint32_t> first_cube;
+  std::vector<uint32_t> predecessor;
+
+  /* all functions in order of cost */
+  std::vector<uint32_t> by_cost;
+};
+
+} // namespace angel
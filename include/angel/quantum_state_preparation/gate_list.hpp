@@ -0,0 +1,233 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file gate_list.hpp
+
+  \brief Flat representation of state preparation circuits
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Flat list of (multi-)controlled Ry rotations.
+ *
+ * Gate `i` rotates qubit `target( i )` by `angle( i )` if all positive
+ * controls are 1 and all negative controls are 0.  An angle of pi without
+ * controls is a NOT, an angle of pi with controls is a multiple-controlled
+ * Toffoli gate.  Gates are stored in the order in which they are applied.
+ *
+ * The gates are stored as a struct of arrays.  Controls are bitmasks of
+ * `num_words()` 64-bit words per gate, i.e., a single word inline for up to
+ * 64 qubits, and a fixed stride for larger qubit counts.  Control literals
+ * `2 * qubit + sign` (sign 1 = negative control) are accepted and returned by
+ * the convenience functions.
+ */
+class gate_list
+{
+public:
+  gate_list()
+    : gate_list( 0u )
+  {
+  }
+
+  explicit gate_list( uint32_t num_qubits )
+    : _num_qubits( num_qubits ), _num_words( std::max( 1u, ( num_qubits + 63u ) / 64u ) )
+  {
+  }
+
+  uint32_t num_qubits() const
+  {
+    return _num_qubits;
+  }
+
+  uint32_t num_words() const
+  {
+    return _num_words;
+  }
+
+  uint64_t size() const
+  {
+    return targets.size();
+  }
+
+  bool empty() const
+  {
+    return targets.empty();
+  }
+
+  void reserve( uint64_t num_gates )
+  {
+    targets.reserve( num_gates );
+    angles.reserve( num_gates );
+    positives.reserve( num_gates * _num_words );
+    negatives.reserve( num_gates * _num_words );
+  }
+
+  void clear()
+  {
+    targets.clear();
+    angles.clear();
+    positives.clear();
+    negatives.clear();
+  }
+
+  /*! \brief Appends a gate whose controls fit into the first word. */
+  void add_gate( uint32_t target, double angle, uint64_t positive = 0u, uint64_t negative = 0u )
+  {
+    insert_gate( size(), target, angle, {} );
+    positives[( size() - 1u ) * _num_words] = positive;
+    negatives[( size() - 1u ) * _num_words] = negative;
+  }
+
+  /*! \brief Appends a gate with `num_words()` words per control mask. */
+  void add_gate( uint32_t target, double angle, uint64_t const* positive, uint64_t const* negative )
+  {
+    insert_gate( size(), target, angle, {} );
+    std::copy( positive, positive + _num_words, &positives[( size() - 1u ) * _num_words] );
+    std::copy( negative, negative + _num_words, &negatives[( size() - 1u ) * _num_words] );
+  }
+
+  /*! \brief Appends a gate with control literals. */
+  void add_gate( uint32_t target, double angle, std::vector<uint32_t> const& controls )
+  {
+    insert_gate( size(), target, angle, controls );
+  }
+
+  /*! \brief Inserts a gate with control literals before gate `index`. */
+  void insert_gate( uint64_t index, uint32_t target, double angle, std::vector<uint32_t> const& controls = {} )
+  {
+    assert( target < _num_qubits && index <= size() );
+    targets.insert( targets.begin() + index, target );
+    angles.insert( angles.begin() + index, angle );
+    positives.insert( positives.begin() + index * _num_words, _num_words, 0u );
+    negatives.insert( negatives.begin() + index * _num_words, _num_words, 0u );
+    for ( auto const& c : controls )
+    {
+      assert( c / 2u < _num_qubits );
+      ( c % 2u ? negatives : positives )[index * _num_words + c / 128u] |= uint64_t( 1u ) << ( ( c / 2u ) % 64u );
+    }
+  }
+
+  void erase_gate( uint64_t index )
+  {
+    targets.erase( targets.begin() + index );
+    angles.erase( angles.begin() + index );
+    positives.erase( positives.begin() + index * _num_words, positives.begin() + ( index + 1u ) * _num_words );
+    negatives.erase( negatives.begin() + index * _num_words, negatives.begin() + ( index + 1u ) * _num_words );
+  }
+
+  uint32_t target( uint64_t index ) const
+  {
+    return targets[index];
+  }
+
+  double angle( uint64_t index ) const
+  {
+    return angles[index];
+  }
+
+  /*! \brief Positive control mask of a gate (`num_words()` words). */
+  uint64_t const* positive( uint64_t index ) const
+  {
+    return &positives[index * _num_words];
+  }
+
+  /*! \brief Negative control mask of a gate (`num_words()` words). */
+  uint64_t const* negative( uint64_t index ) const
+  {
+    return &negatives[index * _num_words];
+  }
+
+  uint32_t num_controls( uint64_t index ) const
+  {
+    uint32_t result{0u};
+    for ( auto w = 0u; w < _num_words; ++w )
+    {
+      result += __builtin_popcountll( positives[index * _num_words + w] | negatives[index * _num_words + w] );
+    }
+    return result;
+  }
+
+  /*! \brief Checks whether a gate is a NOT (angle pi, no controls). */
+  bool is_not( uint64_t index ) const
+  {
+    return angles[index] == M_PI && num_controls( index ) == 0u;
+  }
+
+  /*! \brief Control literals of a gate in decreasing qubit order. */
+  std::vector<uint32_t> controls( uint64_t index ) const
+  {
+    std::vector<uint32_t> result;
+    for ( auto w = _num_words; w-- > 0u; )
+    {
+      auto const pos = positives[index * _num_words + w];
+      auto const neg = negatives[index * _num_words + w];
+      for ( auto mask = pos | neg; mask; )
+      {
+        auto const bit = 63u - __builtin_clzll( mask );
+        mask &= ~( uint64_t( 1u ) << bit );
+        result.emplace_back( 2u * ( 64u * w + bit ) + ( ( neg >> bit ) & 1u ) );
+      }
+    }
+    return result;
+  }
+
+  /*! \brief Number of bytes allocated for the gates. */
+  uint64_t memory_usage() const
+  {
+    return targets.capacity() * sizeof( uint32_t ) + angles.capacity() * sizeof( double ) +
+           ( positives.capacity() + negatives.capacity() ) * sizeof( uint64_t );
+  }
+
+  bool operator==( gate_list const& other ) const
+  {
+    return _num_qubits == other._num_qubits && targets == other.targets && angles == other.angles &&
+           positives == other.positives && negatives == other.negatives;
+  }
+
+  bool operator!=( gate_list const& other ) const
+  {
+    return !( *this == other );
+  }
+
+private:
+  uint32_t _num_qubits;
+  uint32_t _num_words;
+  std::vector<uint32_t> targets;
+  std::vector<double> angles;
+  std::vector<uint64_t> positives;
+  std::vector<uint64_t> negatives;
+};
+
+} // namespace angel
@@ -0,0 +1,423 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file mc_qg_generation.hpp
+
+  \brief Iterative generation of multi-controlled rotation gates
+*/
+
+#pragma once
+
+#include "utils.hpp"
+#include <angel/dependency_analysis/common.hpp>
+#include <angel/dependency_analysis/pattern_catalog.hpp>
+#include <angel/utils/ones_pyramid.hpp>
+
+#include <kitty/dynamic_truth_table.hpp>
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace angel
+{
+
+namespace detail
+{
+
+/* gates that compute a target from its pattern-based dependency (into a gate_list or a gate_cost_accumulator) */
+template<class Gates>
+void emit_dependency( Gates& gates, uint32_t target, dependency_analysis_types::pattern const& dependency )
+{
+  using pattern_kind = dependency_analysis_types::pattern_kind;
+  switch ( dependency.first )
+  {
+  case pattern_kind::EQUAL:
+    /* a complemented fanin is copied with a positive control and then negated, not with a negative control, which would negate it twice */
+    gates.add_gate( target, M_PI, std::vector<uint32_t>{dependency.second[0] - dependency.second[0] % 2u} );
+    if ( dependency.second[0] % 2 != 0 ) /* not operation */
+    {
+      gates.add_gate( target, M_PI );
+    }
+    break;
+  case pattern_kind::XOR:
+  case pattern_kind::XNOR:
+    for ( auto const& fanin : dependency.second )
+    {
+      gates.add_gate( target, M_PI, std::vector<uint32_t>{fanin} );
+    }
+    if ( dependency.first == pattern_kind::XNOR )
+    {
+      gates.add_gate( target, M_PI );
+    }
+    break;
+  case pattern_kind::AND:
+  case pattern_kind::NAND:
+    gates.add_gate( target, M_PI, dependency.second );
+    if ( dependency.first == pattern_kind::NAND )
+    {
+      gates.add_gate( target, M_PI );
+    }
+    break;
+  case pattern_kind::LUT:
+  {
+    /* cubes of the catalog over the fanins, which are positive literals followed by the function */
+    auto const num_fanins = static_cast<uint32_t>( dependency.second.size() ) - 1u;
+    for ( auto const& cube : pattern_catalog::get( num_fanins ).recipe( dependency.second.back() ) )
+    {
+      std::vector<uint32_t> controls( cube.size() );
+      for ( auto i = 0u; i < cube.size(); ++i )
+      {
+        controls[i] = dependency.second[cube[i] / 2u] + cube[i] % 2u;
+      }
+      gates.add_gate( target, M_PI, controls );
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/* gates that compute a target from its ESOP-based dependency */
+template<class Gates>
+void emit_dependency( Gates& gates, uint32_t target, std::vector<std::vector<uint32_t>> const& dependency )
+{
+  for ( auto const& cube : dependency )
+  {
+    gates.add_gate( target, M_PI, cube );
+  }
+}
+
+/* pattern-based dependencies are always implemented */
+inline bool is_dependency_useful( dependency_analysis_types::pattern const&, uint32_t )
+{
+  return true;
+}
+
+/* ESOP-based dependencies are implemented if they are not more expensive than the upper bound */
+inline bool is_dependency_useful( std::vector<std::vector<uint32_t>> const& dependency, uint32_t upperbound_cost )
+{
+  return angel::esop_gate_cost( dependency ).first <= upperbound_cost;
+}
+
+} // namespace detail
+
+/*! \brief Generates the uniformly controlled rotations that prepare a state.
+ *
+ * The truth table is decomposed on its top variable: every node emits an Ry
+ * rotation (or the gates of a dependency) on `var_index`, and descends into
+ * the negative and the positive cofactor with an additional negative or
+ * positive control on `var_index`.  Cofactors that are constant 1 are
+ * prepared with Hadamard gates on all lower variables.
+ *
+ * The decomposition is depth-first with an explicit stack.  A cofactor on the
+ * top variable is a contiguous half of the bits of its parent, such that
+ * nodes are (offset, level) views of the input truth table and no cofactor is
+ * ever materialized.  The ones of every view are looked up in a pyramid of
+ * ones counts built once per function, such that a node takes constant time
+ * apart from the gates it emits.  Controls and constant lines are bitmasks,
+ * and dependencies are indexed by variable.  Gates are emitted into a scratch
+ * list in depth-first order and grouped by target at the end.  Alternatively,
+ * `cost` only accumulates the cost of every emitted gate.  All buffers are kept between
+ * calls; an instance is not thread-safe, use one generator per thread.
+ *
+ * \tparam Dependencies map from a variable to its dependency, either
+ *         `std::map<uint32_t, dependency_analysis_types::pattern>` or
+ *         `std::map<uint32_t, std::vector<std::vector<uint32_t>>>`
+ */
+template<class Dependencies>
+class mc_qg_generator
+{
+public:
+  using dependencies_t = Dependencies;
+  using dependency_t = typename Dependencies::mapped_type;
+
+public:
+  /*! \brief Generates the gates for `tt` into `gates`.
+   *
+   * The previous content of `gates` is replaced.  The gates are grouped by
+   * target from the highest to the lowest target.
+   *
+   * \param num_vars number of qubits (of the top-level function)
+   * \param tt function on (at least) the variables `0, ..., var_index`
+   * \param var_index variable to decompose on
+   * \param controls controls of the node in decreasing variable order
+   */
+  void operator()( gate_list& gates, uint32_t num_vars, kitty::dynamic_truth_table const& tt, uint32_t var_index, std::vector<uint32_t> const& controls,
+                   dependencies_t const& dependencies, std::vector<uint32_t> const& zero_lines, std::vector<uint32_t> const& one_lines )
+  {
+    if ( emitted.num_qubits() != num_vars )
+    {
+      emitted = gate_list( num_vars );
+    }
+    emitted.clear();
+    counting = false;
+    run( num_vars, tt, var_index, controls, dependencies, zero_lines, one_lines );
+    group_by_target( gates, num_vars );
+  }
+
+  /*! \brief Computes the CNOT and SQG costs of the gates for `tt` without generating them.
+   *
+   * The result is the same as `gates_statistics` on the gates generated by
+   * `operator()`.  The traversal stops as soon as the CNOT cost reaches
+   * `bound`; the returned costs are then partial, but the CNOT cost is at
+   * least `bound`.
+   */
+  std::pair<uint32_t, uint32_t> cost( uint32_t num_vars, kitty::dynamic_truth_table const& tt, uint32_t var_index, std::vector<uint32_t> const& controls,
+                                      dependencies_t const& dependencies, std::vector<uint32_t> const& zero_lines, std::vector<uint32_t> const& one_lines,
+                                      uint32_t bound = std::numeric_limits<uint32_t>::max() )
+  {
+    counting = true;
+    run( num_vars, tt, var_index, controls, dependencies, zero_lines, one_lines, bound );
+    return costs.cost();
+  }
+
+private:
+  void run( uint32_t num_vars, kitty::dynamic_truth_table const& tt, uint32_t var_index, std::vector<uint32_t> const& controls,
+            dependencies_t const& dependencies, std::vector<uint32_t> const& zero_lines, std::vector<uint32_t> const& one_lines,
+            uint32_t bound = std::numeric_limits<uint32_t>::max() )
+  {
+    assert( num_vars <= 64u && var_index < static_cast<uint32_t>( tt.num_vars() ) );
+
+    ones.build( tt );
+    zero_mask = to_mask( zero_lines );
+    one_mask = to_mask( one_lines );
+    table.assign( num_vars, nullptr );
+    uint64_t dependency_mask{0u};
+    for ( auto const& [var, dependency] : dependencies )
+    {
+      if ( var < num_vars )
+      {
+        table[var] = &dependency;
+        dependency_mask |= uint64_t( 1u ) << var;
+      }
+    }
+    if ( counting )
+    {
+      costs.reset( num_vars, dependency_mask );
+    }
+
+    uint64_t positive{0u}, negative{0u};
+    for ( auto const& c : controls )
+    {
+      ( c % 2u ? negative : positive ) |= uint64_t( 1u ) << ( c / 2u );
+    }
+
+    touched = 0u;
+
+    stack.clear();
+    stack.push_back( {0u, var_index, positive, negative, false} );
+    while ( !stack.empty() )
+    {
+      auto const f = stack.back();
+      stack.pop_back();
+      if ( f.hadamard )
+      {
+        emit_hadamards( f );
+      }
+      else
+      {
+        visit( num_vars, f );
+      }
+
+      /* the CNOT cost only grows, give up once it reaches the bound */
+      if ( counting && costs.num_cnots() >= bound )
+      {
+        break;
+      }
+    }
+  }
+
+  struct frame
+  {
+    /* first bit of the node (or unused for Hadamard frames) */
+    uint64_t offset;
+    uint32_t var_index;
+    uint64_t positive;
+    uint64_t negative;
+    /* prepare all variables below var_index with Hadamard gates */
+    bool hadamard;
+  };
+
+  void visit( uint32_t num_vars, frame const& f )
+  {
+    auto const var_index = f.var_index;
+    auto const half = uint64_t( 1u ) << var_index;
+    auto const tt_ones = ones.count( f.offset, var_index + 1u );
+    auto const c0_ones = ones.count( f.offset, var_index );
+    auto const c1_ones = tt_ones - c0_ones;
+    auto const var_bit = uint64_t( 1u ) << var_index;
+    auto const dependency = table[var_index];
+
+    bool is_const = false;
+    if ( one_mask & var_bit ) /* insert not gate */
+    {
+      if ( ( touched & var_bit ) == 0u )
+      {
+        add_gate( var_index, M_PI, 0u, 0u );
+      }
+      is_const = true;
+    }
+    else if ( zero_mask & var_bit )
+    {
+      is_const = true;
+    }
+    else if ( c0_ones != tt_ones ) /* == --> identity and ignore */
+    {
+      bool const deps_useful = dependency && detail::is_dependency_useful( *dependency, upperbound_cost( num_vars, var_index ) );
+      if ( deps_useful )
+      {
+        if ( ( touched & var_bit ) == 0u )
+        {
+          if ( counting )
+          {
+            detail::emit_dependency( costs, var_index, *dependency );
+          }
+          else
+          {
+            detail::emit_dependency( emitted, var_index, *dependency );
+          }
+          touched |= var_bit;
+        }
+      }
+      else
+      {
+        double const angle = 2 * acos( sqrt( static_cast<double>( c0_ones ) / tt_ones ) );
+        add_gate( var_index, angle, f.positive, f.negative );
+      }
+    }
+
+    /* controls of the cofactors */
+    auto const add_control = !dependency && !is_const;
+    frame const f0{f.offset, var_index - 1u, f.positive, f.negative | ( add_control ? var_bit : 0u ), false};
+    frame const f1{f.offset + half, var_index - 1u, f.positive | ( add_control ? var_bit : 0u ), f.negative, false};
+
+    /* the stack is LIFO, push the positive cofactor first */
+    auto const c0_allone = c0_ones == half;
+    auto const c0_allzero = c0_ones == 0u;
+    auto const c1_allone = c1_ones == half;
+    auto const c1_allzero = c1_ones == 0u;
+    if ( c1_allone )
+    {
+      stack.push_back( {0u, var_index, f1.positive, f1.negative, true} );
+    }
+    else if ( !c1_allzero )
+    {
+      stack.push_back( f1 );
+    }
+
+    if ( c0_allone )
+    {
+      stack.push_back( {0u, var_index, f0.positive, f0.negative, true} );
+    }
+    else if ( !c0_allzero )
+    {
+      stack.push_back( f0 );
+    }
+  }
+
+  void emit_hadamards( frame const& f )
+  {
+    for ( auto i = 0u; i < f.var_index; ++i )
+    {
+      add_gate( i, M_PI / 2, f.positive, f.negative );
+    }
+  }
+
+  void add_gate( uint32_t target, double angle, uint64_t positive, uint64_t negative )
+  {
+    if ( counting )
+    {
+      costs.add_gate( target, angle, positive, negative );
+    }
+    else
+    {
+      emitted.add_gate( target, angle, positive, negative );
+    }
+    touched |= uint64_t( 1u ) << target;
+  }
+
+  /* stable bucket sort of the emitted gates by decreasing target */
+  void group_by_target( gate_list& gates, uint32_t num_vars )
+  {
+    constexpr auto none = std::numeric_limits<uint32_t>::max();
+    head.assign( num_vars, none );
+    tail.assign( num_vars, none );
+    next.assign( emitted.size(), none );
+    for ( auto g = 0u; g < emitted.size(); ++g )
+    {
+      auto const t = emitted.target( g );
+      ( tail[t] == none ? head[t] : next[tail[t]] ) = g;
+      tail[t] = g;
+    }
+
+    gates = gate_list( num_vars );
+    gates.reserve( emitted.size() );
+    for ( auto t = num_vars; t-- > 0u; )
+    {
+      for ( auto g = head[t]; g != none; g = next[g] )
+      {
+        gates.add_gate( t, emitted.angle( g ), emitted.positive( g )[0], emitted.negative( g )[0] );
+      }
+    }
+  }
+
+  /* see compute_upperbound_cost */
+  uint32_t upperbound_cost( uint32_t num_vars, uint32_t var_index ) const
+  {
+    auto const above = ~( ( uint64_t( 2u ) << var_index ) - 1u );
+    auto const const_lines = __builtin_popcountll( ( zero_mask | one_mask ) & above );
+    return uint32_t( 1u ) << ( num_vars - var_index - 1u - const_lines );
+  }
+
+  static uint64_t to_mask( std::vector<uint32_t> const& lines )
+  {
+    uint64_t mask{0u};
+    for ( auto const& l : lines )
+    {
+      mask |= uint64_t( 1u ) << l;
+    }
+    return mask;
+  }
+
+private:
+  ones_pyramid ones;
+  uint64_t zero_mask{0u};
+  uint64_t one_mask{0u};
+  std::vector<dependency_t const*> table;
+  std::vector<frame> stack;
+  gate_list emitted;
+  gate_cost_accumulator costs;
+  bool counting{false};
+  uint64_t touched{0u};
+  std::vector<uint32_t> head, tail, next;
+};
+
+} // namespace angel
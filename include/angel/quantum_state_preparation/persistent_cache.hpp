@@ -0,0 +1,715 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file persistent_cache.hpp
+
+  \brief Memory-mapped on-disk cache for synthesized networks
+
+  File layout (native endianness):
+
+  - header (magic, format version, cost-model tag, number of buckets,
+    number of entries, end of the data section)
+  - bucket array of 64-bit record offsets (0 = empty), linear probing
+  - records, 8-byte aligned:
+    num_vars, num_words, words, cnots, sqgs, order size, order,
+    num_qubits, num_gates, targets, angles, positive masks, negative masks
+    (see `gate_list`)
+
+  Records are only ever appended.  A bucket is published after its record
+  has been written, and readers check every offset against the size of
+  their mapping, such that any number of processes can read the file while
+  a single process appends to it.  When the bucket array is 3/4 full, the
+  writer rebuilds the file with twice as many buckets in a temporary file
+  and renames it over the old one; readers keep their mapping of the old
+  file until they reopen it.
+*/
+
+#pragma once
+
+#include "utils.hpp"
+
+#include <fmt/format.h>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ANGEL_HAS_MMAP 1
+#endif
+
+namespace angel
+{
+
+enum class persistent_cache_mode
+{
+  read_only,
+  read_write
+};
+
+/*! \brief Hashes a string into a cost-model tag (FNV-1a, stable across runs). */
+inline uint64_t persistent_cache_tag( std::string const& s )
+{
+  uint64_t h = UINT64_C( 0xcbf29ce484222325 );
+  for ( auto const c : s )
+  {
+    h ^= static_cast<uint8_t>( c );
+    h *= UINT64_C( 0x100000001b3 );
+  }
+  return h;
+}
+
+class persistent_synthesis_cache
+{
+public:
+  using key_type = kitty::dynamic_truth_table;
+
+  static constexpr uint32_t format_version = 3u;
+
+public:
+  persistent_synthesis_cache() = default;
+  persistent_synthesis_cache( persistent_synthesis_cache const& ) = delete;
+  persistent_synthesis_cache& operator=( persistent_synthesis_cache const& ) = delete;
+
+  ~persistent_synthesis_cache()
+  {
+    close();
+  }
+
+  /*! \brief Opens (or, in read-write mode, creates) a cache file.
+   *
+   * A file with a different format version or cost-model tag is stale: in
+   * read-only mode it is ignored, in read-write mode it is replaced by an
+   * empty file.  Only one process can open a file for writing; if another
+   * writer holds it, the file is opened read-only.
+   *
+   * \param num_buckets initial size of the hash table when a new file is created
+   * \return true if the file is usable
+   */
+  bool open( std::string const& filename, persistent_cache_mode mode, uint64_t tag, uint64_t num_buckets = 1u << 16u )
+  {
+    std::unique_lock lock( mutex );
+    close_unlocked();
+    path = filename;
+
+#ifdef ANGEL_HAS_MMAP
+    if ( mode == persistent_cache_mode::read_write )
+    {
+      auto const status = open_mapping( filename, true );
+      if ( status == open_status::success && valid( tag ) )
+      {
+        return true;
+      }
+      close_unlocked();
+
+      if ( status != open_status::locked )
+      {
+        /* missing, unreadable, or stale: start a new file */
+        if ( create( filename, tag, num_buckets ) && open_mapping( filename, true ) == open_status::success && valid( tag ) )
+        {
+          return true;
+        }
+        close_unlocked();
+        return false;
+      }
+      /* another process is writing, fall back to read-only */
+    }
+
+    if ( open_mapping( filename, false ) != open_status::success || !valid( tag ) )
+    {
+      close_unlocked();
+      return false;
+    }
+    return true;
+#else
+    (void)filename;
+    (void)mode;
+    (void)tag;
+    (void)num_buckets;
+    return false;
+#endif
+  }
+
+  void close()
+  {
+    std::unique_lock lock( mutex );
+    close_unlocked();
+  }
+
+  bool is_open() const
+  {
+    return base != nullptr;
+  }
+
+  bool is_writable() const
+  {
+    return writable;
+  }
+
+  uint64_t size() const
+  {
+    std::shared_lock lock( mutex );
+    return base ? header()->num_entries : 0u;
+  }
+
+  std::optional<network> find( key_type const& key ) const
+  {
+    std::shared_lock lock( mutex );
+    if ( !base )
+    {
+      return std::nullopt;
+    }
+
+    auto const nb = header()->num_buckets;
+    auto index = hash( key ) % nb;
+    for ( auto probe = 0u; probe < nb; ++probe, index = ( index + 1u ) % nb )
+    {
+      auto const offset = bucket( index );
+      if ( offset == 0u )
+      {
+        return std::nullopt;
+      }
+      if ( matches( offset, key ) )
+      {
+        return decode( offset, key );
+      }
+    }
+    return std::nullopt;
+  }
+
+  /*! \brief Number of entries that could not be written, e.g., because the file could not grow. */
+  uint64_t num_failed_inserts() const
+  {
+    std::shared_lock lock( mutex );
+    return num_failed;
+  }
+
+  /*! \brief Appends a network; returns false if present, read-only, or if it could not be written. */
+  bool insert( key_type const& key, network const& ntk )
+  {
+    std::unique_lock lock( mutex );
+    if ( !base || !writable )
+    {
+      return false;
+    }
+
+    auto nb = header()->num_buckets;
+    auto index = hash( key ) % nb;
+    while ( bucket( index ) != 0u )
+    {
+      if ( matches( bucket( index ), key ) )
+      {
+        return false;
+      }
+      index = ( index + 1u ) % nb;
+    }
+
+    /* keep the load factor below 0.75 */
+    if ( 4u * ( header()->num_entries + 1u ) > 3u * nb )
+    {
+      if ( !grow() )
+      {
+        ++num_failed;
+        return false;
+      }
+      nb = header()->num_buckets;
+      index = hash( key ) % nb;
+      while ( bucket( index ) != 0u )
+      {
+        index = ( index + 1u ) % nb;
+      }
+    }
+
+    std::vector<uint8_t> record;
+    encode( record, key, ntk );
+
+    auto const offset = header()->data_end;
+    if ( !reserve( offset + record.size() ) )
+    {
+      ++num_failed;
+      return false;
+    }
+    std::memcpy( base + offset, record.data(), record.size() );
+    header()->data_end = offset + ( ( record.size() + 7u ) & ~UINT64_C( 7 ) );
+    ++header()->num_entries;
+
+    /* publish the bucket only after the record is complete */
+    std::atomic_thread_fence( std::memory_order_release );
+    std::memcpy( base + bucket_offset( index ), &offset, sizeof( offset ) );
+    return true;
+  }
+
+private:
+  struct file_header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t tag;
+    uint64_t num_buckets;
+    uint64_t num_entries;
+    uint64_t data_end;
+  };
+
+  static constexpr char const* magic = "ANGELQSP";
+  /* a writer that keeps growing the file is treated like a locked file after this many reopens */
+  static constexpr uint32_t max_open_attempts = 8u;
+
+  file_header* header() const
+  {
+    return reinterpret_cast<file_header*>( base );
+  }
+
+  static uint64_t bucket_offset( uint64_t index )
+  {
+    return sizeof( file_header ) + index * sizeof( uint64_t );
+  }
+
+  uint64_t bucket( uint64_t index ) const
+  {
+    uint64_t offset;
+    std::memcpy( &offset, base + bucket_offset( index ), sizeof( offset ) );
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return offset;
+  }
+
+  static uint64_t hash( key_type const& key )
+  {
+    std::size_t seed = kitty::hash<key_type>()( key );
+    kitty::hash_combine( seed, key.num_vars() );
+    return seed;
+  }
+
+  bool valid( uint64_t tag ) const
+  {
+    if ( length < sizeof( file_header ) )
+    {
+      return false;
+    }
+    auto const* h = header();
+    return std::memcmp( h->magic, magic, 8u ) == 0 && h->version == format_version && h->tag == tag &&
+           h->num_buckets > 0u && bucket_offset( h->num_buckets ) <= length && h->data_end <= length;
+  }
+
+  /* reads a value at offset, fails if it lies outside of the mapping */
+  template<typename T>
+  bool read( uint64_t& offset, T& value ) const
+  {
+    if ( offset + sizeof( T ) > length )
+    {
+      return false;
+    }
+    std::memcpy( &value, base + offset, sizeof( T ) );
+    offset += sizeof( T );
+    return true;
+  }
+
+  /* reads values.size() values at offset, fails if they lie outside of the mapping */
+  template<typename T>
+  bool read_array( uint64_t& offset, std::vector<T>& values ) const
+  {
+    auto const bytes = values.size() * sizeof( T );
+    if ( bytes / sizeof( T ) != values.size() || offset + bytes > length )
+    {
+      return false;
+    }
+    std::memcpy( values.data(), base + offset, bytes );
+    offset += bytes;
+    return true;
+  }
+
+  /* key of the record at offset */
+  std::optional<key_type> record_key( uint64_t offset ) const
+  {
+    uint32_t num_vars, num_words;
+    if ( !read( offset, num_vars ) || !read( offset, num_words ) || num_vars > 32u )
+    {
+      return std::nullopt;
+    }
+    key_type key( num_vars );
+    if ( num_words != key.num_blocks() || !read_array( offset, key._bits ) )
+    {
+      return std::nullopt;
+    }
+    return key;
+  }
+
+  bool matches( uint64_t offset, key_type const& key ) const
+  {
+    uint32_t num_vars, num_words;
+    if ( !read( offset, num_vars ) || !read( offset, num_words ) )
+    {
+      return false;
+    }
+    if ( num_vars != static_cast<uint32_t>( key.num_vars() ) || num_words != key.num_blocks() || offset + num_words * sizeof( uint64_t ) > length )
+    {
+      return false;
+    }
+    return std::memcmp( base + offset, key._bits.data(), num_words * sizeof( uint64_t ) ) == 0;
+  }
+
+  std::optional<network> decode( uint64_t offset, key_type const& key ) const
+  {
+    offset += 2u * sizeof( uint32_t ) + key.num_blocks() * sizeof( uint64_t );
+
+    network ntk;
+    uint32_t order_size, num_qubits, num_gates;
+    if ( !read( offset, ntk.cnots_sqgs.first ) || !read( offset, ntk.cnots_sqgs.second ) || !read( offset, order_size ) )
+    {
+      return std::nullopt;
+    }
+    ntk.order.resize( order_size );
+    for ( auto& t : ntk.order )
+    {
+      if ( !read( offset, t ) )
+      {
+        return std::nullopt;
+      }
+    }
+    if ( !read( offset, num_qubits ) || !read( offset, num_gates ) )
+    {
+      return std::nullopt;
+    }
+
+    ntk.gates = gate_list( num_qubits );
+    uint64_t const words = ntk.gates.num_words();
+    if ( offset > length || num_gates * ( sizeof( uint32_t ) + sizeof( double ) + 2u * words * sizeof( uint64_t ) ) > length - offset )
+    {
+      return std::nullopt;
+    }
+    std::vector<uint32_t> targets( num_gates );
+    std::vector<double> angles( num_gates );
+    std::vector<uint64_t> positives( num_gates * words ), negatives( num_gates * words );
+    if ( !read_array( offset, targets ) || !read_array( offset, angles ) || !read_array( offset, positives ) || !read_array( offset, negatives ) )
+    {
+      return std::nullopt;
+    }
+    ntk.gates.reserve( num_gates );
+    for ( auto g = 0u; g < num_gates; ++g )
+    {
+      if ( targets[g] >= num_qubits )
+      {
+        return std::nullopt;
+      }
+      ntk.gates.add_gate( targets[g], angles[g], &positives[g * words], &negatives[g * words] );
+    }
+    return ntk;
+  }
+
+  static void encode( std::vector<uint8_t>& record, key_type const& key, network const& ntk )
+  {
+    auto const write = [&]( auto const& value ) {
+      auto const* p = reinterpret_cast<uint8_t const*>( &value );
+      record.insert( record.end(), p, p + sizeof( value ) );
+    };
+
+    write( static_cast<uint32_t>( key.num_vars() ) );
+    write( static_cast<uint32_t>( key.num_blocks() ) );
+    for ( auto const& w : key._bits )
+    {
+      write( w );
+    }
+    write( ntk.cnots_sqgs.first );
+    write( ntk.cnots_sqgs.second );
+    write( static_cast<uint32_t>( ntk.order.size() ) );
+    for ( auto const& t : ntk.order )
+    {
+      write( t );
+    }
+    auto const& gates = ntk.gates;
+    write( gates.num_qubits() );
+    write( static_cast<uint32_t>( gates.size() ) );
+    for ( auto g = 0u; g < gates.size(); ++g )
+    {
+      write( gates.target( g ) );
+    }
+    for ( auto g = 0u; g < gates.size(); ++g )
+    {
+      write( gates.angle( g ) );
+    }
+    for ( auto g = 0u; g < gates.size(); ++g )
+    {
+      for ( auto w = 0u; w < gates.num_words(); ++w )
+      {
+        write( gates.positive( g )[w] );
+      }
+    }
+    for ( auto g = 0u; g < gates.size(); ++g )
+    {
+      for ( auto w = 0u; w < gates.num_words(); ++w )
+      {
+        write( gates.negative( g )[w] );
+      }
+    }
+  }
+
+#ifdef ANGEL_HAS_MMAP
+  /* writes an empty cache to a temporary file and renames it over filename,
+     such that readers that still map the old file are not affected */
+  static bool create( std::string const& filename, uint64_t tag, uint64_t num_buckets )
+  {
+    auto const tmp = fmt::format( "{}.tmp.{}", filename, ::getpid() );
+    int const fd = ::open( tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 )
+    {
+      return false;
+    }
+
+    file_header h{};
+    std::memcpy( h.magic, magic, 8u );
+    h.version = format_version;
+    h.tag = tag;
+    h.num_buckets = std::max<uint64_t>( 1u, num_buckets );
+    h.data_end = bucket_offset( h.num_buckets );
+
+    bool ok = ::ftruncate( fd, h.data_end ) == 0 && ::pwrite( fd, &h, sizeof( h ), 0 ) == static_cast<ssize_t>( sizeof( h ) );
+    ::close( fd );
+    ok = ok && ::rename( tmp.c_str(), filename.c_str() ) == 0;
+    if ( !ok )
+    {
+      ::unlink( tmp.c_str() );
+    }
+    return ok;
+  }
+
+  /* writes size bytes at offset */
+  static bool write_all( int fd, void const* data, uint64_t size, uint64_t offset )
+  {
+    auto const* p = static_cast<uint8_t const*>( data );
+    while ( size > 0u )
+    {
+      auto const written = ::pwrite( fd, p, size, offset );
+      if ( written <= 0 )
+      {
+        return false;
+      }
+      p += written;
+      size -= written;
+      offset += written;
+    }
+    return true;
+  }
+
+  /* rebuilds the file with twice as many buckets in a temporary file, which
+     is locked before it is renamed over the old file, such that the writer
+     keeps exclusive access and readers of the old file are not affected */
+  bool grow()
+  {
+    auto const old_buckets = header()->num_buckets;
+    auto const new_buckets = 2u * old_buckets;
+    auto const data_begin = bucket_offset( old_buckets );
+    auto const data_size = header()->data_end - data_begin;
+    auto const shift = bucket_offset( new_buckets ) - data_begin;
+
+    std::vector<uint64_t> buckets( new_buckets, 0u );
+    for ( auto i = 0u; i < old_buckets; ++i )
+    {
+      auto const offset = bucket( i );
+      if ( offset == 0u )
+      {
+        continue;
+      }
+      auto const key = record_key( offset );
+      if ( !key )
+      {
+        return false;
+      }
+      auto index = hash( *key ) % new_buckets;
+      while ( buckets[index] != 0u )
+      {
+        index = ( index + 1u ) % new_buckets;
+      }
+      buckets[index] = offset + shift;
+    }
+
+    file_header h = *header();
+    h.num_buckets = new_buckets;
+    h.data_end = bucket_offset( new_buckets ) + data_size;
+
+    auto const tmp = fmt::format( "{}.tmp.{}", path, ::getpid() );
+    int const new_fd = ::open( tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( new_fd < 0 )
+    {
+      return false;
+    }
+    bool const ok = ::flock( new_fd, LOCK_EX | LOCK_NB ) == 0 && ::ftruncate( new_fd, h.data_end ) == 0 &&
+                    write_all( new_fd, &h, sizeof( h ), 0u ) &&
+                    write_all( new_fd, buckets.data(), buckets.size() * sizeof( uint64_t ), bucket_offset( 0u ) ) &&
+                    write_all( new_fd, base + data_begin, data_size, bucket_offset( new_buckets ) ) &&
+                    ::rename( tmp.c_str(), path.c_str() ) == 0;
+    if ( !ok )
+    {
+      ::close( new_fd );
+      ::unlink( tmp.c_str() );
+      return false;
+    }
+
+    ::munmap( base, length );
+    ::flock( fd, LOCK_UN );
+    ::close( fd );
+    base = nullptr;
+    fd = new_fd;
+    if ( !map( h.data_end ) )
+    {
+      close_unlocked();
+      return false;
+    }
+    return true;
+  }
+
+  enum class open_status
+  {
+    success,
+    failure,
+    locked
+  };
+
+  /* opens filename, for writing with an exclusive lock
+   *
+   * A writer that grows the file renames a new file over filename and then
+   * releases its lock on the old one.  If filename was opened before the
+   * rename, the lock on the orphaned old file may still be granted; the file
+   * is hence reopened until the locked file is the one named filename.
+   */
+  open_status open_mapping( std::string const& filename, bool write )
+  {
+    for ( auto attempt = 0u; ; ++attempt )
+    {
+      fd = ::open( filename.c_str(), write ? O_RDWR : O_RDONLY );
+      if ( fd < 0 )
+      {
+        return open_status::failure;
+      }
+      if ( !write )
+      {
+        break;
+      }
+      if ( ::flock( fd, LOCK_EX | LOCK_NB ) != 0 )
+      {
+        return open_status::locked;
+      }
+
+      struct stat locked, named;
+      if ( ::fstat( fd, &locked ) == 0 && ::stat( filename.c_str(), &named ) == 0 &&
+           locked.st_dev == named.st_dev && locked.st_ino == named.st_ino )
+      {
+        break;
+      }
+
+      /* replaced meanwhile, retry with the current file */
+      ::flock( fd, LOCK_UN );
+      ::close( fd );
+      fd = -1;
+      if ( attempt == max_open_attempts )
+      {
+        return open_status::locked;
+      }
+    }
+    writable = write;
+
+    struct stat sb;
+    if ( ::fstat( fd, &sb ) != 0 || sb.st_size == 0 )
+    {
+      return open_status::failure;
+    }
+    return map( static_cast<uint64_t>( sb.st_size ) ) ? open_status::success : open_status::failure;
+  }
+
+  bool map( uint64_t new_length )
+  {
+    void* p = ::mmap( nullptr, new_length, writable ? ( PROT_READ | PROT_WRITE ) : PROT_READ, MAP_SHARED, fd, 0 );
+    if ( p == MAP_FAILED )
+    {
+      return false;
+    }
+    base = static_cast<uint8_t*>( p );
+    length = new_length;
+    return true;
+  }
+
+  /* grows the file (geometrically) such that it holds at least size bytes */
+  bool reserve( uint64_t size )
+  {
+    if ( size <= length )
+    {
+      return true;
+    }
+    auto const new_length = std::max( size, 2u * length );
+    if ( ::ftruncate( fd, new_length ) != 0 )
+    {
+      return false;
+    }
+    ::munmap( base, length );
+    base = nullptr;
+    return map( new_length );
+  }
+#endif
+
+  void close_unlocked()
+  {
+#ifdef ANGEL_HAS_MMAP
+    if ( base )
+    {
+      ::munmap( base, length );
+    }
+    if ( fd >= 0 )
+    {
+      if ( writable )
+      {
+        ::flock( fd, LOCK_UN );
+      }
+      ::close( fd );
+    }
+#endif
+    base = nullptr;
+    length = 0u;
+    fd = -1;
+    writable = false;
+  }
+
+private:
+  mutable std::shared_mutex mutex;
+  std::string path;
+  int fd{-1};
+  uint8_t* base{nullptr};
+  uint64_t length{0};
+  bool writable{false};
+  uint64_t num_failed{0};
+};
+
+} // namespace angel
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "mc_qg_generation.hpp"
+#include "synthesis_cache.hpp"
 #include "utils.hpp"
 #include <angel/dependency_analysis/common.hpp>
+#include <angel/reordering/reordering_batch.hpp>
 #include <angel/utils/helper_functions.hpp>
+#include <angel/utils/parallel_for.hpp>
 #include <angel/utils/stopwatch.hpp>
 
 #include <kitty/dynamic_truth_table.hpp>
@@ -10,16 +14,23 @@
 #include <kitty/hash.hpp>
 #include <fmt/format.h>
 
+#include <atomic>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace angel
 {
 using pattern_based_dependencies_t = std::map<uint32_t, dependency_analysis_types::pattern>;
 using esop_based_dependencies_t = std::map<uint32_t, std::vector<std::vector<uint32_t>>>;
-using gates_t = std::map<uint32_t, std::vector<std::pair<double, std::vector<uint32_t>>>>;
 using order_t = std::vector<uint32_t>;
 
 // std::string const filename1 = fmt::format("qsp_cut_functions_ISCAS_8.txt");
@@ -91,436 +102,27 @@ struct qsp_general_stats
 
 
 /* with esop based dependencies */
-void MC_qg_generation( gates_t& gates, uint32_t num_vars, kitty::dynamic_truth_table tt, uint32_t var_index, std::vector<uint32_t> controls,
-                       esop_based_dependencies_t dependencies, std::vector<uint32_t> zero_lines, std::vector<uint32_t> one_lines )
+inline void MC_qg_generation( gate_list& gates, uint32_t num_vars, kitty::dynamic_truth_table const& tt, uint32_t var_index, std::vector<uint32_t> const& controls,
+                              esop_based_dependencies_t const& dependencies, std::vector<uint32_t> const& zero_lines, std::vector<uint32_t> const& one_lines )
 {
-  /*-----co factors-------*/
-  kitty::dynamic_truth_table tt0( var_index );
-  kitty::dynamic_truth_table tt1( var_index );
-
-  tt0 = kitty::shrink_to( kitty::cofactor0( tt, var_index ), var_index );
-  tt1 = kitty::shrink_to( kitty::cofactor1( tt, var_index ), var_index );
-
-  /*--computing probability gate---*/
-  auto c0_ones = kitty::count_ones( tt0 );
-  auto c1_ones = kitty::count_ones( tt1 );
-  auto tt_ones = kitty::count_ones( tt );
-  bool is_const = 0;
-  auto it0 = std::find( zero_lines.begin(), zero_lines.end(), var_index );
-  auto it1 = std::find( one_lines.begin(), one_lines.end(), var_index );
-  if ( it1 != one_lines.end() ) // insert not gate
-  {
-    if ( gates.find( var_index ) == gates.end() )
-    {
-      gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{}} );
-    }
-    is_const = 1;
-  }
-  else if ( it0 != zero_lines.end() ) // inzert zero gate
-  {
-    is_const = 1;
-  }
-  else if ( c0_ones != tt_ones )
-  { /* == --> identity and ignore */
-    double angle = 2 * acos( sqrt( static_cast<double>( c0_ones ) / tt_ones ) );
-    //angle *= (180/3.14159265); //in degree
-    /*----add probability gate----*/
-    auto it = dependencies.find( var_index );
-    bool deps_useful = false;
-    if ( it != dependencies.end() )
-    {
-      auto const esop_cnots = esop_gate_cost( dependencies[var_index] ).first;
-      auto const upperbound_cost = compute_upperbound_cost( zero_lines, one_lines, num_vars, var_index );
-      if ( esop_cnots <= upperbound_cost )
-      {
-        deps_useful = true;
-      }
-    }
-
-    if ( gates[var_index].size() == 0 && deps_useful )
-    {
-      for ( auto const& inner : dependencies[var_index] )
-      {
-        gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{inner}} );
-      }
-    }
-
-    else if(!deps_useful)
-    {
-        gates[var_index].emplace_back( std::pair{angle, controls} );
-    }
-  }
-
-  /*-----qc of cofactors-------*/
-  /*---check state---*/
-  auto c0_allone = ( c0_ones == pow( 2, tt0.num_vars() ) ) ? true : false;
-  auto c0_allzero = ( c0_ones == 0 ) ? true : false;
-  auto c1_allone = ( c1_ones == pow( 2, tt1.num_vars() ) ) ? true : false;
-  auto c1_allzero = ( c1_ones == 0 ) ? true : false;
-
-  std::vector<uint32_t> controls_new0;
-  std::copy( controls.begin(), controls.end(), back_inserter( controls_new0 ) );
-  if ( dependencies.find( var_index ) == dependencies.end() && !is_const )
-  {
-    auto ctrl0 = var_index * 2 + 1; /* negetive control: /2 ---> index %2 ---> sign */
-    controls_new0.emplace_back( ctrl0 );
-  }
-  std::vector<uint32_t> controls_new1;
-  std::copy( controls.begin(), controls.end(), back_inserter( controls_new1 ) );
-  if ( dependencies.find( var_index ) == dependencies.end() && !is_const )
-  {
-    auto ctrl1 = var_index * 2 + 0; /* positive control: /2 ---> index %2 ---> sign */
-    controls_new1.emplace_back( ctrl1 );
-  }
-
-  if ( c0_allone )
-  {
-    /*---add H gates---*/
-    for ( auto i = 0u; i < var_index; i++ )
-      gates[i].emplace_back( std::pair{M_PI / 2, controls_new0} );
-    /*--check one cofactor----*/
-    if ( c1_allone )
-    {
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      return;
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, num_vars, tt1, var_index - 1, controls_new1, dependencies, zero_lines, one_lines );
-    }
-  }
-  else if ( c0_allzero )
-  {
-    /*--check one cofactor----*/
-    if ( c1_allone )
-    {
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      return;
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, num_vars, tt1, var_index - 1, controls_new1, dependencies, zero_lines, one_lines );
-    }
-  }
-  else
-  { /* some 0 some 1 for c0 */
-    if ( c1_allone )
-    {
-      MC_qg_generation( gates, num_vars, tt0, var_index - 1, controls_new0, dependencies, zero_lines, one_lines );
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      MC_qg_generation( gates, num_vars, tt0, var_index - 1, controls_new0, dependencies, zero_lines, one_lines );
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, num_vars, tt0, var_index - 1, controls_new0, dependencies, zero_lines, one_lines );
-      MC_qg_generation( gates, num_vars, tt1, var_index - 1, controls_new1, dependencies, zero_lines, one_lines );
-    }
-  }
+  mc_qg_generator<esop_based_dependencies_t> generator;
+  generator( gates, num_vars, tt, var_index, controls, dependencies, zero_lines, one_lines );
 }
 
 /* with pattern based dependencies */
-void MC_qg_generation( gates_t& gates, uint32_t num_vars, kitty::dynamic_truth_table tt, uint32_t var_index, std::vector<uint32_t> controls,
-                       pattern_based_dependencies_t dependencies, std::vector<uint32_t> zero_lines, std::vector<uint32_t> one_lines )
+inline void MC_qg_generation( gate_list& gates, uint32_t num_vars, kitty::dynamic_truth_table const& tt, uint32_t var_index, std::vector<uint32_t> const& controls,
+                              pattern_based_dependencies_t const& dependencies, std::vector<uint32_t> const& zero_lines, std::vector<uint32_t> const& one_lines )
 {
-  /*-----co factors-------*/
-  kitty::dynamic_truth_table tt0( var_index );
-  kitty::dynamic_truth_table tt1( var_index );
-
-  tt0 = kitty::shrink_to( kitty::cofactor0( tt, var_index ), var_index );
-  tt1 = kitty::shrink_to( kitty::cofactor1( tt, var_index ), var_index );
-
-  /*--computing probability gate---*/
-  auto c0_ones = kitty::count_ones( tt0 );
-  auto c1_ones = kitty::count_ones( tt1 );
-  auto tt_ones = kitty::count_ones( tt );
-  bool is_const = 0;
-  auto it0 = std::find( zero_lines.begin(), zero_lines.end(), var_index );
-  auto it1 = std::find( one_lines.begin(), one_lines.end(), var_index );
-  if ( it1 != one_lines.end() ) // insert not gate
-  {
-    if ( gates.find( var_index ) == gates.end() )
-    {
-      gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{}} );
-    }
-    is_const = 1;
-  }
-  else if ( it0 != zero_lines.end() ) // inzert zero gate
-  {
-    is_const = 1;
-  }
-  else if ( c0_ones != tt_ones )
-  { /* == --> identity and ignore */
-    double angle = 2 * acos( sqrt( static_cast<double>( c0_ones ) / tt_ones ) );
-    //angle *= (180/3.14159265); //in degree
-    /*----add probability gate----*/
-    auto it = dependencies.find( var_index );
-
-    if ( it != dependencies.end() )
-    {
-      if ( gates[var_index].size() == 0 )
-      {
-
-        if ( dependencies[var_index].first == dependency_analysis_types::pattern_kind::EQUAL )
-        {
-          if ( dependencies[var_index].second[0] % 2 == 0 ) /* equal operation */
-          {
-            gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{dependencies[var_index].second}} );
-          }
-          else /* not operation */
-          {
-            gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{dependencies[var_index].second}} );
-            gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{}} );
-          }
-        }
-
-        else if ( dependencies[var_index].first == dependency_analysis_types::pattern_kind::XOR )
-        {
-          for ( auto d_in = 0u; d_in < dependencies[var_index].second.size(); d_in++ )
-          {
-              gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{dependencies[var_index].second[d_in]}} );
-          }
-        }
-
-        else if ( dependencies[var_index].first == dependency_analysis_types::pattern_kind::XNOR )
-        {
-          for ( auto d_in = 0u; d_in < dependencies[var_index].second.size(); d_in++ )
-          {
-              gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{dependencies[var_index].second[d_in]}} );
-          }
-          gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{}} );
-        }
-
-        else if ( dependencies[var_index].first == dependency_analysis_types::pattern_kind::AND )
-        {
-          gates[var_index].emplace_back( std::pair{M_PI, dependencies[var_index].second} ); /// insert and
-        }
-
-        else if ( dependencies[var_index].first == dependency_analysis_types::pattern_kind::NAND )
-        {
-          gates[var_index].emplace_back( std::pair{M_PI, dependencies[var_index].second} ); /// insert and
-          gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{}} ); /// insert not for and
-        }
-      }
-    }
-
-    else
-      gates[var_index].emplace_back( std::pair{angle, controls} );
-  }
-
-  /*-----qc of cofactors-------*/
-  /*---check state---*/
-  auto c0_allone = ( c0_ones == pow( 2, tt0.num_vars() ) ) ? true : false;
-  auto c0_allzero = ( c0_ones == 0 ) ? true : false;
-  auto c1_allone = ( c1_ones == pow( 2, tt1.num_vars() ) ) ? true : false;
-  auto c1_allzero = ( c1_ones == 0 ) ? true : false;
-
-  std::vector<uint32_t> controls_new0;
-  std::copy( controls.begin(), controls.end(), back_inserter( controls_new0 ) );
-  if ( dependencies.find( var_index ) == dependencies.end() && !is_const )
-  {
-    auto ctrl0 = var_index * 2 + 1; /* negetive control: /2 ---> index %2 ---> sign */
-    controls_new0.emplace_back( ctrl0 );
-  }
-  std::vector<uint32_t> controls_new1;
-  std::copy( controls.begin(), controls.end(), back_inserter( controls_new1 ) );
-  if ( dependencies.find( var_index ) == dependencies.end() && !is_const )
-  {
-    auto ctrl1 = var_index * 2 + 0; /* positive control: /2 ---> index %2 ---> sign */
-    controls_new1.emplace_back( ctrl1 );
-  }
-
-  if ( c0_allone )
-  {
-    /*---add H gates---*/
-    for ( auto i = 0u; i < var_index; i++ )
-      gates[i].emplace_back( std::pair{M_PI / 2, controls_new0} );
-    /*--check one cofactor----*/
-    if ( c1_allone )
-    {
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      return;
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, num_vars, tt1, var_index - 1, controls_new1, dependencies, zero_lines, one_lines );
-    }
-  }
-  else if ( c0_allzero )
-  {
-    /*--check one cofactor----*/
-    if ( c1_allone )
-    {
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      return;
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, num_vars, tt1, var_index - 1, controls_new1, dependencies, zero_lines, one_lines );
-    }
-  }
-  else
-  { /* some 0 some 1 for c0 */
-    if ( c1_allone )
-    {
-      MC_qg_generation( gates, num_vars, tt0, var_index - 1, controls_new0, dependencies, zero_lines, one_lines );
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      MC_qg_generation( gates, num_vars, tt0, var_index - 1, controls_new0, dependencies, zero_lines, one_lines );
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, num_vars, tt0, var_index - 1, controls_new0, dependencies, zero_lines, one_lines );
-      MC_qg_generation( gates, num_vars, tt1, var_index - 1, controls_new1, dependencies, zero_lines, one_lines );
-    }
-  }
+  mc_qg_generator<pattern_based_dependencies_t> generator;
+  generator( gates, num_vars, tt, var_index, controls, dependencies, zero_lines, one_lines );
 }
 
 /* without dependencies */
-void MC_qg_generation( gates_t& gates, kitty::dynamic_truth_table tt, uint32_t var_index, std::vector<uint32_t> controls,
-                       std::vector<uint32_t> zero_lines, std::vector<uint32_t> one_lines )
+inline void MC_qg_generation( gate_list& gates, kitty::dynamic_truth_table const& tt, uint32_t var_index, std::vector<uint32_t> const& controls,
+                              std::vector<uint32_t> const& zero_lines, std::vector<uint32_t> const& one_lines )
 {
-  /*-----co factors-------*/
-  kitty::dynamic_truth_table tt0( var_index );
-  kitty::dynamic_truth_table tt1( var_index );
-
-  tt0 = kitty::shrink_to( kitty::cofactor0( tt, var_index ), var_index );
-  tt1 = kitty::shrink_to( kitty::cofactor1( tt, var_index ), var_index );
-
-  /*--computing probability gate---*/
-  auto c0_ones = kitty::count_ones( tt0 );
-  auto c1_ones = kitty::count_ones( tt1 );
-  auto tt_ones = kitty::count_ones( tt );
-  bool is_const = 0;
-  auto it0 = std::find( zero_lines.begin(), zero_lines.end(), var_index );
-  auto it1 = std::find( one_lines.begin(), one_lines.end(), var_index );
-  if ( it1 != one_lines.end() ) // insert not gate
-  {
-    if ( gates.find( var_index ) == gates.end() )
-      gates[var_index].emplace_back( std::pair{M_PI, std::vector<uint32_t>{}} );
-    is_const = 1;
-  }
-  else if ( it0 != zero_lines.end() ) // inzert zero gate
-  {
-    is_const = 1;
-  }
-  else if ( c0_ones != tt_ones )
-  { /* == --> identity and ignore */
-    double angle = 2 * acos( sqrt( static_cast<double>( c0_ones ) / tt_ones ) );
-    //angle *= (180/3.14159265); //in degree
-    /*----add probability gate----*/
-
-    gates[var_index].emplace_back( std::pair{angle, controls} );
-  }
-
-  /*-----qc of cofactors-------*/
-  /*---check state---*/
-  auto c0_allone = ( c0_ones == pow( 2, tt0.num_vars() ) ) ? true : false;
-  auto c0_allzero = ( c0_ones == 0 ) ? true : false;
-  auto c1_allone = ( c1_ones == pow( 2, tt1.num_vars() ) ) ? true : false;
-  auto c1_allzero = ( c1_ones == 0 ) ? true : false;
-
-  std::vector<uint32_t> controls_new0;
-  std::copy( controls.begin(), controls.end(), back_inserter( controls_new0 ) );
-  if ( !is_const )
-  {
-    auto ctrl0 = var_index * 2 + 1; /* negetive control: /2 ---> index %2 ---> sign */
-    controls_new0.emplace_back( ctrl0 );
-  }
-  std::vector<uint32_t> controls_new1;
-  std::copy( controls.begin(), controls.end(), back_inserter( controls_new1 ) );
-  if ( !is_const )
-  {
-    auto ctrl1 = var_index * 2 + 0; /* positive control: /2 ---> index %2 ---> sign */
-    controls_new1.emplace_back( ctrl1 );
-  }
-
-  if ( c0_allone )
-  {
-    /*---add H gates---*/
-    for ( auto i = 0u; i < var_index; i++ )
-      gates[i].emplace_back( std::pair{M_PI / 2, controls_new0} );
-    /*--check one cofactor----*/
-    if ( c1_allone )
-    {
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      return;
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, tt1, var_index - 1, controls_new1, zero_lines, one_lines );
-    }
-  }
-  else if ( c0_allzero )
-  {
-    /*--check one cofactor----*/
-    if ( c1_allone )
-    {
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      return;
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, tt1, var_index - 1, controls_new1, zero_lines, one_lines );
-    }
-  }
-  else
-  { /* some 0 some 1 for c0 */
-    if ( c1_allone )
-    {
-      MC_qg_generation( gates, tt0, var_index - 1, controls_new0, zero_lines, one_lines );
-      /*---add H gates---*/
-      for ( auto i = 0u; i < var_index; i++ )
-        gates[i].emplace_back( std::pair{M_PI / 2, controls_new1} );
-    }
-    else if ( c1_allzero )
-    {
-      MC_qg_generation( gates, tt0, var_index - 1, controls_new0, zero_lines, one_lines );
-    }
-    else
-    { /* some 1 some 0 */
-      MC_qg_generation( gates, tt0, var_index - 1, controls_new0, zero_lines, one_lines );
-      MC_qg_generation( gates, tt1, var_index - 1, controls_new1, zero_lines, one_lines );
-    }
-  }
+  mc_qg_generator<esop_based_dependencies_t> generator;
+  generator( gates, var_index + 1u, tt, var_index, controls, {}, zero_lines, one_lines );
 }
 
 /**
@@ -539,29 +141,178 @@ struct state_preparation_parameters
 {
   bool verbose{false};
   bool use_upperbound{true};
+
+  /* prepare lines that equal or complement a line above them (see `extract_independent_vars`)
+     with a CNOT (and a NOT) unless the dependency analysis found a dependency for them */
+  bool use_duplicate_lines{true};
+
+  /* memory-mapped cache file shared across runs (empty = no file) */
+  std::string cache_file;
+  /* open the cache file without appending new entries */
+  bool cache_read_only{false};
+  /* initial number of hash buckets of a new cache file (doubled whenever it is 3/4 full) */
+  uint64_t cache_file_buckets{1u << 16u};
+  /* additional configuration that invalidates cached entries when changed (the
+     strategy parameters are covered by the `fingerprint()` of the strategies) */
+  std::string cache_tag;
+
+  /* second cache tier keyed on the NP (input negation and permutation) class;
+     hits are replayed with additional NOT gates */
+  bool use_np_cache{false};
+
+  /* memory budget of the in-memory cache in bytes (0 = unbounded); entries
+     are evicted by recency and synthesis time, see `synthesis_cache` */
+  uint64_t cache_byte_budget{0};
+
+  /* number of threads that cost reordering candidates (0 = hardware concurrency);
+     used with strategies that provide `foreach_reordering_batch` */
+  uint32_t num_reordering_threads{1};
+
+  /* number of candidates enumerated before they are costed in parallel */
+  uint32_t reordering_batch_size{256};
+
+  /* maximum number of candidate costs remembered per function (0 = no memo);
+     candidates that the reordering strategy passes again are not costed again */
+  uint64_t candidate_memo_capacity{1u << 16u};
 }; 
 
 struct state_preparation_statistics
 {
   uint64_t num_functions{0};
   uint64_t num_unique_functions{0};
+  uint64_t num_p_hits{0};
+  uint64_t num_np_hits{0};
+  uint64_t num_file_hits{0};
   uint64_t num_cnots{0};
   uint64_t num_sqgs{0};
+  /* state of the cache after the last function (cumulative over all its users) */
+  uint64_t num_evictions{0};
+  uint64_t resident_bytes{0};
+  /* networks that could not be appended to the cache file */
+  uint64_t num_file_insert_failures{0};
+  /* reordering candidates, and those abandoned once their CNOT cost reached the best cost so far */
+  uint64_t num_candidates{0};
+  uint64_t num_pruned_candidates{0};
+  /* candidates passed again by the reordering strategy and answered from the per-function memo */
+  uint64_t num_memo_hits{0};
+  stopwatch<>::duration_type time_p_canonization{0};
+  stopwatch<>::duration_type time_np_canonization{0};
   stopwatch<>::duration_type time_cache{0};
   stopwatch<>::duration_type time_total{0};
+  /* time spent on costing completed and pruned candidates */
+  stopwatch<>::duration_type time_completed_candidates{0};
+  stopwatch<>::duration_type time_pruned_candidates{0};
+
+  void report( std::ostream& os = std::cout ) const
+  {
+    auto const ratio = [&]( uint64_t hits ) { return num_functions ? ( 100.0 * hits ) / num_functions : 0.0; };
+    os << fmt::format( "[i] functions = {} unique = {}\n", num_functions, num_unique_functions );
+    os << fmt::format( "[i] cache hits: P = {} ({:5.2f}%) NP = {} ({:5.2f}%) file = {}\n",
+                       num_p_hits, ratio( num_p_hits ), num_np_hits, ratio( num_np_hits ), num_file_hits );
+    os << fmt::format( "[i] cache: hit ratio = {:5.2f}% evictions = {} resident = {:.2f} MB file insert failures = {}\n",
+                       100.0 * hit_ratio(), num_evictions, resident_bytes / ( 1024.0 * 1024.0 ), num_file_insert_failures );
+    os << fmt::format( "[i] synthesis result: CNOTs / SQgates = {} / {}\n", num_cnots, num_sqgs );
+    os << fmt::format( "[i] candidates = {} pruned = {} (est. time saved = {:8.2f}s) memo hits = {}\n",
+                       num_candidates, num_pruned_candidates, to_seconds( time_saved_by_pruning() ), num_memo_hits );
+    os << fmt::format( "[i] canonization time: P = {:8.2f}s NP = {:8.2f}s\n", to_seconds( time_p_canonization ), to_seconds( time_np_canonization ) );
+    os << fmt::format( "[i] cache time = {:8.2f}s total time = {:8.2f}s\n", to_seconds( time_cache ), to_seconds( time_total ) );
+  }
+
+  /* fraction of functions answered from the cache (any tier) */
+  double hit_ratio() const
+  {
+    return num_functions ? static_cast<double>( num_p_hits + num_np_hits ) / num_functions : 0.0;
+  }
+
+  /* estimated time that pruned candidates would have needed to complete */
+  stopwatch<>::duration_type time_saved_by_pruning() const
+  {
+    auto const num_completed = num_candidates - num_pruned_candidates;
+    if ( num_completed == 0u )
+    {
+      return stopwatch<>::duration_type{0};
+    }
+    auto const estimated = time_completed_candidates / static_cast<int64_t>( num_completed ) * static_cast<int64_t>( num_pruned_candidates );
+    return std::max( estimated - time_pruned_candidates, stopwatch<>::duration_type{0} );
+  }
 
   void reset()
   {
     *this = {};
   }
+
+  /* accumulates the statistics of another (e.g., per-thread) run */
+  void merge( state_preparation_statistics const& other )
+  {
+    num_functions += other.num_functions;
+    num_unique_functions += other.num_unique_functions;
+    num_p_hits += other.num_p_hits;
+    num_np_hits += other.num_np_hits;
+    num_file_hits += other.num_file_hits;
+    num_cnots += other.num_cnots;
+    num_sqgs += other.num_sqgs;
+    /* snapshots of a possibly shared cache */
+    num_evictions = std::max( num_evictions, other.num_evictions );
+    resident_bytes = std::max( resident_bytes, other.resident_bytes );
+    num_file_insert_failures = std::max( num_file_insert_failures, other.num_file_insert_failures );
+    num_candidates += other.num_candidates;
+    num_pruned_candidates += other.num_pruned_candidates;
+    num_memo_hits += other.num_memo_hits;
+    time_p_canonization += other.time_p_canonization;
+    time_np_canonization += other.time_np_canonization;
+    time_cache += other.time_cache;
+    time_total += other.time_total;
+    time_completed_candidates += other.time_completed_candidates;
+    time_pruned_candidates += other.time_pruned_candidates;
+  }
 }; 
 
-struct network
+namespace detail
+{
+
+template<class Strategy, class = void>
+struct has_fingerprint : std::false_type
 {
-  gates_t gates;
-  std::pair<uint32_t, uint32_t> cnots_sqgs;
 };
 
+template<class Strategy>
+struct has_fingerprint<Strategy, std::void_t<decltype( std::declval<Strategy const&>().fingerprint() )>> : std::true_type
+{
+};
+
+/* adds the EQUAL/NOT dependencies of duplicate lines that have no dependency yet */
+template<class Dependencies>
+void add_duplicate_lines( Dependencies& dependencies, std::vector<std::pair<uint32_t, uint32_t>> const& duplicate_lines )
+{
+  for ( auto const& [line, literal] : duplicate_lines )
+  {
+    if constexpr ( std::is_same_v<typename Dependencies::mapped_type, dependency_analysis_types::pattern> )
+    {
+      dependencies.emplace( line, dependency_analysis_types::pattern{dependency_analysis_types::pattern_kind::EQUAL, {literal}} );
+    }
+    else
+    {
+      dependencies.emplace( line, std::vector<std::vector<uint32_t>>{{literal}} );
+    }
+  }
+}
+
+/* parameters of a strategy that affect the synthesized networks (empty if it does not tell) */
+template<class Strategy>
+std::string strategy_fingerprint( Strategy const& strategy )
+{
+  if constexpr ( has_fingerprint<Strategy>::value )
+  {
+    return strategy.fingerprint();
+  }
+  else
+  {
+    (void)strategy;
+    return {};
+  }
+}
+
+} // namespace detail
 
 /**
  * \breif Quantum State Preparation using Functional Dependency
@@ -577,6 +328,7 @@ class qsp_deps
 public:
   using dependency_params = typename DependencyAnalysisStrategy::parameter_type;
   using dependency_stats = typename DependencyAnalysisStrategy::statistics_type;
+  using dependencies_t = std::decay_t<decltype( std::declval<typename DependencyAnalysisStrategy::result_type>().dependencies )>;
 
 public:
   explicit qsp_deps(Network& ntk, DependencyAnalysisStrategy& dependency_strategy, ReorderingStrategy& order_strategy,
@@ -586,10 +338,99 @@ public:
     , order_strategy( order_strategy )
     , ps( ps )
     , st( st )
+    , local_cache( 1u, ps.cache_byte_budget ) /* not shared, a single shard keeps the whole budget usable */
+    , cache( local_cache )
+  {
+    if ( !ps.cache_file.empty() )
+    {
+      auto const mode = ps.cache_read_only ? persistent_cache_mode::read_only : persistent_cache_mode::read_write;
+      if ( !local_cache.open_file( ps.cache_file, mode, cost_model_tag(), ps.cache_file_buckets ) && ps.verbose )
+      {
+        fmt::print( "[w] could not open cache file {}\n", ps.cache_file );
+      }
+    }
+  }
+
+  /*! \brief Constructs a state preparation engine that uses an external (possibly shared) cache.
+   *
+   * The cache file and memory budget parameters are ignored, they are
+   * properties of `cache`.
+   */
+  explicit qsp_deps(Network& ntk, DependencyAnalysisStrategy& dependency_strategy, ReorderingStrategy& order_strategy,
+                              state_preparation_parameters const& ps, state_preparation_statistics& st, synthesis_cache& cache )
+    : ntk(ntk)
+    , dependency_strategy( dependency_strategy )
+    , order_strategy( order_strategy )
+    , ps( ps )
+    , st( st )
+    , cache( cache )
+  {
+  }
+
+  /*! \brief Tag of the cost model under which networks are cached.
+   *
+   * The tag covers the types and the `fingerprint()` of both strategies, if
+   * they provide one, `use_upperbound`, `use_duplicate_lines`, and `cache_tag`.  Cache files written
+   * with a different tag are rejected.  Use this tag when attaching a cache
+   * file to a shared `synthesis_cache`.
+   */
+  static uint64_t cost_model_tag( DependencyAnalysisStrategy const& dependency, ReorderingStrategy const& reordering, state_preparation_parameters const& ps )
   {
+    return persistent_cache_tag( fmt::format( "{}|{}|{}|{}|{}|{}|{}", typeid( DependencyAnalysisStrategy ).name(), detail::strategy_fingerprint( dependency ),
+                                              typeid( ReorderingStrategy ).name(), detail::strategy_fingerprint( reordering ), ps.use_upperbound,
+                                              ps.use_duplicate_lines, ps.cache_tag ) );
+  }
+
+  /*! \brief Tag of the cost model of this engine. */
+  uint64_t cost_model_tag() const
+  {
+    return cost_model_tag( dependency_strategy, order_strategy, ps );
+  }
+
+  /*! \brief Keys of a function in the cache tiers. */
+  struct cache_keys
+  {
+    /* P-canonical truth table; canonical variable i is variable from_canonical[i] of the function */
+    kitty::dynamic_truth_table p_tt;
+    std::vector<uint32_t> from_canonical;
+
+    /* NP-canonical truth table (if `use_np_cache`): canonical variable i is variable np_perm[i] of the function,
+       complemented if bit np_perm[i] of np_phase is set */
+    std::optional<std::tuple<kitty::dynamic_truth_table, uint32_t, std::vector<uint8_t>>> np_key;
+  };
+
+  /*! \brief Canonizes a function for the cache tiers. */
+  cache_keys keys( kitty::dynamic_truth_table const& tt )
+  {
+    stopwatch t( st.time_total );
+    uint32_t const num_variables = tt.num_vars();
+
+    cache_keys result;
+    call_with_stopwatch( st.time_cache, [&]{
+        stopwatch t_canon( st.time_p_canonization );
+        auto const [key_tt, _1, key_perm] = num_variables <= 7u ? kitty::exact_p_canonization( tt ) : kitty::sifting_p_canonization( tt );
+        result.p_tt = key_tt;
+        result.from_canonical.assign( std::begin( key_perm ), std::end( key_perm ) );
+      });
+
+    if ( ps.use_np_cache )
+    {
+      result.np_key = call_with_stopwatch( st.time_cache, [&]{
+          stopwatch t_canon( st.time_np_canonization );
+          return np_semi_canonization( tt );
+        });
+    }
+    return result;
   }
 
   network operator()( kitty::dynamic_truth_table const& tt )
+  {
+    auto const function_keys = keys( tt );
+    return ( *this )( tt, function_keys );
+  }
+
+  /*! \brief Prepares the state of `tt` given its `keys( tt )`. */
+  network operator()( kitty::dynamic_truth_table const& tt, cache_keys const& function_keys )
   {
     stopwatch t( st.time_total );
     uint32_t const num_variables = tt.num_vars();
@@ -597,43 +438,105 @@ public:
     ++st.num_functions;
 
     /* check if there is a network in the cache for this truth table */
-    auto const [key_tt, _1, _2] = call_with_stopwatch( st.time_cache, [&]{
-        return num_variables <= 7u ? kitty::exact_p_canonization( tt ) : kitty::sifting_p_canonization( tt );
-      });
-    auto const it = cache.find( key_tt );
-    if ( it != std::end( cache ) )
+    auto const& key_tt = function_keys.p_tt;
+    auto const& from_canonical = function_keys.from_canonical;
+    if ( auto const cached = lookup( key_tt ) )
     {
-      network empty;
-      return empty;
-      
-      st.num_cnots += it->second.cnots_sqgs.first;
-      if ( ps.verbose )
+      ++st.num_p_hits;
+      return replay( tt, *cached, from_canonical, 0u );
+    }
+
+    /* check the NP tier */
+    auto const& np_key = function_keys.np_key;
+    if ( np_key )
+    {
+      auto const& [np_tt, np_phase, np_perm] = *np_key;
+      if ( auto const cached = lookup( np_tt ) )
       {
-        fmt::print( "cached function = {} cnots = {}\n", kitty::to_hex( tt ), it->second.cnots_sqgs.first );
+        ++st.num_np_hits;
+        return replay( tt, *cached, std::vector<uint32_t>( std::begin( np_perm ), std::end( np_perm ) ), np_phase );
       }
-      return it->second;
     }
     
     /* run state preparation for the current truth table */
     std::pair<uint32_t, uint32_t> upperbound = {uint64_t( pow( 2u, num_variables ) - 2u ), uint64_t( pow( 2u, num_variables ) - 1u )};
     std::pair<uint32_t, uint32_t> max = {std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max()};
     std::pair<uint32_t, uint32_t> const ub = ps.use_upperbound ? upperbound : max;
-    network best_ntk{{},ub};
-    order_strategy.foreach_reordering( tt, [this,&best_ntk]( kitty::dynamic_truth_table const& tt ){
-        network ntk = synthesize_network( tt );
-        //print_gates(ntk.gates);
-        
-        if ( ntk.cnots_sqgs.first < best_ntk.cnots_sqgs.first )
+    network best_ntk{gate_list( num_variables ), ub};
+    stopwatch<>::duration_type time_synthesis{0};
+    {
+      stopwatch t_synthesis( time_synthesis );
+
+      /* candidates are only costed, the gates are generated for the best one;
+         a candidate is abandoned once it cannot improve on the best cost */
+      std::optional<kitty::dynamic_truth_table> best_tt;
+      dependencies_t best_dependencies;
+      candidate_memo.clear();
+      bool evaluated = false;
+      if constexpr ( has_foreach_reordering_batch_v<ReorderingStrategy> )
+      {
+        if ( resolve_num_threads( ps.num_reordering_threads, ps.reordering_batch_size ) > 1u )
         {
-          best_ntk = ntk;
+          evaluate_candidates_in_parallel( tt, best_ntk.cnots_sqgs, best_tt, best_dependencies );
+          evaluated = true;
         }
-        return ntk.cnots_sqgs.first ;
-      });
+      }
+
+      if ( !evaluated )
+      {
+        auto const initial_cost = ps.use_upperbound ? std::optional<uint32_t>( ub.first ) : std::nullopt;
+        order_strategy.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& tt ){
+            if ( auto const cost = recall_candidate( tt ) )
+            {
+              return *cost;
+            }
+
+            auto const bound = best_ntk.cnots_sqgs.first;
+            stopwatch<>::duration_type time_candidate{0};
+            auto const cost = call_with_stopwatch( time_candidate, [&]{ return synthesis_cost( tt, bound ); } );
+            remember_candidate( tt, cost.first );
+            if ( !count_candidate( st, cost, bound, time_candidate ) )
+            {
+              return cost.first;
+            }
+
+            best_ntk.cnots_sqgs = cost;
+            best_tt = tt;
+            std::swap( best_dependencies, candidate_dependencies );
+            return cost.first;
+          }, initial_cost );
+      }
+
+      if ( best_tt )
+      {
+        best_ntk = kitty::is_const0( *best_tt ) ? network{gate_list( num_variables ), std::make_pair( 0u, 0u )} : create_gates( *best_tt, best_dependencies );
+      }
+    }
     /* ensure that re-ordering has been exectued at least once */
     assert( best_ntk.cnots_sqgs.first < std::numeric_limits<uint64_t>::max() );
 
-    /* insert result into cache */
-    cache.emplace( key_tt, best_ntk );
+    /* insert result into cache (in canonical variable order) */
+    call_with_stopwatch( st.time_cache, [&]{
+        std::vector<uint32_t> to_canonical( num_variables );
+        for ( auto i = 0u; i < num_variables; ++i )
+        {
+          to_canonical[from_canonical[i]] = i;
+        }
+        cache.insert( key_tt, remap_network( best_ntk, to_canonical ), to_seconds( time_synthesis ) );
+
+        if ( np_key )
+        {
+          auto const& [np_tt, np_phase, np_perm] = *np_key;
+          uint32_t negations{0u};
+          for ( auto i = 0u; i < num_variables; ++i )
+          {
+            to_canonical[np_perm[i]] = i;
+            negations |= ( ( np_phase >> np_perm[i] ) & 1u ) << i;
+          }
+          cache.insert( np_tt, remap_network( best_ntk, to_canonical, negations ), to_seconds( time_synthesis ) );
+        }
+      });
+    update_cache_statistics();
     if ( ps.verbose )
     {
       fmt::print( "unique function = {} cnots = {}\n", kitty::to_hex( tt ), best_ntk.cnots_sqgs.first );
@@ -651,7 +554,7 @@ public:
     /* FIXME: treat const0 as a special case */
     if ( kitty::is_const0( tt ) )
     {
-      return network{{}, std::make_pair(0u, 0u)};
+      return network{gate_list( tt.num_vars() ), std::make_pair(0u, 0u)};
     }
 
     /* extract dependencies */
@@ -662,6 +565,16 @@ public:
     return create_gates( tt, result.dependencies );
   }
 
+  /*! \brief Costs of `synthesize_network( tt )` without generating the gates.
+   *
+   * Costing stops once the CNOT cost reaches `bound`, the returned CNOT cost
+   * is then a lower bound that is at least `bound`.
+   */
+  std::pair<uint32_t, uint32_t> synthesis_cost( kitty::dynamic_truth_table const& tt, uint32_t bound = std::numeric_limits<uint32_t>::max() )
+  {
+    return candidate_cost( dependency_strategy, generator, candidate_dependencies, tt, bound, ps.use_duplicate_lines );
+  }
+
   template<typename Dependencies>
   network create_gates( kitty::dynamic_truth_table const& tt, Dependencies const& dependencies )
   {
@@ -670,32 +583,243 @@ public:
     uint32_t const var_index = num_variables - 1;
 
     std::vector<uint32_t> zero_lines, one_lines;
-    extract_independent_vars( zero_lines, one_lines, tt );
+    std::vector<std::pair<uint32_t, uint32_t>> duplicate_lines;
+    extract_independent_vars( zero_lines, one_lines, duplicate_lines, tt );
+    auto all_dependencies = dependencies;
+    if ( ps.use_duplicate_lines )
+    {
+      detail::add_duplicate_lines( all_dependencies, duplicate_lines );
+    }
 
-    gates_t gates;
-    std::vector<uint32_t> cs;
-    if ( !dependencies.empty() )
+    gate_list gates;
+    generator( gates, num_variables, tt, var_index, {}, all_dependencies, zero_lines, one_lines );
+
+    /* FIXME: compute CNOT costs */
+    qsp_1bench_stats st;
+    gates_statistics( gates, all_dependencies, st );
+
+    return network{std::move( gates ), std::make_pair(st.total_cnots, st.total_sqgs)};
+  }
+
+private:
+  /* costs a candidate with the given dependency analysis and generator, stores its dependencies (with those of duplicate lines) */
+  static std::pair<uint32_t, uint32_t> candidate_cost( DependencyAnalysisStrategy& strategy, mc_qg_generator<dependencies_t>& generator, dependencies_t& dependencies,
+                                                       kitty::dynamic_truth_table const& tt, uint32_t bound, bool use_duplicate_lines )
+  {
+    if ( kitty::is_const0( tt ) )
     {
-      MC_qg_generation( gates, num_variables, tt, var_index, cs, dependencies, zero_lines, one_lines );      
+      dependencies.clear();
+      return std::make_pair( 0u, 0u );
     }
-    else
+
+    dependencies = strategy.run( tt ).dependencies;
+
+    uint32_t const num_variables = tt.num_vars();
+    std::vector<uint32_t> zero_lines, one_lines;
+    std::vector<std::pair<uint32_t, uint32_t>> duplicate_lines;
+    extract_independent_vars( zero_lines, one_lines, duplicate_lines, tt );
+    if ( use_duplicate_lines )
     {
-      MC_qg_generation( gates, tt, var_index, cs, zero_lines, one_lines );
+      detail::add_duplicate_lines( dependencies, duplicate_lines );
     }
+    return generator.cost( num_variables, tt, num_variables - 1, {}, dependencies, zero_lines, one_lines, bound );
+  }
 
-    /* FIXME: compute CNOT costs */
-    qsp_1bench_stats st;
-    std::map<uint32_t, bool> have_deps;
-    for ( auto i = 0u; i < num_variables; i++ )
+  /* updates the candidate statistics, returns whether the candidate improves on the bound */
+  static bool count_candidate( state_preparation_statistics& stats, std::pair<uint32_t, uint32_t> const& cost, uint32_t bound, stopwatch<>::duration_type time )
+  {
+    ++stats.num_candidates;
+    if ( cost.first >= bound )
+    {
+      ++stats.num_pruned_candidates;
+      stats.time_pruned_candidates += time;
+      return false;
+    }
+    stats.time_completed_candidates += time;
+    return true;
+  }
+
+  /* cost of a candidate that was costed before for the current function
+   *
+   * A remembered cost is either the cost of the candidate or a lower bound
+   * that reached the bound at that time; since the bound only decreases, the
+   * candidate can neither improve on the best candidate now.
+   */
+  std::optional<uint32_t> recall_candidate( kitty::dynamic_truth_table const& tt )
+  {
+    if ( auto const it = candidate_memo.find( tt ); it != candidate_memo.end() )
+    {
+      ++st.num_memo_hits;
+      return it->second;
+    }
+    return std::nullopt;
+  }
+
+  void remember_candidate( kitty::dynamic_truth_table const& tt, uint32_t cost )
+  {
+    if ( candidate_memo.size() < ps.candidate_memo_capacity )
+    {
+      candidate_memo.emplace( tt, cost );
+    }
+  }
+
+  /* state of a thread that costs reordering candidates */
+  struct candidate_worker
+  {
+    explicit candidate_worker( dependency_params const& dependency_ps )
+      : dependency_strategy( dependency_ps, dependency_st )
+    {
+    }
+
+    dependency_stats dependency_st;
+    DependencyAnalysisStrategy dependency_strategy;
+    mc_qg_generator<dependencies_t> generator;
+    dependencies_t dependencies;
+    state_preparation_statistics st;
+
+    /* best candidate of this worker, by cost and then by enumeration index */
+    std::optional<uint64_t> best_index;
+    std::pair<uint32_t, uint32_t> best_cost;
+    kitty::dynamic_truth_table best_tt;
+    dependencies_t best_dependencies;
+  };
+
+  /* costs the candidates of the reordering strategy in batches on a persistent thread pool
+   *
+   * Workers share the best CNOT cost found so far as bound, but only abandon
+   * candidates that are strictly more expensive; among the cheapest candidates
+   * the first one in enumeration order is selected, as in the sequential case.
+   */
+  void evaluate_candidates_in_parallel( kitty::dynamic_truth_table const& tt, std::pair<uint32_t, uint32_t>& best_cost,
+                                        std::optional<kitty::dynamic_truth_table>& best_tt, dependencies_t& best_dependencies )
+  {
+    uint32_t const num_threads = resolve_num_threads( ps.num_reordering_threads, ps.reordering_batch_size );
+    while ( workers.size() < num_threads )
+    {
+      workers.emplace_back( std::make_unique<candidate_worker>( dependency_strategy.parameters() ) );
+    }
+    if ( !pool || pool->num_threads() != num_threads )
     {
-      if ( dependencies.find( i ) != dependencies.end() )
+      pool = std::make_unique<thread_pool>( num_threads );
+    }
+    for ( auto& w : workers )
+    {
+      w->best_index.reset();
+    }
+
+    std::atomic<uint32_t> shared_bound{best_cost.first};
+    uint64_t offset{0u};
+    std::vector<uint32_t> costs;
+    std::vector<uint32_t> pending;
+    order_strategy.foreach_reordering_batch( tt, ps.reordering_batch_size, [&]( std::vector<kitty::dynamic_truth_table> const& batch ) {
+      costs.assign( batch.size(), 0u );
+      pending.clear();
+      for ( auto i = 0u; i < batch.size(); ++i )
       {
-        have_deps[i] = true;
+        if ( auto const cost = recall_candidate( batch[i] ) )
+        {
+          costs[i] = *cost;
+        }
+        else
+        {
+          pending.emplace_back( i );
+        }
       }
+
+      pool->parallel_for( pending.size(), 1u, [&]( uint32_t w, uint64_t k ) {
+        auto const i = pending[k];
+        auto& worker = *workers[w];
+        auto const bound = shared_bound.load( std::memory_order_relaxed );
+        auto const strict_bound = bound == std::numeric_limits<uint32_t>::max() ? bound : bound + 1u;
+
+        stopwatch<>::duration_type time_candidate{0};
+        auto const cost = call_with_stopwatch( time_candidate, [&]{
+            return candidate_cost( worker.dependency_strategy, worker.generator, worker.dependencies, batch[i], strict_bound, ps.use_duplicate_lines );
+          });
+        costs[i] = cost.first;
+        if ( !count_candidate( worker.st, cost, strict_bound, time_candidate ) || cost.first >= best_cost.first )
+        {
+          return;
+        }
+
+        auto const index = offset + i;
+        if ( !worker.best_index || cost.first < worker.best_cost.first || ( cost.first == worker.best_cost.first && index < *worker.best_index ) )
+        {
+          worker.best_index = index;
+          worker.best_cost = cost;
+          worker.best_tt = batch[i];
+          std::swap( worker.best_dependencies, worker.dependencies );
+        }
+
+        auto current = bound;
+        while ( cost.first < current && !shared_bound.compare_exchange_weak( current, cost.first, std::memory_order_relaxed ) )
+        {
+        }
+      } );
+      for ( auto const& i : pending )
+      {
+        remember_candidate( batch[i], costs[i] );
+      }
+      offset += batch.size();
+      return costs;
+    } );
+
+    candidate_worker* best{nullptr};
+    for ( auto& w : workers )
+    {
+      if ( w->best_index && ( !best || w->best_cost.first < best->best_cost.first ||
+                              ( w->best_cost.first == best->best_cost.first && *w->best_index < *best->best_index ) ) )
+      {
+        best = w.get();
+      }
+
+      st.merge( w->st );
+      w->st.reset();
+      dependency_strategy.statistics().merge( w->dependency_st );
+      w->dependency_st.reset();
+    }
+
+    if ( best )
+    {
+      best_cost = best->best_cost;
+      best_tt = best->best_tt;
+      std::swap( best_dependencies, best->best_dependencies );
+    }
+  }
+
+  /* looks up a canonical truth table in memory and in the cache file */
+  std::optional<network> lookup( kitty::dynamic_truth_table const& key )
+  {
+    auto cached = call_with_stopwatch( st.time_cache, [&]{ return cache.find( key ); } );
+    if ( !cached && cache.has_file() )
+    {
+      cached = call_with_stopwatch( st.time_cache, [&]{ return cache.find_in_file( key ); } );
+      st.num_file_hits += cached ? 1u : 0u;
     }
-    gates_statistics( gates, have_deps, num_variables, st );
+    update_cache_statistics();
+    return cached;
+  }
+
+  void update_cache_statistics()
+  {
+    st.num_evictions = cache.num_evictions();
+    st.resident_bytes = cache.resident_bytes();
+    st.num_file_insert_failures = cache.num_file_insert_failures();
+  }
 
-    return network{gates, std::make_pair(st.total_cnots, st.total_sqgs)};
+  /* maps a cached network back to the variables (and polarities) of tt */
+  network replay( kitty::dynamic_truth_table const& tt, network const& cached, std::vector<uint32_t> const& from_canonical, uint32_t negations )
+  {
+    auto result = call_with_stopwatch( st.time_cache, [&]{
+        return remap_network( cached, from_canonical, negations );
+      });
+    st.num_cnots += result.cnots_sqgs.first;
+    st.num_sqgs += result.cnots_sqgs.second;
+    if ( ps.verbose )
+    {
+      fmt::print( "cached function = {} cnots = {}\n", kitty::to_hex( tt ), result.cnots_sqgs.first );
+    }
+    return result;
   }
 
 protected:
@@ -705,7 +829,18 @@ protected:
   state_preparation_parameters const& ps;
   state_preparation_statistics& st;
 
-  std::unordered_map<kitty::dynamic_truth_table, network, kitty::hash<kitty::dynamic_truth_table>> cache;
+  synthesis_cache local_cache;
+  synthesis_cache& cache;
+
+  /* reuses its buffers across all synthesized functions */
+  mc_qg_generator<dependencies_t> generator;
+  /* dependencies of the last candidate passed to synthesis_cost */
+  dependencies_t candidate_dependencies;
+  /* created on the first parallel evaluation of reordering candidates, the threads are kept for all later functions */
+  std::vector<std::unique_ptr<candidate_worker>> workers;
+  std::unique_ptr<thread_pool> pool;
+  /* costs of the candidates of the current function */
+  std::unordered_map<kitty::dynamic_truth_table, uint32_t, kitty::hash<kitty::dynamic_truth_table>> candidate_memo;
 }; 
 
 } // namespace angel
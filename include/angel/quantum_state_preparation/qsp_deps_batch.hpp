@@ -0,0 +1,251 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file qsp_deps_batch.hpp
+
+  \brief Multi-threaded state preparation for batches of functions
+*/
+
+#pragma once
+
+#include "qsp_deps.hpp"
+#include "synthesis_cache.hpp"
+#include <angel/utils/parallel_for.hpp>
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+namespace angel
+{
+
+struct qsp_deps_batch_parameters
+{
+  /* number of worker threads (0 = hardware concurrency) */
+  uint32_t num_threads{0};
+
+  /* number of functions a worker takes from its queue at once */
+  uint32_t chunk_size{8};
+};
+
+namespace detail
+{
+
+/*! \brief Whether a reordering strategy can account its candidates in other statistics.
+ *
+ * Such strategies define `statistics_type`, return their statistics (or
+ * `nullptr`) from `statistics()`, and redirect them with `set_statistics`.
+ */
+template<class Strategy, class = void>
+struct has_reordering_statistics : std::false_type
+{
+};
+
+template<class Strategy>
+struct has_reordering_statistics<Strategy, std::void_t<typename Strategy::statistics_type,
+                                                       decltype( std::declval<Strategy const&>().statistics() ),
+                                                       decltype( std::declval<Strategy&>().set_statistics( std::declval<typename Strategy::statistics_type&>() ) )>>
+    : std::true_type
+{
+};
+
+/* copy of a reordering strategy for one worker */
+template<class Strategy, bool = has_reordering_statistics<Strategy>::value>
+struct worker_reordering
+{
+  explicit worker_reordering( Strategy const& strategy )
+    : strategy( strategy )
+  {
+  }
+
+  void merge_into( Strategy const& ) const
+  {
+  }
+
+  Strategy strategy;
+};
+
+/* copy with its own statistics, which are merged into the ones of the original */
+template<class Strategy>
+struct worker_reordering<Strategy, true>
+{
+  explicit worker_reordering( Strategy const& original )
+    : strategy( original )
+  {
+    if ( original.statistics() )
+    {
+      strategy.set_statistics( st );
+    }
+  }
+
+  void merge_into( Strategy const& original ) const
+  {
+    if ( auto* original_st = original.statistics() )
+    {
+      original_st->merge( st );
+    }
+  }
+
+  typename Strategy::statistics_type st;
+  Strategy strategy;
+};
+
+} // namespace detail
+
+/**
+ * \brief Quantum state preparation for a range of functions on a thread pool
+ *
+ * Every worker owns its own dependency analysis strategy (constructed from
+ * `dependency_ps`), copy of `order_strategy`, statistics, and `qsp_deps`
+ * engine; all workers share the synthesis cache.
+ *
+ * The result does not depend on the scheduling: all functions are canonized
+ * first, and a function is a representative if none of its cache keys is a
+ * key of an earlier function.  Only the representatives are prepared in
+ * parallel (with work stealing); since their keys are pairwise distinct, they
+ * do not read each other's cache entries.  The other functions are then
+ * prepared in input order on one worker and see the same cache entries as in
+ * a sequential run.  Hence the networks and statistics (except for times) are
+ * those of a sequential `qsp_deps` run over the range with the same cache,
+ * provided no entry is evicted from the cache during the batch.
+ *
+ * After all workers have joined, the per-worker statistics are merged into
+ * `st` and `dependency_st` in worker order, and into the statistics of
+ * `order_strategy` if it has any (see `detail::has_reordering_statistics`).
+ *
+ * \tparam DependencyAnalysisStrategy dependency analysis strategy (must be given explicitly)
+ * \param begin,end range of `kitty::dynamic_truth_table` (forward iterators)
+ * \return one network per function, in input order
+*/
+template<class DependencyAnalysisStrategy, class Network, class ReorderingStrategy, class Iterator>
+std::vector<network> qsp_deps_batch( Network& ntk, Iterator begin, Iterator end,
+                                     typename DependencyAnalysisStrategy::parameter_type const& dependency_ps,
+                                     typename DependencyAnalysisStrategy::statistics_type& dependency_st,
+                                     ReorderingStrategy const& order_strategy,
+                                     state_preparation_parameters const& ps, state_preparation_statistics& st,
+                                     synthesis_cache& cache, qsp_deps_batch_parameters const& batch_ps = {} )
+{
+  static_assert( std::is_copy_constructible_v<ReorderingStrategy>, "every worker needs its own copy of the reordering strategy" );
+
+  using dependency_stats = typename DependencyAnalysisStrategy::statistics_type;
+  using engine_t = qsp_deps<Network, DependencyAnalysisStrategy, ReorderingStrategy>;
+
+  struct worker
+  {
+    explicit worker( Network& ntk, typename DependencyAnalysisStrategy::parameter_type const& dependency_ps, ReorderingStrategy const& order_strategy,
+                     state_preparation_parameters const& ps, synthesis_cache& cache )
+      : dependency_strategy( dependency_ps, dependency_st )
+      , reordering( order_strategy )
+      , engine( ntk, dependency_strategy, reordering.strategy, ps, st, cache )
+    {
+    }
+
+    dependency_stats dependency_st;
+    state_preparation_statistics st;
+    DependencyAnalysisStrategy dependency_strategy;
+    detail::worker_reordering<ReorderingStrategy> reordering;
+    engine_t engine;
+  };
+
+  std::vector<kitty::dynamic_truth_table const*> functions;
+  for ( auto it = begin; it != end; ++it )
+  {
+    functions.emplace_back( &( *it ) );
+  }
+
+  std::vector<network> results( functions.size() );
+  if ( functions.empty() )
+  {
+    return results;
+  }
+
+  uint32_t const num_threads = resolve_num_threads( batch_ps.num_threads, functions.size() );
+  std::vector<std::unique_ptr<worker>> workers;
+  for ( auto i = 0u; i < num_threads; ++i )
+  {
+    workers.emplace_back( std::make_unique<worker>( ntk, dependency_ps, order_strategy, ps, cache ) );
+  }
+
+  using cache_keys = typename engine_t::cache_keys;
+  std::vector<cache_keys> keys( functions.size() );
+  parallel_for( functions.size(), num_threads, batch_ps.chunk_size, [&]( uint32_t w, uint64_t index ) {
+    keys[index] = workers[w]->engine.keys( *functions[index] );
+  } );
+
+  /* representatives have no key in common with an earlier function */
+  std::vector<uint64_t> representatives, members;
+  std::unordered_set<kitty::dynamic_truth_table, kitty::hash<kitty::dynamic_truth_table>> seen;
+  for ( auto index = 0u; index < functions.size(); ++index )
+  {
+    auto const& k = keys[index];
+    auto const fresh = seen.count( k.p_tt ) == 0u && ( !k.np_key || seen.count( std::get<0>( *k.np_key ) ) == 0u );
+    seen.insert( k.p_tt );
+    if ( k.np_key )
+    {
+      seen.insert( std::get<0>( *k.np_key ) );
+    }
+    ( fresh ? representatives : members ).emplace_back( index );
+  }
+
+  parallel_for( representatives.size(), num_threads, batch_ps.chunk_size, [&]( uint32_t w, uint64_t k ) {
+    auto const index = representatives[k];
+    results[index] = workers[w]->engine( *functions[index], keys[index] );
+  } );
+  for ( auto const& index : members )
+  {
+    results[index] = workers.front()->engine( *functions[index], keys[index] );
+  }
+
+  for ( auto const& w : workers )
+  {
+    st.merge( w->st );
+    dependency_st.merge( w->dependency_st );
+    w->reordering.merge_into( order_strategy );
+  }
+
+  return results;
+}
+
+/*! \brief Same as above with a cache that only lives for this batch. */
+template<class DependencyAnalysisStrategy, class Network, class ReorderingStrategy, class Iterator>
+std::vector<network> qsp_deps_batch( Network& ntk, Iterator begin, Iterator end,
+                                     typename DependencyAnalysisStrategy::parameter_type const& dependency_ps,
+                                     typename DependencyAnalysisStrategy::statistics_type& dependency_st,
+                                     ReorderingStrategy const& order_strategy,
+                                     state_preparation_parameters const& ps, state_preparation_statistics& st,
+                                     qsp_deps_batch_parameters const& batch_ps = {} )
+{
+  synthesis_cache cache;
+  return qsp_deps_batch<DependencyAnalysisStrategy>( ntk, begin, end, dependency_ps, dependency_st, order_strategy, ps, st, cache, batch_ps );
+}
+
+} // namespace angel
@@ -0,0 +1,304 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file synthesis_cache.hpp
+
+  \brief Thread-safe cache for synthesized state preparation networks
+*/
+
+#pragma once
+
+#include "persistent_cache.hpp"
+#include "utils.hpp"
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Sharded hash map from (canonical) truth tables to networks.
+ *
+ * The key space is split into independent shards, each protected by its own
+ * mutex, such that concurrent workers rarely contend for the same lock.  The
+ * cache can be shared by several `qsp_deps` instances.  Optionally, it is
+ * backed by a memory-mapped cache file (see `persistent_cache.hpp`) that
+ * survives the process and can be shared with other processes.
+ *
+ * The in-memory part can be bounded by a byte budget, which is split evenly
+ * among the shards.  When a shard exceeds its share, entries are evicted with
+ * the GreedyDual-Size policy: every entry has a priority `L + cost / bytes`,
+ * where `cost` is the time it took to synthesize the entry and `L` is the
+ * priority of the last entry evicted from the shard.  Since `L` only grows,
+ * entries that are not used age out, unless they were expensive enough to
+ * synthesize compared to the memory they occupy.  A hit refreshes the
+ * priority of an entry.  Evicted entries remain in the cache file.
+ */
+class synthesis_cache
+{
+public:
+  using key_type = kitty::dynamic_truth_table;
+
+public:
+  /*! \brief Creates a cache; `byte_budget` bounds the memory of the entries (0 = unbounded). */
+  explicit synthesis_cache( uint32_t num_shards = 64u, uint64_t byte_budget = 0u )
+    : shards( std::max( 1u, num_shards ) )
+    , shard_budget( byte_budget == 0u ? 0u : std::max<uint64_t>( 1u, byte_budget / shards.size() ) )
+  {
+  }
+
+  /*! \brief Returns a copy of the cached network for `key` (if any). */
+  std::optional<network> find( key_type const& key ) const
+  {
+    auto& s = shard_of( key );
+    std::lock_guard<std::mutex> lock( s.mutex );
+    auto const it = s.map.find( key );
+    if ( it == std::end( s.map ) )
+    {
+      return std::nullopt;
+    }
+    if ( shard_budget != 0u )
+    {
+      touch( s, it->second );
+    }
+    return it->second.ntk;
+  }
+
+  /*! \brief Looks `key` up in the cache file and copies a hit into memory. */
+  std::optional<network> find_in_file( key_type const& key )
+  {
+    if ( !file )
+    {
+      return std::nullopt;
+    }
+    auto result = file->find( key );
+    if ( result )
+    {
+      /* reading the file is cheap compared to synthesis, hence no cost */
+      insert_in_memory( key, *result, 0.0 );
+    }
+    return result;
+  }
+
+  /*! \brief Inserts a network; returns false if `key` was already present.
+   *
+   * `cost` is the effort (e.g., in seconds) it took to synthesize `ntk`, it is
+   * only used for eviction.  New entries are also appended to the cache file
+   * if it is writable, even if they do not fit into the memory budget.
+   */
+  bool insert( key_type const& key, network const& ntk, double cost = 0.0 )
+  {
+    if ( !insert_in_memory( key, ntk, cost ) )
+    {
+      return false;
+    }
+    if ( file && file->is_writable() )
+    {
+      file->insert( key, ntk );
+    }
+    return true;
+  }
+
+  /*! \brief Attaches a cache file, see `persistent_synthesis_cache::open`. */
+  bool open_file( std::string const& filename, persistent_cache_mode mode, uint64_t tag, uint64_t num_buckets = 1u << 16u )
+  {
+    file = std::make_unique<persistent_synthesis_cache>();
+    if ( !file->open( filename, mode, tag, num_buckets ) )
+    {
+      file.reset();
+      return false;
+    }
+    return true;
+  }
+
+  bool has_file() const
+  {
+    return file != nullptr;
+  }
+
+  uint64_t size() const
+  {
+    uint64_t result = 0u;
+    for ( auto& s : shards )
+    {
+      std::lock_guard<std::mutex> lock( s.mutex );
+      result += s.map.size();
+    }
+    return result;
+  }
+
+  /*! \brief Estimated number of bytes held by the in-memory entries. */
+  uint64_t resident_bytes() const
+  {
+    return num_resident_bytes.load( std::memory_order_relaxed );
+  }
+
+  /*! \brief Number of entries that could not be appended to the cache file so far. */
+  uint64_t num_file_insert_failures() const
+  {
+    return file ? file->num_failed_inserts() : 0u;
+  }
+
+  /*! \brief Number of entries evicted from memory so far. */
+  uint64_t num_evictions() const
+  {
+    return num_evicted.load( std::memory_order_relaxed );
+  }
+
+  /*! \brief Memory budget (0 = unbounded). */
+  uint64_t byte_budget() const
+  {
+    return shard_budget * shards.size();
+  }
+
+  void clear()
+  {
+    for ( auto& s : shards )
+    {
+      std::lock_guard<std::mutex> lock( s.mutex );
+      num_resident_bytes -= s.bytes;
+      s.map.clear();
+      s.queue.clear();
+      s.bytes = 0u;
+      s.inflation = 0.0;
+    }
+  }
+
+  /*! \brief Estimated memory footprint of an entry (key, network, and hash map node). */
+  static uint64_t entry_bytes( key_type const& key, network const& ntk )
+  {
+    /* rough per-node overhead of std::unordered_map */
+    constexpr uint64_t node_overhead = 4u * sizeof( void* );
+
+    uint64_t bytes = node_overhead + sizeof( key_type ) + sizeof( entry ) + key.num_blocks() * sizeof( uint64_t );
+    bytes += ntk.order.capacity() * sizeof( uint32_t ) + ntk.gates.memory_usage();
+    return bytes;
+  }
+
+private:
+  using queue_t = std::multimap<double, key_type const*>;
+
+  struct entry
+  {
+    network ntk;
+    uint64_t bytes{0};
+    double cost{0.0};
+    /* position in the eviction queue (only if the cache is bounded) */
+    queue_t::iterator pos{};
+  };
+
+  struct shard
+  {
+    mutable std::mutex mutex;
+    std::unordered_map<key_type, entry, kitty::hash<key_type>> map;
+
+    /* entries ordered by priority, lowest first */
+    queue_t queue;
+    /* priority of the last evicted entry */
+    double inflation{0.0};
+    uint64_t bytes{0};
+  };
+
+  /* GreedyDual-Size priority of an entry */
+  static double priority( shard const& s, entry const& e )
+  {
+    /* the epsilon keeps free entries in LRU order */
+    return s.inflation + ( e.cost + 1e-9 ) / e.bytes;
+  }
+
+  /* refreshes the priority of an entry after a hit (shard must be locked) */
+  void touch( shard& s, entry& e ) const
+  {
+    auto const key = e.pos->second;
+    s.queue.erase( e.pos );
+    e.pos = s.queue.emplace( priority( s, e ), key );
+  }
+
+  bool insert_in_memory( key_type const& key, network const& ntk, double cost )
+  {
+    auto const bytes = entry_bytes( key, ntk );
+
+    auto& s = shard_of( key );
+    std::lock_guard<std::mutex> lock( s.mutex );
+    if ( s.map.find( key ) != std::end( s.map ) )
+    {
+      return false;
+    }
+    if ( shard_budget != 0u && bytes > shard_budget )
+    {
+      /* would evict everything else and itself */
+      ++num_evicted;
+      return true;
+    }
+
+    auto& [k, e] = *s.map.emplace( key, entry{ntk, bytes, cost} ).first;
+    s.bytes += bytes;
+    num_resident_bytes += bytes;
+    if ( shard_budget == 0u )
+    {
+      return true;
+    }
+
+    e.pos = s.queue.emplace( priority( s, e ), &k );
+    while ( s.bytes > shard_budget )
+    {
+      auto const victim = s.queue.begin();
+      s.inflation = victim->first;
+      auto const it = s.map.find( *victim->second );
+      s.bytes -= it->second.bytes;
+      num_resident_bytes -= it->second.bytes;
+      ++num_evicted;
+      s.queue.erase( victim );
+      s.map.erase( it );
+    }
+    return true;
+  }
+
+  shard& shard_of( key_type const& key ) const
+  {
+    /* use the high bits, the low bits select the bucket inside the shard */
+    auto const h = kitty::hash<key_type>()( key );
+    return shards[( h ^ ( h >> 32u ) ) % shards.size()];
+  }
+
+private:
+  mutable std::vector<shard> shards;
+  uint64_t shard_budget;
+  std::atomic<uint64_t> num_resident_bytes{0};
+  std::atomic<uint64_t> num_evicted{0};
+  std::unique_ptr<persistent_synthesis_cache> file;
+};
+
+} // namespace angel
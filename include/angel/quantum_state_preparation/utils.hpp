@@ -1,17 +1,19 @@
 #pragma once
 
+#include "gate_list.hpp"
 #include <angel/utils/stopwatch.hpp>
 
 #include <fmt/format.h>
 
+#include <cassert>
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <tuple>
 #include <vector>
 
 namespace angel
 {
-using gates_t = std::map<uint32_t, std::vector<std::pair<double, std::vector<uint32_t>>>>;
 struct qsp_1bench_stats
 {
   stopwatch<>::duration_type total_time{0};
@@ -20,7 +22,99 @@ struct qsp_1bench_stats
   std::pair<uint32_t, uint32_t> gates_count = std::make_pair( 0, 0 );
 };
 
-uint32_t compute_upperbound_cost( std::vector<uint32_t> zero_lines, std::vector<uint32_t> one_lines, uint32_t num_vars, uint32_t var_index )
+struct network
+{
+  /* gates in application order, grouped by target */
+  gate_list gates;
+  std::pair<uint32_t, uint32_t> cnots_sqgs;
+
+  /* targets in preparation order (all gates of a target are applied before the next target);
+     empty if the targets are prepared from the highest index down */
+  std::vector<uint32_t> order{};
+};
+
+/*! \brief Relabels the qubits of a network.
+ *
+ * Qubit `i` becomes qubit `var_map[i]`: targets, the preparation order, and
+ * the control masks are renamed, angles are kept.
+ *
+ * Afterwards, every (new) qubit `j` with bit `j` set in `negations` is
+ * complemented: a NOT gate is appended to the gates of `j` (or a trailing
+ * NOT gate is removed) and the polarity of `j` is flipped in all controls.
+ * The SQG count is updated accordingly, the CNOT count is kept.
+ */
+inline network remap_network( network const& ntk, std::vector<uint32_t> const& var_map, uint32_t negations = 0u )
+{
+  uint32_t const num_qubits = var_map.size();
+  network result{gate_list( num_qubits ), ntk.cnots_sqgs, {}};
+  result.order.reserve( num_qubits );
+  if ( ntk.order.empty() )
+  {
+    for ( auto i = num_qubits; i-- > 0u; )
+    {
+      result.order.emplace_back( var_map[i] );
+    }
+  }
+  else
+  {
+    for ( auto const& i : ntk.order )
+    {
+      result.order.emplace_back( var_map[i] );
+    }
+  }
+
+  auto const& gates = ntk.gates;
+  auto const words = result.gates.num_words();
+  std::vector<uint64_t> positive( words ), negative( words );
+  result.gates.reserve( gates.size() + __builtin_popcount( negations ) );
+  for ( auto g = 0u; g < gates.size(); ++g )
+  {
+    std::fill( positive.begin(), positive.end(), 0u );
+    std::fill( negative.begin(), negative.end(), 0u );
+    for ( auto w = 0u; w < gates.num_words(); ++w )
+    {
+      for ( auto mask = gates.positive( g )[w] | gates.negative( g )[w]; mask; mask &= mask - 1u )
+      {
+        auto const bit = __builtin_ctzll( mask );
+        auto const var = var_map[64u * w + bit];
+        auto const sign = ( ( gates.negative( g )[w] >> bit ) & 1u ) ^ ( ( negations >> var ) & 1u );
+        ( sign ? negative : positive )[var / 64u] |= uint64_t( 1u ) << ( var % 64u );
+      }
+    }
+    result.gates.add_gate( var_map[gates.target( g )], gates.angle( g ), positive.data(), negative.data() );
+  }
+
+  std::vector<uint32_t> rank( num_qubits );
+  for ( auto i = 0u; i < result.order.size(); ++i )
+  {
+    rank[result.order[i]] = i;
+  }
+  for ( auto j = 0u; j < num_qubits; ++j )
+  {
+    if ( ( ( negations >> j ) & 1u ) == 0u )
+      continue;
+
+    /* position after the last gate of j (the gates are grouped in preparation order) */
+    auto end = 0u;
+    while ( end < result.gates.size() && rank[result.gates.target( end )] <= rank[j] )
+    {
+      ++end;
+    }
+    if ( end > 0u && result.gates.target( end - 1u ) == j && result.gates.is_not( end - 1u ) )
+    {
+      result.gates.erase_gate( end - 1u );
+      --result.cnots_sqgs.second;
+    }
+    else
+    {
+      result.gates.insert_gate( end, j, M_PI );
+      ++result.cnots_sqgs.second;
+    }
+  }
+  return result;
+}
+
+inline uint32_t compute_upperbound_cost( std::vector<uint32_t> zero_lines, std::vector<uint32_t> one_lines, uint32_t num_vars, uint32_t var_index )
 {
   auto const_lines = 0;
   for ( auto const& zero : zero_lines )
@@ -40,7 +134,7 @@ uint32_t compute_upperbound_cost( std::vector<uint32_t> zero_lines, std::vector<
   return cost;
 }
 
-std::pair<uint32_t, uint32_t> esop_gate_cost( std::vector<std::vector<uint32_t>> const& esop )
+inline std::pair<uint32_t, uint32_t> esop_gate_cost( std::vector<std::vector<uint32_t>> const& esop )
 {
   assert( esop.size() > 0u );
   uint32_t cnots_count = 0;
@@ -106,7 +200,7 @@ std::pair<uint32_t, uint32_t> esop_gate_cost( std::vector<std::vector<uint32_t>>
   return (cnots_count > cnots_count2) ? std::make_pair(cnots_count2, sqgs_count2) : std::make_pair(cnots_count, sqgs_count);
 }
 
-std::pair<uint32_t, uint32_t> uniform_gate_cost( std::vector<std::vector<uint32_t>> const& us )
+inline std::pair<uint32_t, uint32_t> uniform_gate_cost( std::vector<std::vector<uint32_t>> const& us )
 {
   std::vector<uint32_t> controls_idx;
   for(auto const& u : us)
@@ -126,118 +220,378 @@ std::pair<uint32_t, uint32_t> uniform_gate_cost( std::vector<std::vector<uint32_
   return std::make_pair(cnots, sqgs);
 }
 
-/* with dependencies */
-void gates_statistics( gates_t gates, std::map<uint32_t, bool> const& have_dependencies,
-                       uint32_t const num_vars, qsp_1bench_stats& stats )
+namespace detail
+{
+
+/* variables of gate g are a subset of the variables of gate h */
+inline bool has_control_subset( gate_list const& gates, uint64_t g, uint64_t h )
+{
+  for ( auto w = 0u; w < gates.num_words(); ++w )
+  {
+    auto const vars_g = gates.positive( g )[w] | gates.negative( g )[w];
+    auto const vars_h = gates.positive( h )[w] | gates.negative( h )[w];
+    if ( vars_g & ~vars_h )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* same as esop_gate_cost for the gates [begin, end) as cubes */
+inline std::pair<uint32_t, uint32_t> esop_gate_cost( gate_list const& gates, uint64_t begin, uint64_t end )
+{
+  uint32_t cnots_count = 0;
+  uint32_t sqgs_count = 0;
+  /// first AND pattern
+  auto const n0 = gates.num_controls( begin );
+  switch ( n0 )
+  {
+  case 0:
+    sqgs_count += 1;
+    break;
+  case 1:
+    cnots_count += 1;
+    break;
+  default:
+    cnots_count += ( 1 << n0 );
+    sqgs_count += ( 1 << n0 );
+    break;
+  }
+
+  if ( end - begin == 1u )
+    return std::make_pair( cnots_count, sqgs_count );
+
+  /// the rest
+  bool uniform = true;
+  for ( auto g = begin + 1u; g < end; ++g )
+  {
+    auto const n = gates.num_controls( g );
+    switch ( n )
+    {
+    case 0:
+      sqgs_count += 1;
+      break;
+    case 1:
+      cnots_count += 1;
+      break;
+    default:
+      cnots_count += ( ( 1 << ( n + 1 ) ) - 2 );
+      sqgs_count += ( ( 1 << ( n + 1 ) ) - 2 );
+      break;
+    }
+    uniform = uniform && has_control_subset( gates, g, begin );
+  }
+
+  /* using uniformly-controlled gates */
+  if ( !uniform )
+    return std::make_pair( cnots_count, sqgs_count );
+
+  uint32_t const cnots_count2 = 1u << n0;
+  return ( cnots_count > cnots_count2 ) ? std::make_pair( cnots_count2, 0u ) : std::make_pair( cnots_count, sqgs_count );
+}
+
+} // namespace detail
+
+/*! \brief Computes the CNOT and SQG costs of a network.
+ *
+ * The gates of every target are evaluated together: as an ESOP if the target
+ * has a dependency (a key in `dependencies`), otherwise as a single or as a
+ * uniformly controlled rotation.  A NOT after other gates of its target only
+ * flips the prepared qubit and costs one SQG on its own, such that appending
+ * or removing it (see `remap_network`) changes the SQG cost by one.  Since
+ * the gates are grouped by target, this is a linear scan.
+ */
+template<class Dependencies>
+void gates_statistics( gate_list const& gates, Dependencies const& dependencies, qsp_1bench_stats& stats )
 {
   auto total_sqgs = 0u;
   auto total_cnots = 0u;
-  //auto n_reduc = 0; /* lines that always are zero or one and so we dont need to prepare them */
 
-  for ( int32_t i = num_vars - 1; i >= 0; i-- )
+  for ( auto begin = 0u; begin < gates.size(); )
   {
+    auto const target = gates.target( begin );
+    auto end = begin + 1u;
+    while ( end < gates.size() && gates.target( end ) == target )
+    {
+      ++end;
+    }
+
     auto sqgs = 0u;
     auto cnots = 0u;
-
-    if ( gates.find( i ) == gates.end() )
+    auto const next = end;
+    if ( end - begin > 1u && gates.is_not( end - 1u ) )
     {
-      //n_reduc++;
-      continue;
+      total_sqgs += 1u;
+      --end;
     }
-    if ( gates[i].size() == 0 )
+
+    if ( end - begin == 1u && gates.is_not( begin ) )
     {
-      //n_reduc++;
-      continue;
+      sqgs = 1u;
     }
-    if ( gates[i].size() == 1 && gates[i][0].first == M_PI && gates[i][0].second.size() == 0 )
+    /* there exists deps */
+    else if ( dependencies.find( target ) != dependencies.end() )
     {
-      total_sqgs++;
-      //n_reduc++;
-      continue;
+      std::tie( cnots, sqgs ) = detail::esop_gate_cost( gates, begin, end );
     }
-
-    /* check deps */
-    auto it = have_dependencies.find( i );
-    /* there exists deps */
-    if ( it != have_dependencies.end() )
+    /* doesn't exist deps */
+    else if ( end - begin == 1u )
     {
-      std::vector<std::vector<uint32_t>> deps;
-      for ( auto j = 0u; j < gates[i].size(); j++ )
+      auto const n = gates.num_controls( begin );
+      if ( n == 0u )
+        sqgs = 1;
+      else if ( n == 1u && ( std::abs( gates.angle( begin ) - M_PI ) < 0.1 ) )
+        cnots = 1;
+      else
       {
-        deps.emplace_back(gates[i][j].second);
-      }    
-      auto gates_cost = esop_gate_cost(deps);
-      cnots = gates_cost.first;
-      sqgs = gates_cost.second;
+        cnots = 1u << n;
+        sqgs = 1u << n;
+      }
     }
-
-    /* doesn't exist deps */
     else
     {
-      if(gates[i].size() == 1)
+      /* uniformly controlled rotation on the union of the controls */
+      auto n = 0u;
+      for ( auto w = 0u; w < gates.num_words(); ++w )
       {
-        if(gates[i][0].second.size() == 0)
-          sqgs = 1;
-        else if(gates[i][0].second.size() == 1 && ( std::abs( gates[i][0].first - M_PI ) < 0.1 ))
-          cnots = 1;
-        else 
+        uint64_t vars{0u};
+        for ( auto g = begin; g < end; ++g )
         {
-          cnots = pow(2, gates[i][0].second.size());
-          sqgs = pow(2, gates[i][0].second.size());
+          vars |= gates.positive( g )[w] | gates.negative( g )[w];
         }
+        n += __builtin_popcountll( vars );
       }
-      else
-      {
-        std::vector<std::vector<uint32_t>> us;
-        for ( auto j = 0u; j < gates[i].size(); j++ )
-        {
-          us.emplace_back(gates[i][j].second);
-        }    
-        auto gates_cost = uniform_gate_cost(us);
-        cnots = gates_cost.first;
-        sqgs = gates_cost.second;
-      }
-         
+      cnots = 1u << n;
+      sqgs = 1u << n;
     }
 
     total_sqgs += sqgs;
     total_cnots += cnots;
+    begin = next;
   }
 
   stats.total_cnots += total_cnots;
   stats.total_sqgs += total_sqgs;
   stats.gates_count = std::make_pair( total_cnots, total_sqgs );
-
-  return;
 }
 
-using gates_t = std::map<uint32_t, std::vector<std::pair<double, std::vector<uint32_t>>>>;
-void print_gates( gates_t gates )
+/*! \brief Computes the costs of `gates_statistics` without storing the gates.
+ *
+ * Gates are added one by one (with at most 64 qubits); the gates of a target
+ * must be added in their application order, gates of different targets may be
+ * interleaved.  Every target keeps the few aggregates the cost model needs:
+ * the number of gates, the first gate, the ESOP costs of the remaining gates,
+ * whether their controls are covered by the first gate, and the union of all
+ * controls.
+ *
+ * The CNOT cost of a target never decreases when a gate is added, hence the
+ * running total `num_cnots()` is a lower bound on the final CNOT cost and can
+ * be used to abandon a synthesis as soon as it exceeds a bound.
+ */
+class gate_cost_accumulator
 {
-  for ( auto const& target : gates )
+public:
+  /*! \brief Starts a new circuit, bit `i` of `dependency_mask` is set if qubit `i` is prepared from a dependency. */
+  void reset( uint32_t num_qubits, uint64_t dependency_mask = 0u )
+  {
+    assert( num_qubits <= 64u );
+    targets.assign( num_qubits, target_costs{} );
+    dependencies = dependency_mask;
+    total_cnots = 0u;
+  }
+
+  void add_gate( uint32_t target, double angle, uint64_t positive = 0u, uint64_t negative = 0u )
+  {
+    auto& t = targets[target];
+
+    /* a NOT after other gates is costed on its own as long as it is the last gate */
+    if ( t.trailing_not )
+    {
+      t.trailing_not = false;
+      add_to_group( t, M_PI, 0u );
+    }
+    if ( t.num_gates > 0u && angle == M_PI && ( positive | negative ) == 0u )
+    {
+      t.trailing_not = true;
+    }
+    else
+    {
+      add_to_group( t, angle, positive | negative );
+    }
+
+    auto const cnots = target_cost( target ).first;
+    total_cnots += cnots - t.cnots;
+    t.cnots = cnots;
+  }
+
+  /*! \brief Adds a gate with control literals. */
+  void add_gate( uint32_t target, double angle, std::vector<uint32_t> const& controls )
+  {
+    uint64_t positive{0u}, negative{0u};
+    for ( auto const& c : controls )
+    {
+      ( c % 2u ? negative : positive ) |= uint64_t( 1u ) << ( c / 2u );
+    }
+    add_gate( target, angle, positive, negative );
+  }
+
+  /*! \brief CNOT cost of the gates added so far. */
+  uint32_t num_cnots() const
+  {
+    return total_cnots;
+  }
+
+  /*! \brief CNOT and SQG costs as computed by `gates_statistics`. */
+  std::pair<uint32_t, uint32_t> cost() const
+  {
+    auto total_sqgs = 0u;
+    for ( auto i = 0u; i < targets.size(); ++i )
+    {
+      total_sqgs += target_cost( i ).second;
+    }
+    return {total_cnots, total_sqgs};
+  }
+
+private:
+  struct target_costs;
+
+  static void add_to_group( target_costs& t, double angle, uint64_t vars )
   {
-    std::cout << fmt::format( "target idx: {}\n", target.first );
-    auto gs = target.second;
-    for ( auto const& g : gs )
+    uint32_t const n = __builtin_popcountll( vars );
+    if ( t.num_gates++ == 0u )
     {
-      std::cout << fmt::format( "angle: {} controls: ", ( g.first / M_PI ) * 180 );
-      for ( auto const& c : g.second )
+      t.first_vars = vars;
+      t.first_num_controls = n;
+      t.first_angle = angle;
+    }
+    else
+    {
+      switch ( n )
       {
-        if ( c % 2 == 0 )
-        {
-          std::cout << fmt::format( "{} ", c / 2 );
-        }
-        else
+      case 0:
+        t.rest_sqgs += 1;
+        break;
+      case 1:
+        t.rest_cnots += 1;
+        break;
+      default:
+        t.rest_cnots += ( ( 1 << ( n + 1 ) ) - 2 );
+        t.rest_sqgs += ( ( 1 << ( n + 1 ) ) - 2 );
+        break;
+      }
+      t.uniform = t.uniform && ( vars & ~t.first_vars ) == 0u;
+    }
+    t.all_vars |= vars;
+  }
+
+  std::pair<uint32_t, uint32_t> target_cost( uint32_t target ) const
+  {
+    auto const& t = targets[target];
+    if ( t.num_gates == 0u )
+      return {0u, 0u};
+
+    auto const n0 = t.first_num_controls;
+    auto cnots = 0u;
+    auto sqgs = 0u;
+    if ( t.num_gates == 1u && t.first_angle == M_PI && n0 == 0u )
+    {
+      sqgs = 1u;
+    }
+    else if ( ( dependencies >> target ) & 1u )
+    {
+      /* see esop_gate_cost */
+      switch ( n0 )
+      {
+      case 0:
+        sqgs = 1;
+        break;
+      case 1:
+        cnots = 1;
+        break;
+      default:
+        cnots = 1u << n0;
+        sqgs = 1u << n0;
+        break;
+      }
+      if ( t.num_gates > 1u )
+      {
+        cnots += t.rest_cnots;
+        sqgs += t.rest_sqgs;
+        if ( t.uniform && cnots > ( 1u << n0 ) )
         {
-          std::cout << fmt::format( "-{} ", c / 2 );
+          cnots = 1u << n0;
+          sqgs = 0u;
         }
       }
-      std::cout << std::endl;
     }
+    else if ( t.num_gates == 1u )
+    {
+      if ( n0 == 0u )
+        sqgs = 1;
+      else if ( n0 == 1u && ( std::abs( t.first_angle - M_PI ) < 0.1 ) )
+        cnots = 1;
+      else
+      {
+        cnots = 1u << n0;
+        sqgs = 1u << n0;
+      }
+    }
+    else
+    {
+      auto const n = __builtin_popcountll( t.all_vars );
+      cnots = 1u << n;
+      sqgs = 1u << n;
+    }
+    return {cnots, sqgs + ( t.trailing_not ? 1u : 0u )};
+  }
+
+  struct target_costs
+  {
+    uint32_t num_gates{0u};
+    uint32_t first_num_controls{0u};
+    uint64_t first_vars{0u};
+    double first_angle{0.0};
+    uint32_t rest_cnots{0u};
+    uint32_t rest_sqgs{0u};
+    bool uniform{true};
+    uint64_t all_vars{0u};
+    /* the last gate is a NOT after other gates, it is not part of the aggregates */
+    bool trailing_not{false};
+    /* CNOT cost of the gates so far */
+    uint32_t cnots{0u};
+  };
+
+  std::vector<target_costs> targets;
+  uint64_t dependencies{0u};
+  uint32_t total_cnots{0u};
+};
+
+inline void print_gates( gate_list const& gates )
+{
+  for ( auto g = 0u; g < gates.size(); ++g )
+  {
+    if ( g == 0u || gates.target( g ) != gates.target( g - 1u ) )
+    {
+      std::cout << fmt::format( "target idx: {}\n", gates.target( g ) );
+    }
+    std::cout << fmt::format( "angle: {} controls: ", ( gates.angle( g ) / M_PI ) * 180 );
+    for ( auto const& c : gates.controls( g ) )
+    {
+      if ( c % 2 == 0 )
+      {
+        std::cout << fmt::format( "{} ", c / 2 );
+      }
+      else
+      {
+        std::cout << fmt::format( "-{} ", c / 2 );
+      }
+    }
+    std::cout << std::endl;
   }
 }
 
-uint32_t extract_max_controls (std::vector< std::vector<int32_t> > mcs)
+inline uint32_t extract_max_controls (std::vector< std::vector<int32_t> > mcs)
 {
   std::vector<uint32_t> cs;
   for(auto const& mc : mcs)
@@ -0,0 +1,305 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file annealing_reordering.hpp
+
+  \brief Variable reordering by simulated annealing
+*/
+
+#pragma once
+
+#include "random_reordering.hpp"
+#include "symmetry_classes.hpp"
+#include <angel/utils/splitmix64.hpp>
+#include <angel/utils/stopwatch.hpp>
+
+#include <fmt/format.h>
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace angel
+{
+
+struct annealing_reordering_params
+{
+  /* maximum number of orders passed to `fn` per function, including the input order */
+  uint64_t max_evaluations{1000u};
+
+  /* maximum time per function in seconds (0 for no limit) */
+  double time_budget{0.0};
+
+  uint64_t seed{0xcafeaffe};
+
+  /* initial temperature relative to the cost of the input order */
+  double initial_temperature{0.05};
+
+  /* temperature at the end of the budget relative to the initial temperature */
+  double final_temperature{0.01};
+
+  /* probability to swap two adjacent variables instead of two arbitrary ones */
+  double adjacent_swap_probability{0.5};
+};
+
+struct annealing_reordering_stats
+{
+  stopwatch<>::duration_type time_total{0};
+
+  uint64_t num_functions{0};
+
+  /* orders passed to `fn` */
+  uint64_t num_evaluations{0};
+
+  /* moves to orders that were evaluated before or only swap symmetric variables */
+  uint64_t num_revisits{0};
+
+  uint64_t num_accepted_moves{0};
+  uint64_t num_uphill_moves{0};
+
+  /* sum over all functions of the best cost returned by `fn` */
+  uint64_t best_cost_sum{0};
+
+  void report() const
+  {
+    fmt::print( "[i] annealing time = {:8.2f}s for {:8d} functions\n", to_seconds( time_total ), num_functions );
+    fmt::print( "[i]   evaluations = {:8d} (+ {:8d} revisits)\n", num_evaluations, num_revisits );
+    fmt::print( "[i]   accepted moves = {:8d} ({:8d} uphill)\n", num_accepted_moves, num_uphill_moves );
+    fmt::print( "[i]   best cost = {:12d}\n", best_cost_sum );
+  }
+
+  void reset()
+  {
+    *this = {};
+  }
+
+  void merge( annealing_reordering_stats const& other )
+  {
+    time_total += other.time_total;
+    num_functions += other.num_functions;
+    num_evaluations += other.num_evaluations;
+    num_revisits += other.num_revisits;
+    num_accepted_moves += other.num_accepted_moves;
+    num_uphill_moves += other.num_uphill_moves;
+    best_cost_sum += other.best_cost_sum;
+  }
+};
+
+/*! \brief Searches variable orders by simulated annealing.
+ *
+ * Starting from the input order, every move swaps two adjacent or two
+ * arbitrary variables of one truth table in place and passes it to `fn`.  A
+ * move to a cheaper order is always accepted, a move that increases the
+ * cost by `d` with probability `exp(-d / T)`; otherwise it is undone.  The
+ * temperature `T` decreases geometrically from `initial_temperature` times
+ * the cost of the input order to `final_temperature` times that value over
+ * the budget, i.e., the larger fraction used of `max_evaluations` and
+ * `time_budget`.  Costs of visited orders are remembered, such that moves
+ * back to them do not call `fn`; the search also stops after
+ * `max_evaluations` such revisits.  Orders are identified modulo
+ * `symmetry_classes`, and swaps of symmetric variables are not tried.
+ *
+ * `fn` is expected to return the cost of a candidate as in the cost-only
+ * evaluation of `qsp_deps`, where candidates that cannot improve on the best
+ * one are abandoned early; the returned lower bound is used as their cost.
+ */
+class annealing_reordering
+{
+public:
+  explicit annealing_reordering( annealing_reordering_params const& ps = {} )
+    : ps( ps )
+  {
+  }
+
+  explicit annealing_reordering( annealing_reordering_params const& ps, annealing_reordering_stats& st )
+    : ps( ps )
+    , st( &st )
+    , st_mutex( std::make_shared<std::mutex>() )
+  {
+  }
+
+  using statistics_type = annealing_reordering_stats;
+
+  /*! \brief Statistics the candidates are accounted in, or `nullptr`. */
+  statistics_type* statistics() const
+  {
+    return st;
+  }
+
+  /*! \brief Accounts the candidates of later calls in `other` instead. */
+  void set_statistics( statistics_type& other )
+  {
+    st = &other;
+    st_mutex = std::make_shared<std::mutex>();
+  }
+
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return fmt::format( "{} {} {} {} {} {}", ps.max_evaluations, ps.time_budget, ps.seed, ps.initial_temperature, ps.final_temperature,
+                        ps.adjacent_swap_probability );
+  }
+
+  template<typename Fn>
+  void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
+  {
+    (void)initial_cost;
+
+    annealing_reordering_stats local_st;
+    local_st.num_functions = 1u;
+    {
+      stopwatch t( local_st.time_total );
+      anneal( tt, fn, local_st );
+    }
+
+    if ( st )
+    {
+      std::lock_guard<std::mutex> lock( *st_mutex );
+      st->merge( local_st );
+    }
+  }
+
+private:
+  template<typename Fn>
+  void anneal( kitty::dynamic_truth_table const& tt, Fn&& fn, annealing_reordering_stats& local_st ) const
+  {
+    using clock = std::chrono::steady_clock;
+    auto const start = clock::now();
+
+    uint32_t const num_vars = tt.num_vars();
+    auto current = tt;
+    std::vector<uint32_t> var_at( num_vars );
+    std::iota( var_at.begin(), var_at.end(), 0u );
+
+    uint32_t current_cost = fn( current );
+    uint32_t best_cost = current_cost;
+    ++local_st.num_evaluations;
+    local_st.best_cost_sum += best_cost;
+    if ( num_vars < 2u || ps.max_evaluations < 2u || kitty::is_const0( tt ) )
+      return;
+
+    symmetry_classes const classes( tt );
+    std::vector<uint32_t> perm( num_vars );
+    auto const key = [&]() {
+      for ( auto p = 0u; p < num_vars; ++p )
+      {
+        perm[var_at[p]] = p;
+      }
+      return classes.canonical( perm );
+    };
+
+    std::unordered_map<std::vector<uint32_t>, uint32_t, detail::permutation_hash> costs{{key(), current_cost}};
+    splitmix64 random_engine( ps.seed );
+    std::uniform_real_distribution<double> unit( 0.0, 1.0 );
+    std::uniform_int_distribution<uint32_t> position( 0u, num_vars - 1u );
+
+    double const initial_temperature = std::max( 1.0, ps.initial_temperature * current_cost );
+    while ( local_st.num_evaluations < ps.max_evaluations && local_st.num_revisits < ps.max_evaluations )
+    {
+      /* fraction of the budget used so far */
+      auto progress = static_cast<double>( local_st.num_evaluations ) / ps.max_evaluations;
+      if ( ps.time_budget > 0.0 )
+      {
+        auto const elapsed = std::chrono::duration<double>( clock::now() - start ).count();
+        if ( elapsed >= ps.time_budget )
+          break;
+        progress = std::max( progress, elapsed / ps.time_budget );
+      }
+      auto const temperature = initial_temperature * std::pow( ps.final_temperature, progress );
+
+      /* move */
+      uint32_t i = position( random_engine ), j;
+      if ( unit( random_engine ) < ps.adjacent_swap_probability )
+      {
+        i = std::min( i, num_vars - 2u );
+        j = i + 1u;
+      }
+      else
+      {
+        do
+        {
+          j = position( random_engine );
+        } while ( j == i );
+      }
+      auto const swap = [&]() {
+        kitty::swap_inplace( current, i, j );
+        std::swap( var_at[i], var_at[j] );
+      };
+
+      if ( classes.are_symmetric( var_at[i], var_at[j] ) )
+      {
+        ++local_st.num_revisits;
+        continue;
+      }
+
+      swap();
+      uint32_t cost;
+      if ( auto const [it, inserted] = costs.emplace( key(), 0u ); !inserted )
+      {
+        ++local_st.num_revisits;
+        cost = it->second;
+      }
+      else
+      {
+        cost = it->second = fn( current );
+        ++local_st.num_evaluations;
+        if ( cost < best_cost )
+        {
+          local_st.best_cost_sum -= best_cost - cost;
+          best_cost = cost;
+        }
+      }
+
+      if ( cost <= current_cost || unit( random_engine ) < std::exp( ( static_cast<double>( current_cost ) - cost ) / temperature ) )
+      {
+        ++local_st.num_accepted_moves;
+        local_st.num_uphill_moves += cost > current_cost ? 1u : 0u;
+        current_cost = cost;
+      }
+      else
+      {
+        swap();
+      }
+    }
+  }
+
+private:
+  annealing_reordering_params ps;
+  annealing_reordering_stats* st{nullptr};
+  std::shared_ptr<std::mutex> st_mutex;
+};
+
+} // namespace angel
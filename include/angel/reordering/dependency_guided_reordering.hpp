@@ -0,0 +1,301 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file dependency_guided_reordering.hpp
+
+  \brief Variable orders derived from the functional dependencies of the variables
+*/
+
+#pragma once
+
+#include "dp_reordering.hpp"
+#include "reordering_batch.hpp"
+#include <angel/utils/onset_columns.hpp>
+
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace angel
+{
+
+struct dependency_guided_reordering_params
+{
+  /* maximum number of fanins of a dependency (1u to 5u) */
+  uint32_t max_pattern_size{3u};
+
+  /* maximum number of orders passed to `fn` besides the input order */
+  uint32_t max_candidates{4u};
+};
+
+/*! \brief Orders the variables such that dependent variables are below the support of their dependency.
+ *
+ * One analysis pass finds, for every variable, the constant, EQUAL, XOR, and
+ * AND patterns (as in `pattern_deps_analysis`) of at most `max_pattern_size`
+ * other variables, regardless of their position in the input order.  These
+ * patterns form a dependency graph, which may contain cycles (e.g., `a = b`
+ * and `b = a`).  A candidate order is obtained by peeling variables from the
+ * bottom: a variable can be placed below all remaining ones if one of its
+ * patterns only uses remaining variables.  The peeling prefers variables that
+ * are in the support of the fewest other removable variables and then
+ * cheap patterns; further candidates start with a different variable or
+ * prefer cheap patterns first.  The variables that cannot be peeled stay on
+ * top in their input order.
+ *
+ * The input order and at most `max_candidates` distinct candidates are
+ * passed to `fn`, independently of the returned costs.
+ */
+class dependency_guided_reordering
+{
+public:
+  explicit dependency_guided_reordering( dependency_guided_reordering_params const& ps = {} )
+    : ps( ps )
+  {
+  }
+
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return fmt::format( "{} {}", ps.max_pattern_size, ps.max_candidates );
+  }
+
+  template<typename Fn>
+  void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
+  {
+    (void)initial_cost;
+
+    fn( tt );
+    if ( kitty::is_const0( tt ) )
+      return;
+
+    std::vector<kitty::dynamic_truth_table> visited{tt};
+    for ( auto const& order : candidate_orders( tt ) )
+    {
+      auto const candidate = dp_reordering::reorder( tt, order );
+      if ( std::find( visited.begin(), visited.end(), candidate ) != visited.end() )
+        continue;
+
+      visited.emplace_back( candidate );
+      fn( candidate );
+    }
+  }
+
+  /*! \brief Passes the candidates of `foreach_reordering` in batches, see `has_foreach_reordering_batch`. */
+  template<typename Fn>
+  void foreach_reordering_batch( kitty::dynamic_truth_table const& tt, uint32_t batch_size, Fn&& fn ) const
+  {
+    detail::foreach_reordering_in_batches( *this, tt, batch_size, fn );
+  }
+
+  /*! \brief Candidate orders, from the top (first decomposed) variable to the bottom one. */
+  std::vector<std::vector<uint32_t>> candidate_orders( kitty::dynamic_truth_table const& tt ) const
+  {
+    uint32_t const n = tt.num_vars();
+    auto const supports = analyze( tt );
+
+    std::vector<std::vector<uint32_t>> orders;
+    auto const add = [&]( std::vector<uint32_t> const& order ) {
+      if ( orders.size() < ps.max_candidates && std::find( orders.begin(), orders.end(), order ) == orders.end() )
+      {
+        orders.emplace_back( order );
+      }
+    };
+
+    /* variables that can be peeled first, in the order of the preferred rule */
+    auto const first_choices = removable( supports, ( uint64_t( 1u ) << n ) - 1u, true );
+    if ( first_choices.empty() )
+      return orders;
+
+    for ( auto const& first : first_choices )
+    {
+      add( peel( supports, first, true ) );
+    }
+    add( peel( supports, first_choices.front(), false ) );
+    return orders;
+  }
+
+private:
+  struct support
+  {
+    uint64_t mask;
+    uint32_t cost;
+  };
+
+  /* supports[v]: patterns of v, sorted by cost */
+  using dependency_graph = std::vector<std::vector<support>>;
+
+  /* cheapest pattern of v that only uses variables in remaining */
+  static std::optional<uint32_t> pattern_cost( dependency_graph const& supports, uint32_t v, uint64_t remaining )
+  {
+    for ( auto const& s : supports[v] )
+    {
+      if ( ( s.mask & ~remaining ) == 0u )
+        return s.cost;
+    }
+    return std::nullopt;
+  }
+
+  /* variables in remaining that can be placed below all others, most preferred first */
+  std::vector<uint32_t> removable( dependency_graph const& supports, uint64_t remaining, bool least_blocking ) const
+  {
+    uint32_t const n = supports.size();
+
+    struct choice
+    {
+      uint32_t var;
+      uint32_t cost;
+      uint32_t blocked;
+    };
+    std::vector<choice> choices;
+    for ( auto v = 0u; v < n; ++v )
+    {
+      if ( ( ( remaining >> v ) & 1u ) == 0u )
+        continue;
+
+      auto const rest = remaining & ~( uint64_t( 1u ) << v );
+      auto const cost = pattern_cost( supports, v, rest );
+      if ( !cost )
+        continue;
+
+      /* variables that cannot be peeled anymore once v is removed */
+      auto blocked = 0u;
+      for ( auto w = 0u; w < n; ++w )
+      {
+        if ( w != v && ( ( rest >> w ) & 1u ) &&
+             pattern_cost( supports, w, remaining & ~( uint64_t( 1u ) << w ) ) &&
+             !pattern_cost( supports, w, rest & ~( uint64_t( 1u ) << w ) ) )
+        {
+          ++blocked;
+        }
+      }
+      choices.push_back( {v, *cost, blocked} );
+    }
+
+    std::stable_sort( choices.begin(), choices.end(), [&]( auto const& a, auto const& b ) {
+      if ( least_blocking && a.blocked != b.blocked )
+        return a.blocked < b.blocked;
+      if ( a.cost != b.cost )
+        return a.cost < b.cost;
+      return a.blocked < b.blocked;
+    } );
+
+    std::vector<uint32_t> vars( choices.size() );
+    std::transform( choices.begin(), choices.end(), vars.begin(), []( auto const& c ) { return c.var; } );
+    return vars;
+  }
+
+  /* peels first and then the most preferred removable variables */
+  std::vector<uint32_t> peel( dependency_graph const& supports, uint32_t first, bool least_blocking ) const
+  {
+    uint32_t const n = supports.size();
+    uint64_t remaining = ( ( uint64_t( 1u ) << n ) - 1u ) & ~( uint64_t( 1u ) << first );
+    std::vector<uint32_t> bottom_up{first};
+    while ( true )
+    {
+      auto const choices = removable( supports, remaining, least_blocking );
+      if ( choices.empty() )
+        break;
+      bottom_up.emplace_back( choices.front() );
+      remaining &= ~( uint64_t( 1u ) << choices.front() );
+    }
+
+    /* remaining variables on top in input order, then the peeled ones */
+    std::vector<uint32_t> order;
+    for ( auto v = n; v-- > 0u; )
+    {
+      if ( ( remaining >> v ) & 1u )
+        order.emplace_back( v );
+    }
+    order.insert( order.end(), bottom_up.rbegin(), bottom_up.rend() );
+    return order;
+  }
+
+  dependency_graph analyze( kitty::dynamic_truth_table const& tt ) const
+  {
+    uint32_t const n = tt.num_vars();
+    dependency_graph supports( n );
+
+    onset_pattern_matcher matcher( tt );
+    std::vector<uint32_t> fanins;
+    for ( auto i = 0u; i < n; ++i )
+    {
+      if ( matcher.is_constant( i ) )
+      {
+        supports[i].push_back( {0u, 0u} );
+        continue;
+      }
+
+      /* fanin sets of increasing size; supersets of found supports are skipped */
+      auto const check = [&]( uint64_t mask ) {
+        for ( auto const& s : supports[i] )
+        {
+          if ( ( s.mask & ~mask ) == 0u )
+            return;
+        }
+        if ( auto const cost = matcher.pattern_cost( i, mask ) )
+        {
+          supports[i].push_back( {mask, *cost} );
+        }
+      };
+
+      auto const enumerate = [&]( auto&& self, uint32_t from, uint64_t mask, uint32_t size ) -> void {
+        for ( auto j = from; j < n; ++j )
+        {
+          if ( j == i )
+            continue;
+          fanins.push_back( j );
+          if ( fanins.size() == size )
+          {
+            check( mask | ( uint64_t( 1u ) << j ) );
+          }
+          else
+          {
+            self( self, j + 1u, mask | ( uint64_t( 1u ) << j ), size );
+          }
+          fanins.pop_back();
+        }
+      };
+      for ( auto size = 1u; size <= ps.max_pattern_size; ++size )
+      {
+        enumerate( enumerate, 0u, 0u, size );
+      }
+
+      std::stable_sort( supports[i].begin(), supports[i].end(), []( auto const& a, auto const& b ) { return a.cost < b.cost; } );
+    }
+
+    return supports;
+  }
+
+private:
+  dependency_guided_reordering_params ps;
+};
+
+} // namespace angel
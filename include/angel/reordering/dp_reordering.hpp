@@ -0,0 +1,277 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file dp_reordering.hpp
+
+  \brief Variable ordering by dynamic programming over subsets
+*/
+
+#pragma once
+
+#include "greedy_reordering.hpp"
+#include <angel/utils/onset_columns.hpp>
+#include <angel/utils/permutation.hpp>
+
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace angel
+{
+
+struct dp_reordering_params
+{
+  /* orders of functions with more variables are searched by greedy_reordering */
+  uint32_t max_exact_vars{16u};
+
+  /* maximum number of fanins of a dependency considered by the cost model (1u to 5u) */
+  uint32_t max_pattern_size{3u};
+};
+
+/*! \brief Finds a variable order by dynamic programming over subsets.
+ *
+ * The state preparation cost of a qubit is estimated from the set of
+ * variables above it: a qubit that is a constant costs nothing, a qubit that
+ * is an EQUAL, XOR, or AND pattern of variables above it costs as much as the
+ * pattern (as in `pattern_deps_analysis`), and any other qubit costs `2^k`
+ * CNOTs, where `k` is the number of qubits above it that are neither
+ * constants nor patterns.  Hence, the cost of a prefix of the order depends
+ * only on its set of variables and on its number of such control qubits, and
+ * the cheapest order is found with `O(n 2^n)` states instead of `n!`
+ * permutations.  The pattern costs are precomputed per variable and subset.
+ *
+ * The input order and the best order under this model are passed to `fn`.
+ * Functions with more than `max_exact_vars` variables are reordered with
+ * `greedy_reordering` instead.
+ */
+class dp_reordering
+{
+public:
+  explicit dp_reordering( dp_reordering_params const& ps = {} )
+    : ps( ps )
+  {
+  }
+
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return fmt::format( "{} {}", ps.max_exact_vars, ps.max_pattern_size );
+  }
+
+  template<typename Fn>
+  void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
+  {
+    if ( static_cast<uint32_t>( tt.num_vars() ) > ps.max_exact_vars )
+    {
+      greedy_reordering{}.foreach_reordering( tt, fn, initial_cost );
+      return;
+    }
+
+    fn( tt );
+    if ( kitty::is_const0( tt ) )
+      return;
+
+    auto const order = best_order( tt );
+    auto const reordered = reorder( tt, order );
+    if ( reordered != tt )
+    {
+      fn( reordered );
+    }
+  }
+
+  /*! \brief Best order under the cost model, from the top (first decomposed) variable to the bottom one. */
+  std::vector<uint32_t> best_order( kitty::dynamic_truth_table const& tt ) const
+  {
+    uint32_t const n = tt.num_vars();
+    auto const m = analyze( tt );
+    uint64_t const num_subsets = uint64_t( 1u ) << n;
+    uint32_t const num_counts = n + 1u;
+
+    /* cost[s * num_counts + k]: cheapest order of the variables in s on top,
+       k of which are controls; choice: variable placed last */
+    constexpr auto unreachable = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> cost( num_subsets * num_counts, unreachable );
+    std::vector<uint8_t> choice( num_subsets * num_counts, 0u );
+    cost[0u] = 0u;
+
+    for ( uint64_t s = 0u; s < num_subsets; ++s )
+    {
+      for ( auto k = 0u; k <= n; ++k )
+      {
+        auto const c = cost[s * num_counts + k];
+        if ( c == unreachable )
+          continue;
+
+        for ( auto v = 0u; v < n; ++v )
+        {
+          if ( ( s >> v ) & 1u )
+            continue;
+
+          auto const [qubit_cost, control] = m.qubit_cost( v, s, k );
+          auto const next = ( s | ( uint64_t( 1u ) << v ) ) * num_counts + k + ( control ? 1u : 0u );
+          if ( c + qubit_cost < cost[next] )
+          {
+            cost[next] = c + qubit_cost;
+            choice[next] = v;
+          }
+        }
+      }
+    }
+
+    /* backtrack from the cheapest complete order */
+    auto s = num_subsets - 1u;
+    auto k = 0u;
+    for ( auto i = 1u; i <= n; ++i )
+    {
+      if ( cost[s * num_counts + i] < cost[s * num_counts + k] )
+      {
+        k = i;
+      }
+    }
+
+    std::vector<uint32_t> order( n );
+    for ( auto i = n; i-- > 0u; )
+    {
+      uint32_t const v = choice[s * num_counts + k];
+      order[i] = v;
+      s &= ~( uint64_t( 1u ) << v );
+      k -= m.qubit_cost( v, s, 0u ).second ? 1u : 0u;
+    }
+    return order;
+  }
+
+  /*! \brief Cost of an order (top to bottom) under the cost model. */
+  uint32_t estimated_cost( kitty::dynamic_truth_table const& tt, std::vector<uint32_t> const& order ) const
+  {
+    auto const m = analyze( tt );
+    uint64_t s{0u};
+    auto k = 0u;
+    auto total = 0u;
+    for ( auto const& v : order )
+    {
+      auto const [qubit_cost, control] = m.qubit_cost( v, s, k );
+      total += qubit_cost;
+      k += control ? 1u : 0u;
+      s |= uint64_t( 1u ) << v;
+    }
+    return total;
+  }
+
+  /*! \brief Reorders `tt` such that `order[0]` becomes the top (most significant) variable. */
+  static kitty::dynamic_truth_table reorder( kitty::dynamic_truth_table const& tt, std::vector<uint32_t> const& order )
+  {
+    uint32_t const n = tt.num_vars();
+    std::vector<uint32_t> perm( n );
+    for ( auto p = 0u; p < n; ++p )
+    {
+      perm[order[p]] = n - 1u - p;
+    }
+    return permute_variables( tt, perm );
+  }
+
+private:
+  struct cost_model
+  {
+    uint32_t num_vars;
+    /* bit i is set if variable i is constant in the onset */
+    uint64_t constants{0u};
+    /* pattern_cost[i << num_vars | s]: cheapest pattern of variable i with fanins in s */
+    std::vector<uint8_t> pattern_cost;
+
+    static constexpr uint8_t no_pattern = std::numeric_limits<uint8_t>::max();
+
+    /* CNOT cost of variable v below the variables s, k of which are controls,
+       and whether v becomes a control */
+    std::pair<uint32_t, bool> qubit_cost( uint32_t v, uint64_t s, uint32_t k ) const
+    {
+      if ( ( constants >> v ) & 1u )
+      {
+        return {0u, false};
+      }
+      if ( auto const c = pattern_cost[( uint64_t( v ) << num_vars ) | s]; c != no_pattern )
+      {
+        return {c, false};
+      }
+      return {k == 0u ? 0u : ( 1u << k ), true};
+    }
+  };
+
+  cost_model analyze( kitty::dynamic_truth_table const& tt ) const
+  {
+    uint32_t const n = tt.num_vars();
+    uint64_t const num_subsets = uint64_t( 1u ) << n;
+
+    cost_model m;
+    m.num_vars = n;
+    m.pattern_cost.assign( n * num_subsets, cost_model::no_pattern );
+
+    onset_pattern_matcher matcher( tt );
+    for ( auto i = 0u; i < n; ++i )
+    {
+      if ( matcher.is_constant( i ) )
+      {
+        m.constants |= uint64_t( 1u ) << i;
+        continue;
+      }
+
+      auto* costs = &m.pattern_cost[uint64_t( i ) << n];
+      for ( uint64_t s = 1u; s < num_subsets; ++s )
+      {
+        if ( ( ( s >> i ) & 1u ) || static_cast<uint32_t>( __builtin_popcountll( s ) ) > ps.max_pattern_size )
+          continue;
+
+        if ( auto const cost = matcher.pattern_cost( i, s ) )
+        {
+          costs[s] = *cost;
+        }
+      }
+
+      /* a pattern is available for every superset of its fanins */
+      for ( auto j = 0u; j < n; ++j )
+      {
+        for ( uint64_t s = 0u; s < num_subsets; ++s )
+        {
+          if ( ( s >> j ) & 1u )
+          {
+            costs[s] = std::min( costs[s], costs[s ^ ( uint64_t( 1u ) << j )] );
+          }
+        }
+      }
+    }
+
+    return m;
+  }
+
+private:
+  dp_reordering_params ps;
+};
+
+} // namespace angel
@@ -1,33 +1,174 @@
+#pragma once
+
+#include "reordering_batch.hpp"
+#include "symmetry_classes.hpp"
+
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include <fmt/format.h>
 #include <kitty/kitty.hpp>
 
 namespace angel
 {
 
+struct exhaustive_reordering_stats
+{
+  uint64_t num_functions{0};
+
+  /* orders passed to `fn` */
+  uint64_t num_orders{0};
+
+  /* orders skipped because they only differ from a passed one in the positions of symmetric variables */
+  uint64_t num_skipped{0};
+
+  void report() const
+  {
+    fmt::print( "[i] exhaustive orders: {:8d} ({:8d} skipped by symmetry) for {:8d} functions\n", num_orders, num_skipped, num_functions );
+  }
+
+  void reset()
+  {
+    *this = {};
+  }
+
+  void merge( exhaustive_reordering_stats const& other )
+  {
+    num_functions += other.num_functions;
+    num_orders += other.num_orders;
+    num_skipped += other.num_skipped;
+  }
+};
+
+/*! \brief Enumerates all variable orders.
+ *
+ * The orders are enumerated in Steinhaus-Johnson-Trotter (plain changes)
+ * order, such that every order is obtained from the previous one by swapping
+ * two adjacent variables of the same truth table.  Orders that only differ
+ * in the positions of symmetric variables yield the same truth table; of
+ * those, only the canonical order of `symmetry_classes` is passed to `fn`.
+ */
 class exhaustive_reordering
 {
 public:
+  exhaustive_reordering() = default;
+
+  explicit exhaustive_reordering( exhaustive_reordering_stats& st )
+    : st( &st )
+    , st_mutex( std::make_shared<std::mutex>() )
+  {
+  }
+
+  using statistics_type = exhaustive_reordering_stats;
+
+  /*! \brief Statistics the candidates are accounted in, or `nullptr`. */
+  statistics_type* statistics() const
+  {
+    return st;
+  }
+
+  /*! \brief Accounts the candidates of later calls in `other` instead. */
+  void set_statistics( statistics_type& other )
+  {
+    st = &other;
+    st_mutex = std::make_shared<std::mutex>();
+  }
+
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return {};
+  }
+
   template<typename Fn>
   void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
   {
     (void)initial_cost;
-    
-    std::vector<uint32_t> perm;
-    for ( auto i = 0u; i < tt.num_vars(); ++i )
+
+    uint32_t const num_vars = tt.num_vars();
+    symmetry_classes const classes( tt );
+    exhaustive_reordering_stats local_st;
+    local_st.num_functions = 1u;
+
+    /* perm[i]: variable of tt at position i of the current truth table */
+    std::vector<uint32_t> perm( num_vars ), position( num_vars );
+    std::vector<int8_t> direction( num_vars, -1 );
+    for ( auto i = 0u; i < num_vars; ++i )
+    {
+      perm[i] = position[i] = i;
+    }
+
+    auto current = tt;
+    fn( current );
+    ++local_st.num_orders;
+
+    while ( true )
     {
-      perm.emplace_back( i );
+      /* largest mobile variable, i.e., whose neighbor in its direction is smaller */
+      int32_t mobile = -1;
+      for ( auto v = static_cast<int32_t>( num_vars ) - 1; v >= 0; --v )
+      {
+        auto const next = static_cast<int32_t>( position[v] ) + direction[v];
+        if ( next >= 0 && next < static_cast<int32_t>( num_vars ) && perm[next] < static_cast<uint32_t>( v ) )
+        {
+          mobile = v;
+          break;
+        }
+      }
+      if ( mobile == -1 )
+        break;
+
+      auto const p = position[mobile];
+      auto const q = p + direction[mobile];
+      auto const lower = std::min( p, q );
+      auto const other = perm[q];
+
+      /* swapping symmetric variables does not change the truth table */
+      if ( !classes.are_symmetric( mobile, other ) )
+      {
+        kitty::swap_adjacent_inplace( current, lower );
+      }
+      std::swap( perm[p], perm[q] );
+      position[mobile] = q;
+      position[other] = p;
+
+      for ( auto v = static_cast<uint32_t>( mobile ) + 1u; v < num_vars; ++v )
+      {
+        direction[v] = -direction[v];
+      }
+
+      if ( classes.is_canonical( position ) )
+      {
+        fn( current );
+        ++local_st.num_orders;
+      }
+      else
+      {
+        ++local_st.num_skipped;
+      }
     }
 
-    do
+    if ( st )
     {
-      kitty::dynamic_truth_table tt_( tt );
-      angel::reordering_on_tt_inplace( tt_, perm );
-      fn( tt_ );
+      std::lock_guard<std::mutex> lock( *st_mutex );
+      st->merge( local_st );
     }
-    while ( std::next_permutation( std::begin( perm ), std::end( perm ) ) );
   }
-}; 
 
-} /// namespace angel end
\ No newline at end of file
+  /*! \brief Passes the candidates of `foreach_reordering` in batches, see `has_foreach_reordering_batch`. */
+  template<typename Fn>
+  void foreach_reordering_batch( kitty::dynamic_truth_table const& tt, uint32_t batch_size, Fn&& fn ) const
+  {
+    detail::foreach_reordering_in_batches( *this, tt, batch_size, fn );
+  }
+
+private:
+  exhaustive_reordering_stats* st{nullptr};
+  std::shared_ptr<std::mutex> st_mutex;
+};
+
+} /// namespace angel end
@@ -1,29 +1,108 @@
+#pragma once
+
+#include "symmetry_classes.hpp"
+
 #include <algorithm>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <string>
 #include <vector>
+#include <fmt/format.h>
 #include <kitty/kitty.hpp>
 
 namespace angel
 {
 
+struct greedy_reordering_stats
+{
+  uint64_t num_functions{0};
+
+  /* orders passed to `fn` */
+  uint64_t num_orders{0};
+
+  /* swaps of symmetric variables, which are skipped without swapping the truth table */
+  uint64_t num_skipped{0};
+
+  void report() const
+  {
+    fmt::print( "[i] greedy orders: {:8d} ({:8d} skipped by symmetry) for {:8d} functions\n", num_orders, num_skipped, num_functions );
+  }
+
+  void reset()
+  {
+    *this = {};
+  }
+
+  void merge( greedy_reordering_stats const& other )
+  {
+    num_functions += other.num_functions;
+    num_orders += other.num_orders;
+    num_skipped += other.num_skipped;
+  }
+};
+
 class greedy_reordering
 {
 public:
+  greedy_reordering() = default;
+
+  explicit greedy_reordering( greedy_reordering_stats& st )
+    : st( &st )
+    , st_mutex( std::make_shared<std::mutex>() )
+  {
+  }
+
+  using statistics_type = greedy_reordering_stats;
+
+  /*! \brief Statistics the candidates are accounted in, or `nullptr`. */
+  statistics_type* statistics() const
+  {
+    return st;
+  }
+
+  /*! \brief Accounts the candidates of later calls in `other` instead. */
+  void set_statistics( statistics_type& other )
+  {
+    st = &other;
+    st_mutex = std::make_shared<std::mutex>();
+  }
+
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return {};
+  }
+
+  /* `initial_cost` bounds the cost of accepted reorderings, e.g., by a known
+     upper bound; candidates that reach it are never accepted */
   template<typename Fn>
   void foreach_reordering( kitty::dynamic_truth_table tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
   {
     kitty::dynamic_truth_table first_tt{tt};
 
     uint32_t const num_variables = tt.num_vars();
+    symmetry_classes const classes( tt );
+    greedy_reordering_stats local_st;
+    local_st.num_functions = 1u;
 
-    fn( first_tt );
+    /* var_at[p]: variable of first_tt at position p of tt */
+    std::vector<uint32_t> var_at( num_variables );
+    std::iota( var_at.begin(), var_at.end(), 0u );
 
     std::vector<uint8_t> perm( num_variables );
     std::iota( perm.begin(), perm.end(), 0u );
     std::reverse( perm.begin(), perm.end() );
 
-    uint32_t best_cost = initial_cost ? *initial_cost : fn( tt );
+    uint32_t best_cost = fn( first_tt );
+    ++local_st.num_orders;
+    if ( initial_cost )
+    {
+      best_cost = std::min( best_cost, *initial_cost );
+    }
     bool forward = true;
     bool improvement = true;
 
@@ -34,16 +113,24 @@ public:
       for ( int32_t i = forward ? 0 : num_variables - 2; forward ? i < static_cast<int32_t>( num_variables - 1 ) : i >= 0; forward ? ++i : --i )
       {
         bool local_improvement = false;
+        if ( classes.are_symmetric( var_at[perm[i]], var_at[perm[i + 1]] ) )
+        {
+          ++local_st.num_skipped;
+          continue;
+        }
+
         kitty::dynamic_truth_table const next_tt = kitty::swap( tt, perm[i], perm[i + 1] );
 
         if ( next_tt == first_tt || next_tt == tt )
           continue;
 
         uint32_t const cost = fn( next_tt );
+        ++local_st.num_orders;
         if ( cost < best_cost )
         {
           best_cost = cost;
           tt = next_tt;
+          std::swap( var_at[perm[i]], var_at[perm[i + 1]] );
           std::swap( perm[i], perm[i + 1] );
           local_improvement = true;
         }
@@ -58,7 +145,17 @@ public:
 
       forward = !forward;
     }
+
+    if ( st )
+    {
+      std::lock_guard<std::mutex> lock( *st_mutex );
+      st->merge( local_st );
+    }
   }
-}; 
+
+private:
+  greedy_reordering_stats* st{nullptr};
+  std::shared_ptr<std::mutex> st_mutex;
+};
 
 } // namespace angel end
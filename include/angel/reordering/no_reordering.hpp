@@ -1,4 +1,7 @@
+#pragma once
+
 #include <algorithm>
+#include <string>
 #include <vector>
 
 #include <kitty/kitty.hpp>
@@ -9,6 +12,12 @@ namespace angel
 class no_reordering
 {
 public:
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return {};
+  }
+
   template<typename Fn>
   void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
   {
@@ -1,11 +1,160 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file random_reordering.hpp
+
+  \brief Random variable orders
+*/
+
+#pragma once
+
+#include "reordering_batch.hpp"
+#include "symmetry_classes.hpp"
+#include <angel/utils/helper_functions.hpp>
+#include <angel/utils/permutation.hpp>
+#include <angel/utils/splitmix64.hpp>
+
+#include <fmt/format.h>
+#include <kitty/kitty.hpp>
+
 #include <algorithm>
-#include <chrono>
-#include <random>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace angel
 {
 
+namespace detail
+{
+
+/* hash of a variable order: 4 bits per variable up to 16 variables (hence
+   without collisions), a 64-bit FNV-style hash otherwise */
+struct permutation_hash
+{
+  std::size_t operator()( std::vector<uint32_t> const& perm ) const
+  {
+    uint64_t key{0u};
+    if ( perm.size() <= 16u )
+    {
+      for ( auto const& v : perm )
+      {
+        key = ( key << 4u ) | v;
+      }
+      return key;
+    }
+
+    for ( auto const& v : perm )
+    {
+      key = ( key ^ v ) * 0x100000001b3;
+      key ^= key >> 29u;
+    }
+    return key;
+  }
+};
+
+/* set of variable orders, collisions of their hashes are resolved by comparing the orders */
+using permutation_set = std::unordered_set<std::vector<uint32_t>, permutation_hash>;
+
+} // namespace detail
+
+struct random_reordering_stats
+{
+  /* number of samples (the input order and the random orders) after which the best cost is recorded */
+  std::vector<uint64_t> checkpoints;
+
+  /* best_cost_sum[i]: sum over all functions of the best cost among the first checkpoints[i] samples */
+  std::vector<uint64_t> best_cost_sum;
+
+  uint64_t num_functions{0};
+  uint64_t num_samples{0};
+
+  /* samples skipped because their order was sampled before or leaves the truth table unchanged */
+  uint64_t num_duplicates{0};
+
+  /* duplicates that only differ from an earlier sample in the positions of symmetric variables */
+  uint64_t num_symmetric{0};
+
+  void report() const
+  {
+    fmt::print( "[i] sampled orders:  {:8d} ({:8d} duplicates, {:8d} by symmetry) for {:8d} functions\n", num_samples, num_duplicates, num_symmetric, num_functions );
+    for ( auto i = 0u; i < checkpoints.size(); ++i )
+    {
+      fmt::print( "[i]   best cost after {:8d} samples = {:12d}\n", checkpoints[i], best_cost_sum[i] );
+    }
+  }
+
+  void reset()
+  {
+    *this = {};
+  }
+
+  void merge( random_reordering_stats const& other )
+  {
+    if ( checkpoints.size() < other.checkpoints.size() )
+    {
+      checkpoints = other.checkpoints;
+      best_cost_sum.resize( other.best_cost_sum.size(), 0u );
+    }
+    for ( auto i = 0u; i < other.best_cost_sum.size(); ++i )
+    {
+      best_cost_sum[i] += other.best_cost_sum[i];
+    }
+    num_functions += other.num_functions;
+    num_samples += other.num_samples;
+    num_duplicates += other.num_duplicates;
+    num_symmetric += other.num_symmetric;
+  }
+};
+
+/*! \brief Passes the input order and `num_reordering` random orders to `fn`.
+ *
+ * Unlike the original sampler, the unchanged input order is always the first
+ * candidate, as in `exhaustive_reordering` and `no_reordering`.  Otherwise a
+ * function that no random order changes (e.g., a symmetric one) or
+ * `num_reordering = 0` left `qsp_deps` without any candidate, and the input
+ * order could never be selected even when it is the cheapest one.
+ *
+ * Sample `i` is drawn from its own counter-based stream `splitmix64( seed, i )`
+ * (see `order`), such that the sequence of orders is reproducible and does not
+ * depend on how the samples are split into batches or among workers.  Orders
+ * that were sampled before are recognized in expected constant time by
+ * hashing their canonical order modulo `symmetry_classes` (see
+ * `detail::permutation_hash`) and skipped, as are orders that leave the truth
+ * table unchanged.
+ *
+ * If statistics are given, the best cost returned by `fn` after 1, 2, 4, ...
+ * and all samples is accumulated into a quality-vs-samples curve.
+ */
 class random_reordering
 {
 public:
@@ -14,47 +163,164 @@ public:
     , num_reordering( num_reordering )
   {
   }
-  
+
+  explicit random_reordering( uint64_t seed, uint64_t num_reordering, random_reordering_stats& st )
+    : seed( seed )
+    , num_reordering( num_reordering )
+    , st( &st )
+    , st_mutex( std::make_shared<std::mutex>() )
+  {
+  }
+
+  using statistics_type = random_reordering_stats;
+
+  /*! \brief Statistics the candidates are accounted in, or `nullptr`. */
+  statistics_type* statistics() const
+  {
+    return st;
+  }
+
+  /*! \brief Accounts the candidates of later calls in `other` instead. */
+  void set_statistics( statistics_type& other )
+  {
+    st = &other;
+    st_mutex = std::make_shared<std::mutex>();
+  }
+
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return fmt::format( "{} {}", seed, num_reordering );
+  }
+
   template<typename Fn>
   void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
   {
     (void)initial_cost;
 
-    fn( tt );
+    foreach_reordering_batch( tt, 1u, [&]( std::vector<kitty::dynamic_truth_table> const& batch ) {
+      return std::vector<uint32_t>{static_cast<uint32_t>( fn( batch.front() ) )};
+    } );
+  }
 
-    if ( num_reordering == 0u )
-      return;
+  /*! \brief Passes the candidates of `foreach_reordering` in batches, see `has_foreach_reordering_batch`. */
+  template<typename Fn>
+  void foreach_reordering_batch( kitty::dynamic_truth_table const& tt, uint32_t batch_size, Fn&& fn ) const
+  {
+    uint32_t const num_vars = tt.num_vars();
+    auto const points = checkpoints();
+    random_reordering_stats local_st;
+    local_st.checkpoints = points;
+    local_st.num_functions = 1u;
+    local_st.num_samples = num_reordering + 1u;
 
-    std::vector<uint32_t> perm;
-    for ( auto i = 0u; i < tt.num_vars(); ++i )
-    {
-      perm.emplace_back( i );
-    }
-    
-    std::default_random_engine random_engine( seed );
-    std::vector<std::vector<uint32_t>> orders;
-    for ( auto i = 0u; i < num_reordering; ++i )
+    /* curve: best cost among the samples before the next checkpoint */
+    auto best_cost = std::numeric_limits<uint32_t>::max();
+    auto next_point = 0u;
+    auto const record_until = [&]( uint64_t sample ) {
+      for ( ; next_point < points.size() && points[next_point] <= sample; ++next_point )
+      {
+        local_st.best_cost_sum.emplace_back( best_cost );
+      }
+    };
+
+    std::vector<kitty::dynamic_truth_table> batch;
+    std::vector<uint64_t> batch_samples;
+    batch.reserve( batch_size );
+    batch_samples.reserve( batch_size );
+    auto const flush = [&]() {
+      if ( batch.empty() )
+        return;
+
+      auto const costs = fn( static_cast<std::vector<kitty::dynamic_truth_table> const&>( batch ) );
+      for ( auto i = 0u; i < batch.size() && i < costs.size(); ++i )
+      {
+        record_until( batch_samples[i] );
+        best_cost = std::min<uint32_t>( best_cost, costs[i] );
+      }
+      batch.clear();
+      batch_samples.clear();
+    };
+    auto const add = [&]( kitty::dynamic_truth_table const& candidate, uint64_t sample ) {
+      batch.emplace_back( candidate );
+      batch_samples.emplace_back( sample );
+      if ( batch.size() >= batch_size )
+      {
+        flush();
+      }
+    };
+
+    add( tt, 0u );
+
+    symmetry_classes const classes( tt );
+    std::vector<uint32_t> identity( num_vars );
+    std::iota( identity.begin(), identity.end(), 0u );
+
+    /* sampled orders and their canonical orders */
+    detail::permutation_set visited{identity}, visited_canonical{identity};
+    visited.reserve( num_reordering );
+    visited_canonical.reserve( classes.is_trivial() ? 0u : num_reordering );
+    for ( uint64_t sample = 1u; sample <= num_reordering; ++sample )
     {
-      std::shuffle( std::begin( perm ), std::end( perm ), random_engine );
+      auto const perm = reordering_permutation( num_vars, order( num_vars, sample - 1u ) );
+      if ( !visited.emplace( perm ).second )
+      {
+        ++local_st.num_duplicates;
+        continue;
+      }
+      if ( !classes.is_trivial() && !visited_canonical.emplace( classes.canonical( perm ) ).second )
+      {
+        ++local_st.num_duplicates;
+        ++local_st.num_symmetric;
+        continue;
+      }
 
-      if ( std::find( std::begin( orders ), std::end( orders ), perm ) == orders.end() )
+      auto const candidate = permute_variables( tt, perm );
+      if ( candidate == tt )
       {
-        kitty::dynamic_truth_table tt_( tt );
-        angel::reordering_on_tt_inplace( tt_, perm );
-
-        if ( tt != tt_ )
-        {
-          fn( tt_ );
-          orders.emplace_back( perm );
-          std::sort( std::begin( perm ), std::end( perm ) );
-        }
+        ++local_st.num_duplicates;
+        continue;
       }
+      add( candidate, sample );
+    }
+    flush();
+    record_until( num_reordering + 1u );
+
+    if ( st )
+    {
+      std::lock_guard<std::mutex> lock( *st_mutex );
+      st->merge( local_st );
+    }
+  }
+
+  /*! \brief The `index`-th random order, which depends only on the seed and on `index`. */
+  std::vector<uint32_t> order( uint32_t num_vars, uint64_t index ) const
+  {
+    std::vector<uint32_t> perm( num_vars );
+    std::iota( perm.begin(), perm.end(), 0u );
+    splitmix64 random_engine( seed, index );
+    std::shuffle( perm.begin(), perm.end(), random_engine );
+    return perm;
+  }
+
+private:
+  /* 1, 2, 4, ... samples and all samples */
+  std::vector<uint64_t> checkpoints() const
+  {
+    std::vector<uint64_t> points;
+    for ( uint64_t point = 1u; point < num_reordering + 1u; point <<= 1u )
+    {
+      points.emplace_back( point );
     }
+    points.emplace_back( num_reordering + 1u );
+    return points;
   }
 
 protected:
   uint64_t seed;
   uint64_t num_reordering;
-}; 
+  random_reordering_stats* st{nullptr};
+  std::shared_ptr<std::mutex> st_mutex;
+};
 
 } // namespace angel
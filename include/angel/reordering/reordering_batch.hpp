@@ -0,0 +1,98 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file reordering_batch.hpp
+
+  \brief Batched enumeration of reordering candidates
+*/
+
+#pragma once
+
+#include <kitty/dynamic_truth_table.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Whether `Strategy` enumerates its candidates in batches.
+ *
+ * Strategies whose candidates do not depend on the costs returned by `fn`
+ * (e.g., exhaustive or random orders) provide
+ * `foreach_reordering_batch( tt, batch_size, fn )`, which passes the
+ * candidates of `foreach_reordering` in the same order to `fn` as vectors of
+ * at most `batch_size` truth tables, such that they can be costed in
+ * parallel.  `fn` returns the costs of the candidates of a batch.
+ */
+template<class Strategy, class = void>
+struct has_foreach_reordering_batch : std::false_type
+{
+};
+
+template<class Strategy>
+struct has_foreach_reordering_batch<Strategy, std::void_t<decltype( std::declval<Strategy const&>().foreach_reordering_batch(
+                                                  std::declval<kitty::dynamic_truth_table const&>(), uint32_t{},
+                                                  std::declval<std::vector<uint32_t> ( & )( std::vector<kitty::dynamic_truth_table> const& )>() ) )>>
+    : std::true_type
+{
+};
+
+template<class Strategy>
+inline constexpr bool has_foreach_reordering_batch_v = has_foreach_reordering_batch<Strategy>::value;
+
+namespace detail
+{
+
+/* collects the candidates of a cost-independent strategy into batches; the
+   costs of a batch are only known after the strategy has passed all of its
+   candidates, hence the callback passed to `foreach_reordering` returns
+   nothing, and strategies that use the costs returned by it do not compile */
+template<class Strategy, class Fn>
+void foreach_reordering_in_batches( Strategy const& strategy, kitty::dynamic_truth_table const& tt, uint32_t batch_size, Fn&& fn )
+{
+  std::vector<kitty::dynamic_truth_table> batch;
+  batch.reserve( batch_size );
+  strategy.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) -> void {
+    batch.emplace_back( candidate );
+    if ( batch.size() >= batch_size )
+    {
+      fn( static_cast<std::vector<kitty::dynamic_truth_table> const&>( batch ) );
+      batch.clear();
+    }
+  } );
+
+  if ( !batch.empty() )
+  {
+    fn( static_cast<std::vector<kitty::dynamic_truth_table> const&>( batch ) );
+  }
+}
+
+} // namespace detail
+
+} // namespace angel
@@ -0,0 +1,151 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file sifting_reordering.hpp
+
+  \brief Variable reordering by sifting
+*/
+
+#pragma once
+
+#include <fmt/format.h>
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace angel
+{
+
+struct sifting_reordering_params
+{
+  /* maximum number of passes over all variables; passes stop when one does not improve */
+  uint32_t max_rounds{1u};
+};
+
+/*! \brief Sifts every variable through all positions and keeps the best one.
+ *
+ * As in BDD sifting, a variable is first moved to the closer end of the
+ * order, then to the other end, and finally back to the position of the
+ * cheapest order.  All moves are adjacent swaps of one truth table that is
+ * updated in place, and every position of the variable is evaluated once,
+ * i.e., a round passes `n (n - 1)` orders to `fn`.
+ *
+ * `initial_cost` bounds the cost of accepted orders, as in
+ * `greedy_reordering`.
+ */
+class sifting_reordering
+{
+public:
+  explicit sifting_reordering( sifting_reordering_params const& ps = {} )
+    : ps( ps )
+  {
+  }
+
+  /*! \brief Parameters that affect the chosen orders, see `qsp_deps::cost_model_tag`. */
+  std::string fingerprint() const
+  {
+    return fmt::format( "{}", ps.max_rounds );
+  }
+
+  template<typename Fn>
+  void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
+  {
+    uint32_t const num_vars = tt.num_vars();
+
+    auto current = tt;
+    uint32_t best_cost = fn( current );
+    if ( initial_cost )
+    {
+      best_cost = std::min( best_cost, *initial_cost );
+    }
+    if ( num_vars < 2u )
+      return;
+
+    /* position[v]: position of variable v of tt in current */
+    std::vector<uint32_t> position( num_vars ), var_at( num_vars );
+    for ( auto i = 0u; i < num_vars; ++i )
+    {
+      position[i] = var_at[i] = i;
+    }
+
+    auto const move = [&]( uint32_t from, uint32_t to ) {
+      auto const lower = std::min( from, to );
+      kitty::swap_adjacent_inplace( current, lower );
+      std::swap( var_at[from], var_at[to] );
+      position[var_at[from]] = from;
+      position[var_at[to]] = to;
+    };
+
+    for ( auto round = 0u; round < ps.max_rounds; ++round )
+    {
+      auto improvement = false;
+
+      /* sift the variables from the top of the order */
+      for ( auto v = num_vars; v-- > 0u; )
+      {
+        auto const start = position[v];
+        auto best_position = start;
+
+        /* visits the positions from start (exclusive) to end (inclusive) */
+        auto const sift = [&]( uint32_t end, bool evaluate ) {
+          while ( position[v] != end )
+          {
+            auto const p = position[v];
+            move( p, p < end ? p + 1u : p - 1u );
+            if ( !evaluate )
+              continue;
+
+            if ( auto const cost = fn( current ); cost < best_cost )
+            {
+              best_cost = cost;
+              best_position = position[v];
+              improvement = true;
+            }
+          }
+        };
+
+        auto const closer_end = start < num_vars - 1u - start ? 0u : num_vars - 1u;
+        auto const other_end = num_vars - 1u - closer_end;
+        sift( closer_end, true );
+        sift( start, false );
+        sift( other_end, true );
+        sift( best_position, false );
+      }
+
+      if ( !improvement )
+        break;
+    }
+  }
+
+private:
+  sifting_reordering_params ps;
+};
+
+} // namespace angel
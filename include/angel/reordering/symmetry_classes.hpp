@@ -0,0 +1,166 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file symmetry_classes.hpp
+
+  \brief Classes of symmetric variables for reordering strategies
+*/
+
+#pragma once
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/properties.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Partitions the variables of a truth table into classes of symmetric variables.
+ *
+ * Two variables are symmetric if swapping them leaves the truth table
+ * unchanged.  Since this relation is an equivalence, two orders give the
+ * same truth table if they only differ in the positions of symmetric
+ * variables.  Every class of such orders has one canonical order, in which
+ * the variables of each class keep their relative order; reordering
+ * strategies pass only canonical orders to their cost function, i.e.,
+ * `n! / (|C_1|! ... |C_k|!)` instead of `n!` orders.
+ *
+ * Orders are given as permutations that move variable `v` to position
+ * `perm[v]` (as in `permute_variables`).
+ */
+class symmetry_classes
+{
+public:
+  explicit symmetry_classes( kitty::dynamic_truth_table const& tt )
+      : class_of( tt.num_vars() )
+  {
+    uint32_t const n = tt.num_vars();
+    for ( auto i = 0u; i < n; ++i )
+    {
+      class_of[i] = i;
+      for ( auto j = 0u; j < i; ++j )
+      {
+        if ( class_of[j] == j && kitty::is_symmetric_in( tt, j, i ) )
+        {
+          class_of[i] = j;
+          break;
+        }
+      }
+      num_classes_ += class_of[i] == i ? 1u : 0u;
+    }
+  }
+
+  uint32_t num_vars() const
+  {
+    return static_cast<uint32_t>( class_of.size() );
+  }
+
+  uint32_t num_classes() const
+  {
+    return num_classes_;
+  }
+
+  /*! \brief Whether no two variables are symmetric. */
+  bool is_trivial() const
+  {
+    return num_classes_ == num_vars();
+  }
+
+  /*! \brief Smallest variable of the class of `v`. */
+  uint32_t representative( uint32_t v ) const
+  {
+    return class_of[v];
+  }
+
+  bool are_symmetric( uint32_t i, uint32_t j ) const
+  {
+    return class_of[i] == class_of[j];
+  }
+
+  /*! \brief Number of orders that give different truth tables, i.e., the multinomial coefficient of the class sizes. */
+  double num_orders() const
+  {
+    std::vector<uint32_t> size( num_vars(), 0u );
+    double orders = 1.0;
+    for ( auto v = 0u; v < num_vars(); ++v )
+    {
+      /* v-th factor of n!, divided by the position of v in its class */
+      orders *= v + 1u;
+      orders /= ++size[class_of[v]];
+    }
+    return orders;
+  }
+
+  /*! \brief Whether the variables of each class appear in increasing order in `perm`. */
+  bool is_canonical( std::vector<uint32_t> const& perm ) const
+  {
+    /* position of the previous variable of each class */
+    std::vector<int32_t> last( num_vars(), -1 );
+    for ( auto v = 0u; v < num_vars(); ++v )
+    {
+      auto& l = last[class_of[v]];
+      if ( l > static_cast<int32_t>( perm[v] ) )
+        return false;
+      l = perm[v];
+    }
+    return true;
+  }
+
+  /*! \brief The canonical order that gives the same truth table as `perm`. */
+  std::vector<uint32_t> canonical( std::vector<uint32_t> const& perm ) const
+  {
+    if ( is_trivial() )
+      return perm;
+
+    /* assign the positions of each class in increasing order to its variables */
+    std::vector<uint32_t> var_at( perm.size() ), result( perm.size() ), next( perm.size() );
+    for ( auto v = 0u; v < perm.size(); ++v )
+    {
+      var_at[perm[v]] = v;
+      next[v] = class_of[v];
+    }
+    for ( auto p = 0u; p < perm.size(); ++p )
+    {
+      auto& v = next[class_of[var_at[p]]];
+      result[v] = p;
+      /* next variable of the class */
+      do
+      {
+        ++v;
+      } while ( v < perm.size() && class_of[v] != class_of[var_at[p]] );
+    }
+    return result;
+  }
+
+private:
+  std::vector<uint32_t> class_of;
+  uint32_t num_classes_{0u};
+};
+
+} // namespace angel
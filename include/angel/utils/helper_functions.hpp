@@ -1,8 +1,17 @@
 #pragma once
 
+#include <kitty/bit_operations.hpp>
 #include <kitty/dynamic_truth_table.hpp>
+#include <kitty/npn.hpp>
 #include <kitty/operations.hpp>
+#include <angel/utils/onset_columns.hpp>
 #include <angel/utils/partial_truth_table.hpp>
+#include <angel/utils/permutation.hpp>
+
+#include <numeric>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace angel
 {
@@ -15,81 +24,116 @@ inline std::vector<uint32_t> initialize_orders(uint32_t n)
     return orders_init;
 }
 
+/*! \brief Constant and duplicate lines of the onset of `tt`.
+ *
+ * Lines that are constant 0 (1) in all onset minterms are appended to
+ * `zero_lines` (`one_lines`), and every other line that equals or
+ * complements a line above it is appended to `duplicate_lines` together with
+ * the literal `2j + c` of that line.  All lines are found in one hashed pass
+ * by `classify_columns`, from the top line to the bottom one.  `qsp_deps`
+ * prepares duplicate lines with a CNOT, see `use_duplicate_lines`.
+ */
+inline void extract_independent_vars( std::vector<uint32_t>& zero_lines, std::vector<uint32_t>& one_lines,
+                                      std::vector<std::pair<uint32_t, uint32_t>>& duplicate_lines,
+                                      kitty::dynamic_truth_table const& tt )
+{
+  std::vector<uint64_t> columns;
+  uint64_t last_mask{0u};
+  uint32_t const num_vars = tt.num_vars();
+  auto const num_words = pack_onset_columns( tt, columns, last_mask );
+  auto const classes = classify_columns( columns, num_vars, num_words, last_mask );
+
+  for ( auto i = num_vars; i-- > 0u; )
+  {
+    if ( classes.constant[i] )
+    {
+      ( classes.polarity[i] ? one_lines : zero_lines ).emplace_back( i );
+    }
+    else if ( classes.representative[i] != i )
+    {
+      duplicate_lines.emplace_back( i, classes.literal( i ) );
+    }
+  }
+}
+
+/*! \brief Constant lines of the onset of `tt`, see above. */
 inline void extract_independent_vars (std::vector<uint32_t> &zero_lines, std::vector<uint32_t> &one_lines, 
 kitty::dynamic_truth_table const& tt)
-{       
-    /* extract minterms */
-    //print_binary(tt);
-    //std::cout<<std::endl;
+{
+    std::vector<std::pair<uint32_t, uint32_t>> duplicate_lines;
+    extract_independent_vars( zero_lines, one_lines, duplicate_lines, tt );
+}
 
-    std::vector<partial_truth_table> minterms = on_set( tt );
-    // for(auto i=0u; i<minterms.size(); i++)
-    //     print_binary(minterms[i]);
-    // std::cout<<std::endl;
-    
+/*! \brief Input-negation and input-permutation semi-canonization.
+ *
+ * Every input whose positive cofactor has more ones than its negative one is
+ * complemented, then the result is P-canonized.  Functions in the same NP
+ * class usually, but not always (ties in the cofactor sizes), obtain the same
+ * representative.  The result has the same format as kitty's NPN
+ * canonization: `f(x) = r(y)` with `y_i = x_{perm[i]} ^ phase_{perm[i]}`.
+ */
+inline std::tuple<kitty::dynamic_truth_table, uint32_t, std::vector<uint8_t>> np_semi_canonization( kitty::dynamic_truth_table const& tt )
+{
+  uint32_t const num_vars = tt.num_vars();
+  auto t = tt;
+  uint32_t phase{0u};
+  for ( auto i = 0u; i < num_vars; ++i )
+  {
+    if ( kitty::count_ones( kitty::cofactor1( t, i ) ) > kitty::count_ones( kitty::cofactor0( t, i ) ) )
+    {
+      kitty::flip_inplace( t, i );
+      phase |= 1u << i;
+    }
+  }
+
+  auto [repr, _, perm] = num_vars <= 7u ? kitty::exact_p_canonization( t ) : kitty::sifting_p_canonization( t );
+  return std::make_tuple( repr, phase, perm );
+}
 
-    /* convert minterms to column vectors */
-    uint32_t const minterm_length = minterms[0u].num_bits();
-    uint32_t const num_minterms = minterms.size();
+/*! \brief Permutation of `reordering_on_tt_inplace`, which moves variable `v` to position `perm[v]`. */
+inline std::vector<uint32_t> reordering_permutation( uint32_t num_vars, std::vector<uint32_t> const& orders )
+{
+    uint32_t const var_num = orders.size();
+    std::vector<uint32_t> var_at( num_vars );
+    std::iota( var_at.begin(), var_at.end(), 0u );
 
-    std::vector<partial_truth_table> columns( minterm_length, partial_truth_table( num_minterms ) );
-    for ( auto i = 0u; i < minterm_length; ++i )
+    for ( auto i = 0u; i < var_num; i++ )
     {
-        for ( auto j = 0u; j < num_minterms; ++j )
+        auto const j = orders[var_num - 1u - i];
+        if ( j > i && j < var_num && j < num_vars )
         {
-            if ( minterms.at( j ).get_bit( i ) )
-            {
-                columns[i/*minterm_length-i-1*/].set_bit( j );
-            }
+            std::swap( var_at[i], var_at[j] );
         }
     }
 
-    for(int32_t i=minterm_length-1; i>=0; i--)
+    std::vector<uint32_t> perm( num_vars );
+    for ( auto p = 0u; p < num_vars; ++p )
     {
-        if(columns.at(i).is_const0())
-        {
-            zero_lines.emplace_back(i);
-        }
-            
-        else if(columns.at(i).is_const1())
-        {
-            one_lines.emplace_back(i);
-        }
+        perm[var_at[p]] = p;
     }
-
-    // for(auto i=0u; i<columns.size(); i++)
-    // {
-    //     print_binary(columns[i]);
-    //     std::cout<<std::endl;
-    // }
+    return perm;
 }
 
-inline std::vector<uint32_t> reordering_on_tt_inplace (kitty::dynamic_truth_table &tt, std::vector<uint32_t> orders)
+/*! \brief Reorders `tt` by the transpositions `( i, orders[n - 1 - i] )` for `i < orders[n - 1 - i]`.
+ *
+ * The transpositions are composed first and applied in one pass with
+ * `permute_variables`.  Returns the second variables of the applied
+ * transpositions (or `i` if `orders[n - 1 - i] == i`).
+ */
+inline std::vector<uint32_t> reordering_on_tt_inplace( kitty::dynamic_truth_table& tt, std::vector<uint32_t> const& orders )
 {
-    auto var_num = orders.size();
+    uint32_t const var_num = orders.size();
     std::vector<uint32_t> new_order;
-    std::reverse(orders.begin(), orders.end());
-    
-    for(auto i=0u; i<var_num; i++)
+    for ( auto i = 0u; i < var_num; i++ )
     {
-        if(i != orders[i])
+        auto const j = orders[var_num - 1u - i];
+        if ( j == i || ( j > i && j < var_num && j < static_cast<uint32_t>( tt.num_vars() ) ) )
         {
-            for(auto j=i+1; j<var_num; j++)
-            {
-                if(j == orders[i])
-                {
-                    kitty::swap_inplace(tt, i, j); 
-                    new_order.emplace_back(j);
-                    break;
-                }
-            }
+            new_order.emplace_back( j );
         }
-        else
-        {
-            new_order.emplace_back(i);
-        }
-        
     }
+
+    permute_variables_inplace( tt, reordering_permutation( tt.num_vars(), orders ) );
     return new_order;
 }
 
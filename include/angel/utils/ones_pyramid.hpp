@@ -0,0 +1,108 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file ones_pyramid.hpp
+
+  \brief Constant-time ones counting on aligned truth table segments
+*/
+
+#pragma once
+
+#include <kitty/dynamic_truth_table.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Pyramid of ones counts over the aligned segments of a truth table.
+ *
+ * Level `k` of the pyramid stores the number of ones in every segment of
+ * `2^k` bits that starts at a multiple of `2^k`, i.e., in every cofactor
+ * obtained by fixing the variables `k, ..., n - 1`.  Levels below 6 are
+ * answered from the truth table words directly, levels from 6 on are stored
+ * (about `2^(n-5)` counts in total).  After `build` in O(2^n / 64), every
+ * `count` query takes constant time.  The storage is reused across builds.
+ */
+class ones_pyramid
+{
+public:
+  /*! \brief Counts the ones of all segments of `tt`; `tt` must outlive the queries. */
+  void build( kitty::dynamic_truth_table const& tt )
+  {
+    words = &*tt.cbegin();
+    num_vars = tt.num_vars();
+
+    counts.clear();
+    level_begin.clear();
+    if ( num_vars < 6u )
+    {
+      return;
+    }
+
+    auto const num_words = uint64_t( 1u ) << ( num_vars - 6u );
+    level_begin.emplace_back( 0u );
+    for ( auto i = 0u; i < num_words; ++i )
+    {
+      counts.emplace_back( __builtin_popcountll( words[i] ) );
+    }
+    for ( auto level = 7u; level <= num_vars; ++level )
+    {
+      auto const prev = level_begin.back();
+      auto const size = counts.size() - prev;
+      level_begin.emplace_back( counts.size() );
+      for ( auto i = 0u; i < size; i += 2u )
+      {
+        counts.emplace_back( counts[prev + i] + counts[prev + i + 1u] );
+      }
+    }
+  }
+
+  /*! \brief Number of ones in the bits `offset, ..., offset + 2^level - 1`.
+   *
+   * `offset` must be a multiple of `2^level`.
+   */
+  uint64_t count( uint64_t offset, uint32_t level ) const
+  {
+    assert( level <= num_vars && ( offset & ( ( uint64_t( 1u ) << level ) - 1u ) ) == 0u );
+    if ( level < 6u )
+    {
+      auto const word = words[offset >> 6u] >> ( offset & 63u );
+      return __builtin_popcountll( word & ( ( uint64_t( 1u ) << ( uint64_t( 1u ) << level ) ) - 1u ) );
+    }
+    return counts[level_begin[level - 6u] + ( offset >> level )];
+  }
+
+private:
+  uint64_t const* words{nullptr};
+  uint32_t num_vars{0u};
+  std::vector<uint64_t> counts;
+  std::vector<uint64_t> level_begin;
+};
+
+} // namespace angel
@@ -0,0 +1,242 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file onset_columns.hpp
+
+  \brief Packed variable columns of the onset and their equality classes
+*/
+
+#pragma once
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/operations.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Packs the values of the variables in the onset minterms of `tt` into columns.
+ *
+ * Column `i` holds bit `j` for the `j`-th minterm at word `i * num_words + j / 64`.
+ * Returns `num_words` (at least 1); `last_mask` marks the used bits of the
+ * last word of a column (0 if `tt` has no minterms).
+ */
+inline uint32_t pack_onset_columns( kitty::dynamic_truth_table const& tt, std::vector<uint64_t>& columns, uint64_t& last_mask )
+{
+  uint32_t const num_vars = tt.num_vars();
+  auto const num_minterms = kitty::count_ones( tt );
+  uint32_t const num_words = std::max<uint32_t>( 1u, ( num_minterms + 63u ) / 64u );
+  last_mask = num_minterms % 64u ? ( uint64_t( 1u ) << ( num_minterms % 64u ) ) - 1u : ( num_minterms == 0u ? 0u : ~uint64_t( 0u ) );
+  columns.assign( num_vars * num_words, 0u );
+
+  uint64_t j{0u};
+  for ( auto b = 0u; b < tt.num_blocks(); ++b )
+  {
+    for ( auto block = tt._bits[b]; block; block &= block - 1u )
+    {
+      uint64_t const minterm = b * 64u + __builtin_ctzll( block );
+      for ( auto i = 0u; i < num_vars; ++i )
+      {
+        columns[i * num_words + j / 64u] |= ( ( minterm >> i ) & 1u ) << ( j % 64u );
+      }
+      ++j;
+    }
+  }
+  return num_words;
+}
+
+/*! \brief Classes of equal or complemented columns. */
+struct column_classes
+{
+  /* largest column that is equal or complemented to column i (possibly i) */
+  std::vector<uint32_t> representative;
+
+  /* value of column i in the first minterm; columns of a class with different values are complemented */
+  std::vector<uint8_t> polarity;
+
+  /* whether column i is constant */
+  std::vector<uint8_t> constant;
+
+  /* literal 2j + c of the representative of column i, which is complemented if c = 1 */
+  uint32_t literal( uint32_t i ) const
+  {
+    return 2u * representative[i] + ( polarity[i] ^ polarity[representative[i]] );
+  }
+};
+
+/*! \brief Finds all equal and complemented columns in one pass.
+ *
+ * Every column is normalized to the polarity in which its first bit is 0,
+ * and the normalized columns are indexed by a hash of their words, such
+ * that each column is compared only to columns with the same hash instead
+ * of to all other columns.  Columns are given as by `pack_onset_columns`.
+ */
+inline column_classes classify_columns( std::vector<uint64_t> const& columns, uint32_t num_vars, uint32_t num_words, uint64_t last_mask )
+{
+  column_classes classes;
+  classes.representative.resize( num_vars );
+  classes.polarity.resize( num_vars );
+  classes.constant.resize( num_vars );
+
+  auto const mask = [&]( uint32_t w ) { return w + 1u == num_words ? last_mask : ~uint64_t( 0u ); };
+  auto const normalized = [&]( uint32_t i, uint32_t w ) {
+    auto const complement = classes.polarity[i] ? ~uint64_t( 0u ) : uint64_t( 0u );
+    return ( columns[i * num_words + w] ^ complement ) & mask( w );
+  };
+
+  /* hash of the normalized column to the representatives with that hash */
+  std::unordered_multimap<uint64_t, uint32_t> index;
+  index.reserve( num_vars );
+  for ( auto i = num_vars; i-- > 0u; )
+  {
+    classes.polarity[i] = last_mask ? ( columns[i * num_words] & 1u ) : 0u;
+
+    uint64_t hash{0u};
+    bool zero = true;
+    for ( auto w = 0u; w < num_words; ++w )
+    {
+      auto const word = normalized( i, w );
+      zero = zero && word == 0u;
+      hash = ( hash ^ word ) * 0x100000001b3;
+      hash ^= hash >> 29u;
+    }
+    classes.constant[i] = zero;
+
+    classes.representative[i] = i;
+    auto const [first, last] = index.equal_range( hash );
+    for ( auto it = first; it != last; ++it )
+    {
+      auto const j = it->second;
+      auto equal = true;
+      for ( auto w = 0u; w < num_words && equal; ++w )
+      {
+        equal = normalized( i, w ) == normalized( j, w );
+      }
+      if ( equal )
+      {
+        classes.representative[i] = j;
+        break;
+      }
+    }
+    if ( classes.representative[i] == i )
+    {
+      index.emplace( hash, i );
+    }
+  }
+
+  return classes;
+}
+
+/*! \brief Matches the constant, EQUAL, XOR, and AND patterns of `pattern_deps_analysis` between onset columns.
+ *
+ * A column is matched by a pattern of a set of fanin columns if the pattern,
+ * for some polarity of the fanins and of the result, equals the column in
+ * every minterm of the onset.  The columns are packed once by
+ * `pack_onset_columns`.
+ */
+class onset_pattern_matcher
+{
+public:
+  explicit onset_pattern_matcher( kitty::dynamic_truth_table const& tt )
+  {
+    num_words = pack_onset_columns( tt, columns, last_mask );
+    x.resize( num_words );
+    y.resize( num_words );
+  }
+
+  /*! \brief Whether variable `i` is constant in the onset. */
+  bool is_constant( uint32_t i ) const
+  {
+    return is_const( &columns[i * num_words] );
+  }
+
+  /*! \brief Cost of an EQUAL or XOR (number of fanins) or AND (2^number of fanins) pattern of variable `i` with the variables in `fanins`. */
+  std::optional<uint32_t> pattern_cost( uint32_t i, uint64_t fanins )
+  {
+    uint32_t const size = __builtin_popcountll( fanins );
+    auto const* target = &columns[i * num_words];
+
+    /* EQUAL (one fanin) and XOR/XNOR: target ^ fanins is constant */
+    std::copy( target, target + num_words, x.begin() );
+    for ( auto m = fanins; m; m &= m - 1u )
+    {
+      auto const* column = &columns[__builtin_ctzll( m ) * num_words];
+      for ( auto w = 0u; w < num_words; ++w )
+        x[w] ^= column[w];
+    }
+    if ( is_const( x.data() ) )
+      return size;
+    if ( size == 1u )
+      return std::nullopt;
+
+    /* AND/NAND for all fanin polarities */
+    for ( uint64_t polarity = 0u; polarity < ( uint64_t( 1u ) << size ); ++polarity )
+    {
+      std::fill( y.begin(), y.end(), ~uint64_t( 0u ) );
+      auto f = 0u;
+      for ( auto m = fanins; m; m &= m - 1u )
+      {
+        auto const* column = &columns[__builtin_ctzll( m ) * num_words];
+        auto const complement = ( ( polarity >> f++ ) & 1u ) ? ~uint64_t( 0u ) : 0u;
+        for ( auto w = 0u; w < num_words; ++w )
+          y[w] &= column[w] ^ complement;
+      }
+      for ( auto w = 0u; w < num_words; ++w )
+        y[w] ^= target[w];
+      if ( is_const( y.data() ) )
+        return 1u << size;
+    }
+    return std::nullopt;
+  }
+
+private:
+  bool is_const( uint64_t const* column ) const
+  {
+    auto const value = column[0u] & 1u ? ~uint64_t( 0u ) : 0u;
+    for ( auto w = 0u; w < num_words; ++w )
+    {
+      auto const mask = w + 1u == num_words ? last_mask : ~uint64_t( 0u );
+      if ( ( column[w] ^ value ) & mask )
+        return false;
+    }
+    return true;
+  }
+
+private:
+  std::vector<uint64_t> columns;
+  uint32_t num_words;
+  uint64_t last_mask;
+
+  /* scratch columns of pattern_cost */
+  std::vector<uint64_t> x, y;
+};
+
+} // namespace angel
@@ -0,0 +1,374 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file parallel_for.hpp
+
+  \brief Work-stealing parallel loop over an index range and persistent worker threads
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace angel
+{
+
+/*! \brief Resolves a requested number of worker threads.
+ *
+ * A request of 0 means "one worker per hardware thread".  The result is
+ * never larger than the number of items and never smaller than 1.
+ */
+inline uint32_t resolve_num_threads( uint32_t num_threads, uint64_t num_items )
+{
+  if ( num_threads == 0u )
+  {
+    num_threads = std::max( 1u, std::thread::hardware_concurrency() );
+  }
+  return static_cast<uint32_t>( std::max<uint64_t>( 1u, std::min<uint64_t>( num_threads, num_items ) ) );
+}
+
+namespace detail
+{
+
+/* index range owned by one worker; the owner takes chunks from the front, thieves take halves from the back */
+struct work_range
+{
+  std::mutex mutex;
+  uint64_t begin{0};
+  uint64_t end{0};
+};
+
+} // namespace detail
+
+/*! \brief Calls `fn( worker, index )` for every index in `[0, num_items)`.
+ *
+ * The range is split evenly among `num_threads` workers (the calling thread
+ * is worker 0).  A worker processes its own range in chunks of `chunk_size`
+ * indices; once it runs dry, it steals the back half of the largest remaining
+ * range of another worker.  Every index is visited exactly once.  The first
+ * exception thrown by `fn` is rethrown after all workers have joined.
+ *
+ * \param num_items Number of indices
+ * \param num_threads Number of workers (0 = hardware concurrency)
+ * \param chunk_size Number of indices taken from the own range at once
+ * \param fn Callable with signature `void( uint32_t worker, uint64_t index )`
+ */
+template<class Fn>
+void parallel_for( uint64_t num_items, uint32_t num_threads, uint64_t chunk_size, Fn&& fn )
+{
+  if ( num_items == 0u )
+  {
+    return;
+  }
+
+  num_threads = resolve_num_threads( num_threads, num_items );
+  chunk_size = std::max<uint64_t>( 1u, chunk_size );
+
+  if ( num_threads == 1u )
+  {
+    for ( uint64_t i = 0u; i < num_items; ++i )
+    {
+      fn( 0u, i );
+    }
+    return;
+  }
+
+  std::vector<detail::work_range> ranges( num_threads );
+  for ( auto w = 0u; w < num_threads; ++w )
+  {
+    ranges[w].begin = ( num_items * w ) / num_threads;
+    ranges[w].end = ( num_items * ( w + 1 ) ) / num_threads;
+  }
+
+  std::mutex exception_mutex;
+  std::exception_ptr exception;
+
+  auto const steal = [&]( uint32_t thief ) {
+    /* pick the victim with the most remaining work */
+    uint32_t victim = thief;
+    uint64_t largest = 0u;
+    for ( auto w = 0u; w < num_threads; ++w )
+    {
+      if ( w == thief )
+        continue;
+
+      std::lock_guard<std::mutex> lock( ranges[w].mutex );
+      if ( ranges[w].end - ranges[w].begin > largest )
+      {
+        largest = ranges[w].end - ranges[w].begin;
+        victim = w;
+      }
+    }
+
+    if ( victim == thief )
+    {
+      return false;
+    }
+
+    uint64_t stolen_begin, stolen_end;
+    {
+      std::lock_guard<std::mutex> lock( ranges[victim].mutex );
+      auto const remaining = ranges[victim].end - ranges[victim].begin;
+      if ( remaining == 0u )
+      {
+        /* victim has finished meanwhile, try again */
+        return true;
+      }
+      stolen_end = ranges[victim].end;
+      stolen_begin = ranges[victim].begin + remaining / 2u;
+      ranges[victim].end = stolen_begin;
+    }
+
+    std::lock_guard<std::mutex> lock( ranges[thief].mutex );
+    ranges[thief].begin = stolen_begin;
+    ranges[thief].end = stolen_end;
+    return true;
+  };
+
+  auto const work = [&]( uint32_t worker ) {
+    try
+    {
+      while ( true )
+      {
+        uint64_t first, last;
+        {
+          std::lock_guard<std::mutex> lock( ranges[worker].mutex );
+          first = ranges[worker].begin;
+          last = std::min( ranges[worker].end, first + chunk_size );
+          ranges[worker].begin = last;
+        }
+
+        if ( first == last )
+        {
+          if ( !steal( worker ) )
+          {
+            return;
+          }
+          continue;
+        }
+
+        for ( auto i = first; i < last; ++i )
+        {
+          fn( worker, i );
+        }
+      }
+    }
+    catch ( ... )
+    {
+      std::lock_guard<std::mutex> lock( exception_mutex );
+      if ( !exception )
+      {
+        exception = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for ( auto w = 1u; w < num_threads; ++w )
+  {
+    threads.emplace_back( work, w );
+  }
+  work( 0u );
+  for ( auto& t : threads )
+  {
+    t.join();
+  }
+
+  if ( exception )
+  {
+    std::rethrow_exception( exception );
+  }
+}
+
+/*! \brief Worker threads that are started once and run many parallel loops.
+ *
+ * `parallel_for` starts and joins its threads on every call, which can cost
+ * more than short loops themselves (e.g., costing a batch of candidates of a
+ * small function).  The `num_threads - 1` threads of a pool wait between
+ * loops instead, and are joined when the pool is destroyed.  Indices are
+ * handed out from a shared counter in chunks of `chunk_size`; the calling
+ * thread is worker 0.  Loops must not be run concurrently on the same pool.
+ */
+class thread_pool
+{
+public:
+  explicit thread_pool( uint32_t num_threads )
+    : num_workers( std::max( 1u, num_threads ) )
+  {
+    for ( auto w = 1u; w < num_workers; ++w )
+    {
+      threads.emplace_back( [this, w]() { wait_and_work( w ); } );
+    }
+  }
+
+  thread_pool( thread_pool const& ) = delete;
+  thread_pool& operator=( thread_pool const& ) = delete;
+
+  ~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      stop = true;
+    }
+    start.notify_all();
+    for ( auto& t : threads )
+    {
+      t.join();
+    }
+  }
+
+  uint32_t num_threads() const
+  {
+    return num_workers;
+  }
+
+  /*! \brief Calls `fn( worker, index )` for every index in `[0, num_items)`.
+   *
+   * Returns once all indices have been visited.  The first exception thrown
+   * by `fn` is rethrown after all workers have finished the loop.
+   */
+  template<class Fn>
+  void parallel_for( uint64_t num_items, uint64_t chunk_size, Fn&& fn )
+  {
+    if ( num_items == 0u )
+    {
+      return;
+    }
+
+    if ( threads.empty() )
+    {
+      for ( uint64_t i = 0u; i < num_items; ++i )
+      {
+        fn( 0u, i );
+      }
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      job = [&fn]( uint32_t worker, uint64_t index ) { fn( worker, index ); };
+      job_items = num_items;
+      job_chunk_size = std::max<uint64_t>( 1u, chunk_size );
+      next_index = 0u;
+      exception = nullptr;
+      num_busy = static_cast<uint32_t>( threads.size() );
+      ++generation;
+    }
+    start.notify_all();
+
+    work( 0u );
+
+    std::unique_lock<std::mutex> lock( mutex );
+    done.wait( lock, [&]() { return num_busy == 0u; } );
+    job = nullptr;
+    if ( exception )
+    {
+      std::rethrow_exception( exception );
+    }
+  }
+
+private:
+  void wait_and_work( uint32_t worker )
+  {
+    uint64_t last_generation{0u};
+    while ( true )
+    {
+      {
+        std::unique_lock<std::mutex> lock( mutex );
+        start.wait( lock, [&]() { return stop || generation != last_generation; } );
+        if ( stop )
+        {
+          return;
+        }
+        last_generation = generation;
+      }
+
+      work( worker );
+
+      std::lock_guard<std::mutex> lock( mutex );
+      if ( --num_busy == 0u )
+      {
+        done.notify_one();
+      }
+    }
+  }
+
+  void work( uint32_t worker )
+  {
+    try
+    {
+      while ( true )
+      {
+        auto const first = next_index.fetch_add( job_chunk_size );
+        if ( first >= job_items )
+        {
+          return;
+        }
+
+        auto const last = std::min( job_items, first + job_chunk_size );
+        for ( auto i = first; i < last; ++i )
+        {
+          job( worker, i );
+        }
+      }
+    }
+    catch ( ... )
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      if ( !exception )
+      {
+        exception = std::current_exception();
+      }
+    }
+  }
+
+  uint32_t num_workers;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  bool stop{false};
+  uint64_t generation{0u};
+  uint32_t num_busy{0u};
+  std::exception_ptr exception;
+
+  /* current loop, written under `mutex` before the workers are started */
+  std::function<void( uint32_t, uint64_t )> job;
+  uint64_t job_items{0u};
+  uint64_t job_chunk_size{1u};
+  std::atomic<uint64_t> next_index{0u};
+};
+
+} // namespace angel
@@ -0,0 +1,209 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file permutation.hpp
+
+  \brief Variable permutation of truth tables in one pass
+*/
+
+#pragma once
+
+#include <kitty/detail/constants.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace angel
+{
+
+namespace detail
+{
+
+/* exchanges the in-word variable i with the variable that distinguishes the words lo and hi */
+inline void swap_across_words( uint64_t& lo, uint64_t& hi, uint32_t i )
+{
+  auto const t = ( ( lo >> ( 1u << i ) ) ^ hi ) & ~kitty::detail::projections[i];
+  hi ^= t;
+  lo ^= t << ( 1u << i );
+}
+
+} // namespace detail
+
+/*! \brief Permutes the variables of `tt`: variable `i` of `tt` becomes variable `perm[i]` of the result.
+ *
+ * Unlike a chain of `kitty::swap_inplace` calls, which passes over the whole
+ * table once per transposition, the permutation is applied in one pass.
+ * The `k` variables that move from the word index into the words (and the
+ * `k` that move out) partition the words into groups of `2^k`.  Every group
+ * is loaded once, the variables within each word are permuted by at most
+ * five delta swaps, the moving variables are exchanged by `k` delta swaps
+ * across the words of the group, and the words are stored at their
+ * permuted indices.
+ */
+inline kitty::dynamic_truth_table permute_variables( kitty::dynamic_truth_table const& tt, std::vector<uint32_t> const& perm )
+{
+  uint32_t const num_vars = tt.num_vars();
+  assert( perm.size() == num_vars );
+  uint32_t const num_word_vars = std::min<uint32_t>( num_vars, 6u );
+
+  /* variables that move into and out of the words, paired by rank */
+  std::array<uint32_t, 6u> entering, leaving;
+  uint32_t k{0u};
+  for ( auto v = 0u, l = 0u; v < num_vars; ++v )
+  {
+    if ( v < 6u && perm[v] >= 6u )
+      leaving[l++] = v;
+    else if ( v >= 6u && perm[v] < 6u )
+      entering[k++] = v;
+  }
+
+  /* in-word positions: a leaving variable takes the position of its entering partner */
+  std::array<uint32_t, 6u> var_at, target;
+  for ( auto v = 0u; v < num_word_vars; ++v )
+  {
+    var_at[v] = v;
+    target[v] = perm[v];
+  }
+  for ( auto m = 0u; m < k; ++m )
+  {
+    target[leaving[m]] = perm[entering[m]];
+  }
+  /* at most five delta swaps; unused ones have an empty mask */
+  uint64_t mask[5u] = {0u, 0u, 0u, 0u, 0u};
+  uint32_t delta[5u] = {0u, 0u, 0u, 0u, 0u};
+  for ( auto p = 0u, s = 0u; p < num_word_vars; ++p )
+  {
+    for ( auto q = p + 1u; q < num_word_vars; ++q )
+    {
+      if ( target[var_at[q]] == p )
+      {
+        mask[s] = kitty::detail::projections[p] & ~kitty::detail::projections[q];
+        delta[s++] = ( 1u << q ) - ( 1u << p );
+        std::swap( var_at[p], var_at[q] );
+        break;
+      }
+    }
+  }
+  auto const [m0, m1, m2, m3, m4] = mask;
+  auto const [d0, d1, d2, d3, d4] = delta;
+  auto const permute_word = [=]( uint64_t word ) {
+    auto const swap = [&]( uint64_t m, uint32_t d ) {
+      auto const t = ( ( word >> d ) ^ word ) & m;
+      word ^= t ^ ( t << d );
+    };
+    swap( m0, d0 );
+    swap( m1, d1 );
+    swap( m2, d2 );
+    swap( m3, d3 );
+    swap( m4, d4 );
+    return word;
+  };
+
+  auto result = tt.construct();
+  if ( num_vars <= 6u )
+  {
+    result._bits[0u] = permute_word( tt._bits[0u] );
+    return result;
+  }
+
+  /* bit i of a word index moves to bit index_map[i]; entering variable m
+     is exchanged with leaving variable m */
+  std::array<uint64_t, 64u> index_map;
+  uint64_t entering_mask{0u};
+  for ( auto v = 6u; v < num_vars; ++v )
+  {
+    index_map[v - 6u] = perm[v] >= 6u ? uint64_t( 1u ) << ( perm[v] - 6u ) : 0u;
+  }
+  for ( auto m = 0u; m < k; ++m )
+  {
+    index_map[entering[m] - 6u] = uint64_t( 1u ) << ( perm[leaving[m]] - 6u );
+    entering_mask |= uint64_t( 1u ) << ( entering[m] - 6u );
+  }
+  auto const result_index = [&]( uint64_t index ) {
+    uint64_t permuted{0u};
+    for ( ; index; index &= index - 1u )
+    {
+      permuted |= index_map[__builtin_ctzll( index )];
+    }
+    return permuted;
+  };
+
+  /* word g of a group has the value of entering (input) and leaving (result) variable m in bit m */
+  uint64_t const group_size = uint64_t( 1u ) << k;
+  std::array<uint64_t, 64u> source_offset, result_offset, group;
+  for ( uint64_t g = 0u; g < group_size; ++g )
+  {
+    source_offset[g] = 0u;
+    for ( auto m = 0u; m < k; ++m )
+    {
+      source_offset[g] |= ( ( g >> m ) & 1u ) << ( entering[m] - 6u );
+    }
+    result_offset[g] = result_index( source_offset[g] );
+  }
+
+  uint64_t const* source = tt._bits.data();
+  uint64_t* words = result._bits.data();
+  uint64_t const num_blocks = tt.num_blocks();
+  for ( uint64_t base = 0u; base < num_blocks; base = ( ( base | entering_mask ) + 1u ) & ~entering_mask )
+  {
+    for ( uint64_t g = 0u; g < group_size; ++g )
+    {
+      group[g] = permute_word( source[base | source_offset[g]] );
+    }
+    for ( auto m = 0u; m < k; ++m )
+    {
+      auto const q = perm[entering[m]];
+      uint64_t const step = uint64_t( 1u ) << m;
+      for ( uint64_t g = 0u; g < group_size; g += 2u * step )
+      {
+        for ( auto h = g; h < g + step; ++h )
+        {
+          detail::swap_across_words( group[h], group[h + step], q );
+        }
+      }
+    }
+
+    auto const result_base = result_index( base );
+    for ( uint64_t g = 0u; g < group_size; ++g )
+    {
+      words[result_base | result_offset[g]] = group[g];
+    }
+  }
+  return result;
+}
+
+/*! \brief In-place version of `permute_variables`. */
+inline void permute_variables_inplace( kitty::dynamic_truth_table& tt, std::vector<uint32_t> const& perm )
+{
+  tt = permute_variables( tt, perm );
+}
+
+} // namespace angel
@@ -0,0 +1,84 @@
+/* angel: C++ state preparation library
+ * Copyright (C) 2019-2020  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file splitmix64.hpp
+
+  \brief Small counter-based random number generator
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace angel
+{
+
+/*! \brief SplitMix64 generator (a UniformRandomBitGenerator).
+ *
+ * The state is a single 64-bit counter, hence generators for independent
+ * streams are cheap to create: `splitmix64( seed, stream )` yields a
+ * reproducible stream for every pair of seed and stream index, e.g., one per
+ * sample or per worker.
+ */
+class splitmix64
+{
+public:
+  using result_type = uint64_t;
+
+  explicit splitmix64( uint64_t seed, uint64_t stream = 0u )
+    : state( mix( seed ) ^ mix( stream + 0x632be59bd9b4e019 ) )
+  {
+  }
+
+  static constexpr result_type min()
+  {
+    return std::numeric_limits<result_type>::min();
+  }
+
+  static constexpr result_type max()
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()()
+  {
+    state += 0x9e3779b97f4a7c15;
+    return mix( state );
+  }
+
+private:
+  static uint64_t mix( uint64_t z )
+  {
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111eb;
+    return z ^ ( z >> 31 );
+  }
+
+  uint64_t state;
+};
+
+} // namespace angel
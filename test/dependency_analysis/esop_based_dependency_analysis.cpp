@@ -8,6 +8,8 @@
 #include <fmt/format.h>
 #include <iostream>
 
+#include "../test_functions.hpp"
+
 TEST_CASE( "extract dependencies as ESOP cover" , "[esop_based_dependency_analysis]" )
 {
   kitty::dynamic_truth_table tt{4u};
@@ -40,3 +42,37 @@ TEST_CASE( "extract dependencies as ESOP cover" , "[esop_based_dependency_analys
     }
   }
 }
+
+TEST_CASE( "ESOP dependencies hold on all minterms of large functions", "[esop_based_dependency_analysis]" )
+{
+  /* onset: x0 = x1 ^ ( x2 & x3 ) and x4 = MAJ( x5, x6, x7 ) over 12 variables */
+  auto const tt = angel_test::planted_function( 12u, 0xfeeu, []( uint32_t i, uint64_t m ) {
+    auto const x = [&]( uint32_t j ) { return ( m >> j ) & 1u; };
+    return i == 0u ? x( 1 ) ^ ( x( 2 ) & x( 3 ) ) : uint64_t( x( 5 ) + x( 6 ) + x( 7 ) >= 2u ? 1u : 0u );
+  } );
+
+  angel::esop_deps_analysis_params ps;
+  angel::esop_deps_analysis_stats st;
+  auto const result = angel::compute_dependencies<angel::esop_deps_analysis>( tt, ps, st );
+  CHECK( result.dependencies.count( 0u ) == 1u );
+  CHECK( result.dependencies.count( 4u ) == 1u );
+
+  /* every ESOP computes its target in all minterms */
+  for ( auto const& [target, esop] : result.dependencies )
+  {
+    for ( auto const& m : kitty::get_minterms( tt ) )
+    {
+      auto value = 0u;
+      for ( auto const& cube : esop )
+      {
+        auto product = 1u;
+        for ( auto const& l : cube )
+        {
+          product &= ( ( m >> ( l / 2u ) ) & 1u ) ^ ( l % 2u );
+        }
+        value ^= product;
+      }
+      CHECK( value == ( ( m >> target ) & 1u ) );
+    }
+  }
+}
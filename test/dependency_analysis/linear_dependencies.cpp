@@ -0,0 +1,123 @@
+#include <catch.hpp>
+
+#include <angel/dependency_analysis/linear_dependencies.hpp>
+#include <angel/dependency_analysis/pattern_based_dependency_analysis.hpp>
+#include <kitty/kitty.hpp>
+
+#include "../test_functions.hpp"
+
+#include <cstdint>
+#include <vector>
+
+TEST_CASE( "Linear dependencies of any size", "[linear_dependencies]" )
+{
+  /* x0 = ~( x2 ^ ... ^ x9 ), x1 = x4 ^ x5 ^ x6 */
+  auto const tt = angel_test::planted_function( 10u, 0x3fcu, 2200u, []( uint32_t i, uint64_t m ) {
+    auto const x = [&]( uint32_t j ) { return static_cast<uint32_t>( ( m >> j ) & 1u ); };
+    return i == 0u ? 1u - ( x( 2 ) ^ x( 3 ) ^ x( 4 ) ^ x( 5 ) ^ x( 6 ) ^ x( 7 ) ^ x( 8 ) ^ x( 9 ) ) : x( 4 ) ^ x( 5 ) ^ x( 6 );
+  } );
+
+  angel::pattern_deps_analysis_params ps;
+  ps.use_linear_dependencies = true;
+  angel::pattern_deps_analysis_stats st;
+  auto const result = angel::compute_dependencies<angel::pattern_deps_analysis>( tt, ps, st );
+
+  using kind = angel::dependency_analysis_types::pattern_kind;
+  REQUIRE( result.dependencies.count( 0u ) == 1u );
+  REQUIRE( result.dependencies.count( 1u ) == 1u );
+
+  /* x0 is cheapest as ~( x1 ^ x2 ^ x3 ^ x7 ^ x8 ^ x9 ) */
+  CHECK( result.dependencies.at( 0u ) == std::make_pair( kind::XNOR, std::vector<uint32_t>{2u, 4u, 6u, 14u, 16u, 18u} ) );
+  CHECK( result.dependencies.at( 1u ) == std::make_pair( kind::XOR, std::vector<uint32_t>{8u, 10u, 12u} ) );
+  CHECK( st.num_linear_patterns == 2u );
+
+  /* the tuple search does not find the first one */
+  ps.use_linear_dependencies = false;
+  auto const searched = angel::compute_dependencies<angel::pattern_deps_analysis>( tt, ps, st );
+  CHECK( searched.dependencies.count( 0u ) == 0u );
+  CHECK( searched.dependencies.at( 1u ) == result.dependencies.at( 1u ) );
+}
+
+TEST_CASE( "Linear dependencies select the smallest support", "[linear_dependencies]" )
+{
+  /* x0 = x2 ^ x3 = ~x1 */
+  auto const tt = angel_test::planted_function( 8u, 0xfcu, 2210u, []( uint32_t i, uint64_t m ) {
+    auto const x = ( ( m >> 2u ) ^ ( m >> 3u ) ) & 1u;
+    return static_cast<uint32_t>( i == 0u ? x : 1u - x );
+  } );
+
+  /* columns of the onset minterms */
+  auto const minterms = kitty::get_minterms( tt );
+  REQUIRE( minterms.size() <= 64u );
+  std::vector<uint64_t> columns( 8u, 0u );
+  for ( auto j = 0u; j < minterms.size(); ++j )
+  {
+    for ( auto i = 0u; i < 8u; ++i )
+    {
+      columns[i] |= uint64_t( ( minterms[j] >> i ) & 1u ) << j;
+    }
+  }
+
+  auto const size = []( angel::dependency_analysis_types::pattern const& p ) { return p.second.size(); };
+  auto const last_mask = minterms.size() == 64u ? ~uint64_t( 0u ) : ( uint64_t( 1u ) << minterms.size() ) - 1u;
+  auto const linear = angel::linear_dependencies( columns, 8u, 1u, last_mask, size );
+
+  using kind = angel::dependency_analysis_types::pattern_kind;
+  REQUIRE( linear[0u] );
+  CHECK( *linear[0u] == std::make_pair( kind::EQUAL, std::vector<uint32_t>{3u} ) );
+  REQUIRE( linear[1u] );
+  CHECK( *linear[1u] == std::make_pair( kind::XNOR, std::vector<uint32_t>{4u, 6u} ) );
+  for ( auto i = 2u; i < 8u; ++i )
+  {
+    CHECK( !linear[i] );
+  }
+}
+
+TEST_CASE( "Linear dependencies are not more expensive than searched ones", "[linear_dependencies]" )
+{
+  for ( auto i = 0u; i < 30u; ++i )
+  {
+    /* x0 = xa ^ xb, x1 = xa & ~xc, x2 = ~( xa ^ xb ^ xc ) for distinct a, b, c among x3, ..., x7 */
+    auto const a = 3u + i % 5u, b = 3u + ( i + 2u ) % 5u, c = 3u + ( i + 4u ) % 5u;
+    auto const tt = angel_test::planted_function( 8u, 0xf8u, 2220u + i, [&]( uint32_t v, uint64_t m ) {
+      auto const x = [&]( uint32_t j ) { return static_cast<uint32_t>( ( m >> j ) & 1u ); };
+      switch ( v )
+      {
+      case 0u:
+        return x( a ) ^ x( b );
+      case 1u:
+        return x( a ) & ( 1u - x( c ) );
+      default:
+        return 1u - ( x( a ) ^ x( b ) ^ x( c ) );
+      }
+    } );
+
+    angel::pattern_deps_analysis_params ps;
+    angel::pattern_deps_analysis_stats st;
+    auto const searched = angel::compute_dependencies<angel::pattern_deps_analysis>( tt, ps, st );
+    ps.use_linear_dependencies = true;
+    auto const linear = angel::compute_dependencies<angel::pattern_deps_analysis>( tt, ps, st );
+
+    REQUIRE( !searched.dependencies.empty() );
+    REQUIRE( !linear.dependencies.empty() );
+    for ( auto v = 0u; v < 3u; ++v )
+    {
+      REQUIRE( searched.dependencies.count( v ) == 1u );
+    }
+
+    /* XOR cost: one CNOT per fanin, AND cost: 2^k CNOTs */
+    auto const cnots = []( angel::dependency_analysis_types::pattern const& p ) -> uint32_t {
+      using kind = angel::dependency_analysis_types::pattern_kind;
+      if ( p.first == kind::CONST )
+        return 0u;
+      if ( p.first == kind::AND || p.first == kind::NAND )
+        return 1u << p.second.size();
+      return static_cast<uint32_t>( p.second.size() );
+    };
+    for ( auto const& [v, p] : searched.dependencies )
+    {
+      REQUIRE( linear.dependencies.count( v ) == 1u );
+      CHECK( cnots( linear.dependencies.at( v ) ) <= cnots( p ) );
+    }
+  }
+}
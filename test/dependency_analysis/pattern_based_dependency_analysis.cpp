@@ -6,6 +6,8 @@
 #include <fmt/format.h>
 #include <iostream>
 
+#include "../test_functions.hpp"
+
 TEST_CASE( "extract dependencies using pattern based dependency analysis" , "[pattern_based_dependency_analysis]" )
 {
   kitty::dynamic_truth_table tt{4u};
@@ -25,3 +27,31 @@ TEST_CASE( "extract dependencies using pattern based dependency analysis" , "[pa
     
   }
 }
+
+TEST_CASE( "Pattern based dependency analysis finds patterns of up to five fanins", "[pattern_based_dependency_analysis]" )
+{
+  /* onset: x0 = x2 & ~x5 & x6, x1 = ~( x2 ^ x3 ^ x4 ^ x5 ^ x6 ), and g( x2, ..., x6 ) */
+  auto const tt = angel_test::planted_function( 7u, 0x7cu, 2100u, []( uint32_t i, uint64_t m ) {
+    auto const x = [&]( uint32_t j ) { return ( m >> j ) & 1u; };
+    return i == 0u ? x( 2 ) & ( 1u - x( 5 ) ) & x( 6 ) : 1u - ( x( 2 ) ^ x( 3 ) ^ x( 4 ) ^ x( 5 ) ^ x( 6 ) );
+  } );
+
+  angel::pattern_deps_analysis_params ps;
+  angel::pattern_deps_analysis_stats st;
+  auto const result = angel::compute_dependencies<angel::pattern_deps_analysis>( tt, ps, st );
+
+  using kind = angel::dependency_analysis_types::pattern_kind;
+  REQUIRE( result.dependencies.count( 0u ) == 1u );
+  REQUIRE( result.dependencies.count( 1u ) == 1u );
+  CHECK( result.dependencies.at( 0u ) == std::make_pair( kind::AND, std::vector<uint32_t>{4u, 11u, 12u} ) );
+  CHECK( result.dependencies.at( 1u ) == std::make_pair( kind::XNOR, std::vector<uint32_t>{4u, 6u, 8u, 10u, 12u} ) );
+  CHECK( st.num_5tuples == 6u + 1u );
+
+  /* smaller tuples only */
+  ps.max_pattern_size = 4u;
+  st.reset();
+  auto const small = angel::compute_dependencies<angel::pattern_deps_analysis>( tt, ps, st );
+  CHECK( small.dependencies.at( 0u ) == result.dependencies.at( 0u ) );
+  CHECK( small.dependencies.count( 1u ) == 0u );
+  CHECK( st.num_5tuples == 0u );
+}
@@ -0,0 +1,171 @@
+#include <catch.hpp>
+
+#include <angel/dependency_analysis/pattern_based_dependency_analysis.hpp>
+#include <angel/dependency_analysis/pattern_catalog.hpp>
+#include <angel/quantum_state_preparation/mc_qg_generation.hpp>
+#include <kitty/kitty.hpp>
+
+#include "../test_functions.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/* function of the gates of a recipe */
+uint32_t simulate( std::vector<std::vector<uint32_t>> const& recipe, uint32_t k )
+{
+  uint32_t function{0u};
+  for ( auto const& cube : recipe )
+  {
+    for ( auto v = 0u; v < ( 1u << k ); ++v )
+    {
+      auto value = true;
+      for ( auto const& l : cube )
+      {
+        value = value && ( ( v >> ( l / 2u ) ) & 1u ) != l % 2u;
+      }
+      function ^= ( value ? 1u : 0u ) << v;
+    }
+  }
+  return function;
+}
+
+} // namespace
+
+TEST_CASE( "Pattern catalog recipes compute their functions at their costs", "[pattern_catalog]" )
+{
+  using kind = angel::dependency_analysis_types::pattern_kind;
+  for ( auto k = 1u; k <= angel::pattern_catalog::max_num_fanins; ++k )
+  {
+    auto const& catalog = angel::pattern_catalog::get( k );
+    CHECK( catalog.num_fanins() == k );
+
+    for ( uint32_t g = 1u; g < ( 1u << ( 1u << k ) ); ++g )
+    {
+      auto const recipe = catalog.recipe( g );
+      CHECK( simulate( recipe, k ) == g );
+      if ( catalog.has_full_support( g ) && catalog.kind( g ) == kind::LUT )
+      {
+        CHECK( angel::esop_gate_cost( recipe ).first == catalog.cost( g ).first );
+        CHECK( catalog.cost( g ).first <= ( 1u << k ) );
+      }
+    }
+  }
+}
+
+TEST_CASE( "Pattern catalog keeps the kinds and costs of the pattern analysis", "[pattern_catalog]" )
+{
+  using kind = angel::dependency_analysis_types::pattern_kind;
+  using pattern = angel::dependency_analysis_types::pattern;
+
+  auto const& catalog2 = angel::pattern_catalog::get( 2u );
+  CHECK( catalog2.pattern( 0x6u, {3u, 5u} ) == pattern{kind::XOR, {6u, 10u}} );
+  CHECK( catalog2.pattern( 0x9u, {3u, 5u} ) == pattern{kind::XNOR, {6u, 10u}} );
+  CHECK( catalog2.pattern( 0x2u, {3u, 5u} ) == pattern{kind::AND, {6u, 11u}} );
+  CHECK( catalog2.pattern( 0xeu, {3u, 5u} ) == pattern{kind::NAND, {7u, 11u}} );
+  CHECK( catalog2.cost( 0x6u ) == std::make_pair( 2u, 0u ) );
+  CHECK( catalog2.cost( 0x2u ) == std::make_pair( 4u, 6u ) );
+  CHECK( catalog2.cost( 0xeu ) == std::make_pair( 4u, 9u ) );
+
+  auto const& catalog1 = angel::pattern_catalog::get( 1u );
+  CHECK( catalog1.pattern( 0x1u, {2u} ) == pattern{kind::EQUAL, {5u}} );
+  CHECK( catalog1.cost( 0x1u ) == std::make_pair( 1u, 1u ) );
+
+  /* majority, multiplexer, and AND-XOR forms are LUTs */
+  auto const& catalog3 = angel::pattern_catalog::get( 3u );
+  auto const and_xor = 0x6au; /* x0 ^ ( x1 & x2 ) */
+  CHECK( catalog3.pattern( 0xe8u, {1u, 2u, 3u} ) == pattern{kind::LUT, {2u, 4u, 6u, 0xe8u}} );
+  CHECK( catalog3.cost( 0xe8u ).first == 8u );
+  CHECK( catalog3.kind( 0xcau ) == kind::LUT );
+  CHECK( catalog3.cost( and_xor ).first == 5u );
+  CHECK( !catalog3.has_full_support( 0xccu ) );
+}
+
+TEST_CASE( "Pattern catalog completes partial functions at the lowest cost", "[pattern_catalog]" )
+{
+  std::mt19937 gen( 42u );
+  for ( auto k = 2u; k <= angel::pattern_catalog::max_num_fanins; ++k )
+  {
+    auto const& catalog = angel::pattern_catalog::get( k );
+    uint32_t const full = ( 1u << ( 1u << k ) ) - 1u;
+    for ( auto i = 0u; i < 200u; ++i )
+    {
+      uint32_t const function = gen() & full;
+      uint32_t care = gen() & full;
+      if ( i % 2u )
+        care &= gen();
+
+      auto const match = catalog.lookup( function, care );
+      CHECK( ( ( match ^ function ) & care ) == 0u );
+
+      /* no completion is cheaper */
+      auto best = match;
+      for ( uint32_t g = 0u; g <= full; ++g )
+      {
+        if ( ( ( g ^ function ) & care ) == 0u && catalog.cost( g ) < catalog.cost( best ) )
+        {
+          best = g;
+        }
+      }
+      CHECK( catalog.cost( best ) == catalog.cost( match ) );
+    }
+  }
+}
+
+TEST_CASE( "Pattern based dependency analysis finds LUT patterns with the catalog", "[pattern_catalog]" )
+{
+  using kind = angel::dependency_analysis_types::pattern_kind;
+
+  /* onset: x0 = MAJ( x1, x2, x3 ) and x1 = x4 ? x5 : x6 */
+  auto const tt = angel_test::planted_function( 7u, 0x7cu, []( uint32_t i, uint64_t m ) {
+    auto const x = [&]( uint32_t j ) { return ( m >> j ) & 1u; };
+    return i == 0u ? uint64_t( ( x( 1 ) + x( 2 ) + x( 3 ) ) >= 2u ? 1u : 0u ) : ( x( 4 ) ? x( 5 ) : x( 6 ) );
+  } );
+
+  angel::pattern_deps_analysis_params ps;
+  angel::pattern_deps_analysis_stats st;
+  ps.use_pattern_catalog = true;
+  auto const result = angel::pattern_deps_analysis( ps, st ).run( tt );
+  REQUIRE( result.dependencies.count( 0u ) == 1u );
+  REQUIRE( result.dependencies.count( 1u ) == 1u );
+  CHECK( result.dependencies.at( 0u ) == angel::dependency_analysis_types::pattern{kind::LUT, {2u, 4u, 6u, 0xe8u}} );
+  CHECK( result.dependencies.at( 1u ).first == kind::LUT );
+
+  /* the catalog finds patterns at most as expensive as the built-in kinds */
+  angel::pattern_deps_analysis_params legacy_ps;
+  angel::pattern_deps_analysis_stats legacy_st;
+  for ( auto seed = 0u; seed < 32u; ++seed )
+  {
+    kitty::dynamic_truth_table f( 8 ), mask( 8 );
+    kitty::create_random( f, 80u + seed );
+    kitty::create_random( mask, 120u + seed );
+    f &= mask;
+    if ( seed % 2u )
+      f &= kitty::shift_left( mask, 3u );
+    if ( kitty::is_const0( f ) )
+      continue;
+
+    auto const catalog_result = angel::pattern_deps_analysis( ps, st ).run( f );
+    auto const legacy_result = angel::pattern_deps_analysis( legacy_ps, legacy_st ).run( f );
+    for ( auto const& [var, dependency] : legacy_result.dependencies )
+    {
+      REQUIRE( catalog_result.dependencies.count( var ) == 1u );
+      if ( dependency.first == kind::CONST )
+      {
+        CHECK( catalog_result.dependencies.at( var ) == dependency );
+        continue;
+      }
+
+      auto const cnots = [&]( auto const& p ) {
+        angel::gate_cost_accumulator costs;
+        costs.reset( 8u, 1u << var );
+        angel::detail::emit_dependency( costs, var, p );
+        return costs.cost().first;
+      };
+      CHECK( cnots( catalog_result.dependencies.at( var ) ) <= cnots( dependency ) );
+    }
+  }
+}
@@ -0,0 +1,48 @@
+#include <catch.hpp>
+
+#include <angel/quantum_state_preparation/gate_list.hpp>
+
+#include <cmath>
+#include <vector>
+
+TEST_CASE( "Gate list stores control literals as masks", "[gate_list]" )
+{
+  angel::gate_list gates( 5u );
+  CHECK( gates.num_words() == 1u );
+
+  gates.add_gate( 4u, 0.5, std::vector<uint32_t>{2u * 1u + 1u, 2u * 3u} );
+  gates.add_gate( 2u, M_PI );
+  gates.add_gate( 1u, M_PI / 2, uint64_t( 1u ) << 4u, uint64_t( 1u ) << 2u );
+
+  CHECK( gates.size() == 3u );
+  CHECK( gates.controls( 0u ) == std::vector<uint32_t>{2u * 3u, 2u * 1u + 1u} );
+  CHECK( gates.num_controls( 0u ) == 2u );
+  CHECK( !gates.is_not( 0u ) );
+  CHECK( gates.is_not( 1u ) );
+  CHECK( gates.controls( 2u ) == std::vector<uint32_t>{2u * 4u, 2u * 2u + 1u} );
+
+  gates.insert_gate( 1u, 0u, M_PI, {2u * 4u} );
+  CHECK( gates.target( 1u ) == 0u );
+  CHECK( gates.target( 2u ) == 2u );
+  gates.erase_gate( 1u );
+  CHECK( gates.target( 1u ) == 2u );
+  CHECK( gates.size() == 3u );
+}
+
+TEST_CASE( "Gate list supports more than 64 qubits", "[gate_list]" )
+{
+  angel::gate_list gates( 130u );
+  CHECK( gates.num_words() == 3u );
+
+  std::vector<uint32_t> const controls{2u * 129u + 1u, 2u * 64u, 2u * 3u};
+  gates.add_gate( 100u, 1.0, controls );
+  CHECK( gates.controls( 0u ) == controls );
+  CHECK( gates.num_controls( 0u ) == 3u );
+  CHECK( gates.positive( 0u )[1u] == 1u );
+  CHECK( gates.negative( 0u )[2u] == 2u );
+
+  auto copy = gates;
+  CHECK( copy == gates );
+  copy.add_gate( 129u, M_PI );
+  CHECK( copy != gates );
+}
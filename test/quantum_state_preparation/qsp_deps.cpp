@@ -0,0 +1,955 @@
+#include <catch.hpp>
+
+#include <angel/angel.hpp>
+#include <kitty/kitty.hpp>
+#include <tweedledum/gates/mcmt_gate.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+#include "../test_functions.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/* simulates a network (angle pi = NOT) and checks that it prepares the uniform state of tt */
+bool prepares( angel::network const& ntk, kitty::dynamic_truth_table const& tt )
+{
+  std::vector<double> amplitudes( tt.num_bits(), 0.0 );
+  amplitudes[0] = 1.0;
+
+  auto const& gates = ntk.gates;
+  for ( auto g = 0u; g < gates.size(); ++g )
+  {
+    auto const target = gates.target( g );
+    auto const angle = gates.angle( g );
+    auto const positive = gates.positive( g )[0], negative = gates.negative( g )[0];
+    auto const c = std::cos( angle / 2 ), s = std::sin( angle / 2 );
+    for ( auto x = 0u; x < amplitudes.size(); ++x )
+    {
+      if ( ( ( x >> target ) & 1u ) || ( x & positive ) != positive || ( x & negative ) != 0u )
+        continue;
+
+      auto const y = x | ( 1u << target );
+      auto const a0 = amplitudes[x], a1 = amplitudes[y];
+      if ( angle == M_PI )
+      {
+        amplitudes[x] = a1;
+        amplitudes[y] = a0;
+      }
+      else
+      {
+        amplitudes[x] = c * a0 - s * a1;
+        amplitudes[y] = s * a0 + c * a1;
+      }
+    }
+  }
+
+  auto const expected = 1.0 / kitty::count_ones( tt );
+  for ( auto x = 0u; x < amplitudes.size(); ++x )
+  {
+    auto const p = amplitudes[x] * amplitudes[x];
+    if ( std::abs( p - ( kitty::get_bit( tt, x ) ? expected : 0.0 ) ) > 1e-6 )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+TEST_CASE( "Batch state preparation returns the sequential results in input order", "[qsp_deps_batch]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  /* 16 random functions, followed by three functions of their P classes and one of their NP classes each */
+  std::vector<kitty::dynamic_truth_table> functions;
+  for ( auto i = 0u; i < 80u; ++i )
+  {
+    kitty::dynamic_truth_table tt( 5u );
+    kitty::create_random( tt, i % 16u );
+    auto const round = i / 16u;
+    if ( round == 4u )
+    {
+      kitty::flip_inplace( tt, i % 5u );
+    }
+    else if ( round > 0u )
+    {
+      kitty::swap_inplace( tt, i % 5u, ( i + round ) % 5u );
+    }
+    functions.emplace_back( tt );
+  }
+
+  for ( auto const use_np_cache : {false, true} )
+  {
+    angel::random_reordering random_reorder( 3u, 3u );
+    angel::pattern_deps_analysis_params pattern_ps;
+    angel::state_preparation_parameters ps;
+    ps.use_np_cache = use_np_cache;
+
+    /* sequential reference */
+    angel::pattern_deps_analysis_stats pattern_st;
+    angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+    angel::state_preparation_statistics st;
+    angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( random_reorder )> p( ntk, pattern, random_reorder, ps, st );
+
+    std::vector<angel::network> expected;
+    for ( auto const& tt : functions )
+    {
+      expected.emplace_back( p( tt ) );
+    }
+    REQUIRE( st.num_p_hits > 0u );
+    REQUIRE( ( st.num_np_hits > 0u ) == use_np_cache );
+
+    /* batch */
+    angel::pattern_deps_analysis_stats batch_pattern_st;
+    angel::state_preparation_statistics batch_st;
+    angel::qsp_deps_batch_parameters batch_ps;
+    batch_ps.num_threads = 4u;
+    batch_ps.chunk_size = 3u;
+    auto const results = angel::qsp_deps_batch<angel::pattern_deps_analysis>( ntk, functions.begin(), functions.end(), pattern_ps, batch_pattern_st,
+                                                                              random_reorder, ps, batch_st, batch_ps );
+
+    REQUIRE( results.size() == expected.size() );
+    for ( auto i = 0u; i < results.size(); ++i )
+    {
+      CHECK( results[i].cnots_sqgs == expected[i].cnots_sqgs );
+      CHECK( results[i].gates == expected[i].gates );
+    }
+
+    CHECK( batch_st.num_functions == st.num_functions );
+    CHECK( batch_st.num_unique_functions == st.num_unique_functions );
+    CHECK( batch_st.num_p_hits == st.num_p_hits );
+    CHECK( batch_st.num_np_hits == st.num_np_hits );
+    CHECK( batch_st.num_cnots == st.num_cnots );
+    CHECK( batch_st.num_sqgs == st.num_sqgs );
+    CHECK( batch_pattern_st.num_patterns == pattern_st.num_patterns );
+  }
+}
+
+TEST_CASE( "Batch state preparation merges the statistics of the reordering copies", "[qsp_deps_batch]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  std::vector<kitty::dynamic_truth_table> functions;
+  for ( auto i = 0u; i < 32u; ++i )
+  {
+    kitty::dynamic_truth_table tt{5u};
+    kitty::create_random( tt, 100u + i );
+    functions.emplace_back( tt );
+  }
+
+  angel::random_reordering_stats reorder_st;
+  angel::random_reordering random_reorder( 7u, 5u, reorder_st );
+
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::state_preparation_parameters ps;
+  angel::state_preparation_statistics st;
+  angel::qsp_deps_batch_parameters batch_ps;
+  batch_ps.num_threads = 4u;
+  angel::qsp_deps_batch<angel::pattern_deps_analysis>( ntk, functions.begin(), functions.end(), pattern_ps, pattern_st, random_reorder, ps, st, batch_ps );
+
+  CHECK( reorder_st.num_functions == st.num_unique_functions );
+  CHECK( reorder_st.num_samples == 6u * st.num_unique_functions );
+  CHECK( random_reorder.statistics() == &reorder_st );
+}
+
+TEST_CASE( "Cache hits return the cached network in the caller's variable order", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  kitty::dynamic_truth_table f{4u};
+  kitty::create_random( f, 42u );
+  auto const g = kitty::swap( f, 0u, 3u );
+  REQUIRE( f != g );
+
+  angel::no_reordering no_reorder;
+  angel::no_deps_analysis_params no_deps_ps;
+  angel::no_deps_analysis_stats no_deps_st;
+  angel::no_deps_analysis no_deps( no_deps_ps, no_deps_st );
+
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false; /* keep the synthesized gates */
+  angel::state_preparation_statistics st;
+  angel::qsp_deps<decltype( ntk ), decltype( no_deps ), decltype( no_reorder )> p( ntk, no_deps, no_reorder, ps, st );
+
+  auto const ntk_f = p( f );
+  auto const ntk_g = p( g );
+
+  CHECK( st.num_functions == 2u );
+  CHECK( st.num_unique_functions == 1u );
+  CHECK( st.num_cnots == 2u * ntk_f.cnots_sqgs.first );
+  CHECK( st.num_sqgs == 2u * ntk_f.cnots_sqgs.second );
+
+  CHECK( !ntk_g.gates.empty() );
+  CHECK( ntk_g.cnots_sqgs == ntk_f.cnots_sqgs );
+  CHECK( ntk_g.gates == angel::remap_network( ntk_f, {3u, 1u, 2u, 0u} ).gates );
+  CHECK( prepares( ntk_f, f ) );
+  CHECK( prepares( ntk_g, g ) );
+}
+
+TEST_CASE( "Networks are reused from a persistent cache file", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  std::vector<kitty::dynamic_truth_table> functions;
+  for ( auto i = 0u; i < 16u; ++i )
+  {
+    kitty::dynamic_truth_table tt{4u};
+    kitty::create_random( tt, 100u + i );
+    functions.emplace_back( tt );
+  }
+
+  angel::no_reordering no_reorder;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+  using qsp_t = angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( no_reorder )>;
+
+  auto const filename = ( std::filesystem::temp_directory_path() / "angel_qsp_deps_test.cache" ).string();
+  std::remove( filename.c_str() );
+
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  ps.cache_file = filename;
+
+  std::vector<angel::network> expected;
+  {
+    angel::state_preparation_statistics st;
+    qsp_t p( ntk, pattern, no_reorder, ps, st );
+    for ( auto const& tt : functions )
+    {
+      expected.emplace_back( p( tt ) );
+    }
+    CHECK( st.num_file_hits == 0u );
+  }
+
+  /* warm start from the file */
+  {
+    ps.cache_read_only = true;
+    angel::state_preparation_statistics st;
+    qsp_t p( ntk, pattern, no_reorder, ps, st );
+    for ( auto i = 0u; i < functions.size(); ++i )
+    {
+      auto const result = p( functions[i] );
+      CHECK( result.gates == expected[i].gates );
+      CHECK( result.cnots_sqgs == expected[i].cnots_sqgs );
+    }
+    CHECK( st.num_unique_functions == 0u );
+    CHECK( st.num_file_hits > 0u );
+  }
+
+  /* a different cost model tag rejects the file */
+  {
+    ps.cache_tag = "other";
+    angel::state_preparation_statistics st;
+    qsp_t p( ntk, pattern, no_reorder, ps, st );
+    for ( auto const& tt : functions )
+    {
+      p( tt );
+    }
+    CHECK( st.num_file_hits == 0u );
+  }
+
+  /* so do other strategy parameters */
+  {
+    ps.cache_tag = "";
+    angel::pattern_deps_analysis_params other_ps = pattern_ps;
+    other_ps.max_pattern_size = 2u;
+    angel::pattern_deps_analysis other_pattern( other_ps, pattern_st );
+    CHECK( qsp_t::cost_model_tag( other_pattern, no_reorder, ps ) != qsp_t::cost_model_tag( pattern, no_reorder, ps ) );
+
+    angel::state_preparation_statistics st;
+    qsp_t p( ntk, other_pattern, no_reorder, ps, st );
+    for ( auto const& tt : functions )
+    {
+      p( tt );
+    }
+    CHECK( st.num_file_hits == 0u );
+  }
+
+  std::remove( filename.c_str() );
+}
+
+TEST_CASE( "Cache files grow beyond their initial number of buckets", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  std::vector<kitty::dynamic_truth_table> functions;
+  for ( auto i = 0u; i < 40u; ++i )
+  {
+    kitty::dynamic_truth_table tt{4u};
+    kitty::create_random( tt, 300u + i );
+    functions.emplace_back( tt );
+  }
+
+  angel::no_reordering no_reorder;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+  using qsp_t = angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( no_reorder )>;
+
+  auto const filename = ( std::filesystem::temp_directory_path() / "angel_qsp_deps_grow_test.cache" ).string();
+  std::remove( filename.c_str() );
+
+  angel::state_preparation_parameters ps;
+  ps.cache_file = filename;
+  ps.cache_file_buckets = 2u;
+
+  uint64_t num_unique_functions{0u};
+  {
+    angel::state_preparation_statistics st;
+    qsp_t p( ntk, pattern, no_reorder, ps, st );
+    for ( auto const& tt : functions )
+    {
+      p( tt );
+    }
+    CHECK( st.num_file_insert_failures == 0u );
+    num_unique_functions = st.num_unique_functions;
+  }
+
+  angel::persistent_synthesis_cache file;
+  REQUIRE( file.open( filename, angel::persistent_cache_mode::read_only, qsp_t::cost_model_tag( pattern, no_reorder, ps ) ) );
+  CHECK( file.size() == num_unique_functions );
+  file.close();
+
+  /* every network was persisted */
+  {
+    ps.cache_read_only = true;
+    angel::state_preparation_statistics st;
+    qsp_t p( ntk, pattern, no_reorder, ps, st );
+    for ( auto const& tt : functions )
+    {
+      p( tt );
+    }
+    CHECK( st.num_unique_functions == 0u );
+    CHECK( st.num_file_hits == num_unique_functions );
+  }
+
+  std::remove( filename.c_str() );
+}
+
+TEST_CASE( "Growing a cache file keeps other writers out", "[qsp_deps]" )
+{
+  auto const filename = ( std::filesystem::temp_directory_path() / "angel_qsp_deps_writers_test.cache" ).string();
+  std::remove( filename.c_str() );
+
+  angel::persistent_synthesis_cache writer;
+  REQUIRE( writer.open( filename, angel::persistent_cache_mode::read_write, 7u, 2u ) );
+  REQUIRE( writer.is_writable() );
+
+  for ( auto i = 0u; i < 16u; ++i )
+  {
+    kitty::dynamic_truth_table key( 4u );
+    kitty::create_from_words( key, &i, &i + 1 );
+    CHECK( writer.insert( key, angel::network{angel::gate_list( 4u ), {i, i}} ) );
+
+    /* the renamed file is still locked by the writer */
+    angel::persistent_synthesis_cache other;
+    REQUIRE( other.open( filename, angel::persistent_cache_mode::read_write, 7u ) );
+    CHECK( !other.is_writable() );
+    CHECK( other.size() == i + 1u );
+  }
+
+  writer.close();
+  angel::persistent_synthesis_cache next;
+  REQUIRE( next.open( filename, angel::persistent_cache_mode::read_write, 7u ) );
+  CHECK( next.is_writable() );
+  CHECK( next.size() == 16u );
+  next.close();
+
+  std::remove( filename.c_str() );
+}
+
+TEST_CASE( "NP cache tier replays networks with complemented inputs", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  kitty::dynamic_truth_table f{4u};
+  kitty::create_random( f, 7u );
+  auto const g = kitty::flip( f, 1u );
+  auto const h = kitty::flip( kitty::swap( f, 0u, 2u ), 3u );
+
+  angel::no_reordering no_reorder;
+  angel::no_deps_analysis_params no_deps_ps;
+  angel::no_deps_analysis_stats no_deps_st;
+  angel::no_deps_analysis no_deps( no_deps_ps, no_deps_st );
+
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  ps.use_np_cache = true;
+  angel::state_preparation_statistics st;
+  angel::qsp_deps<decltype( ntk ), decltype( no_deps ), decltype( no_reorder )> p( ntk, no_deps, no_reorder, ps, st );
+
+  auto const ntk_f = p( f );
+  CHECK( prepares( ntk_f, f ) );
+
+  auto const ntk_g = p( g );
+  CHECK( prepares( ntk_g, g ) );
+  CHECK( ntk_g.cnots_sqgs.first == ntk_f.cnots_sqgs.first );
+
+  auto const ntk_h = p( h );
+  CHECK( prepares( ntk_h, h ) );
+
+  CHECK( st.num_functions == 3u );
+  CHECK( st.num_unique_functions + st.num_p_hits + st.num_np_hits == 3u );
+  CHECK( st.num_np_hits >= 1u );
+}
+
+TEST_CASE( "NP cache hits report the costs of their gates", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  angel::no_reordering no_reorder;
+  angel::no_deps_analysis_params no_deps_ps;
+  angel::no_deps_analysis_stats no_deps_st;
+  angel::no_deps_analysis no_deps( no_deps_ps, no_deps_st );
+
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  ps.use_np_cache = true;
+  angel::state_preparation_statistics st;
+  angel::qsp_deps<decltype( ntk ), decltype( no_deps ), decltype( no_reorder )> p( ntk, no_deps, no_reorder, ps, st );
+
+  for ( auto seed = 0u; seed < 16u; ++seed )
+  {
+    kitty::dynamic_truth_table f{4u};
+    kitty::create_random( f, 500u + seed );
+    if ( seed % 2u )
+    {
+      /* constant lines are prepared by a single NOT, which a negation cancels */
+      kitty::dynamic_truth_table var{4u};
+      kitty::create_nth_var( var, seed % 4u );
+      f &= var;
+    }
+
+    for ( auto phase = 0u; phase < 16u; ++phase )
+    {
+      auto g = f;
+      for ( auto i = 0u; i < 4u; ++i )
+      {
+        if ( ( phase >> i ) & 1u )
+        {
+          g = kitty::flip( g, i );
+        }
+      }
+
+      auto const result = p( g );
+      angel::qsp_1bench_stats gate_st;
+      angel::gates_statistics( result.gates, angel::esop_based_dependencies_t{}, gate_st );
+      CHECK( gate_st.gates_count == result.cnots_sqgs );
+    }
+  }
+  CHECK( st.num_np_hits > 0u );
+}
+
+TEST_CASE( "Bounded synthesis cache evicts cheap entries first", "[qsp_deps]" )
+{
+  std::vector<kitty::dynamic_truth_table> keys;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    kitty::dynamic_truth_table tt{4u};
+    kitty::create_from_words( tt, &i, &i + 1 );
+    keys.emplace_back( tt );
+  }
+
+  angel::network ntk{angel::gate_list( 4u ), {0u, 1u}};
+  ntk.gates.add_gate( 0u, M_PI );
+  auto const bytes = angel::synthesis_cache::entry_bytes( keys[0u], ntk );
+
+  /* a single shard with room for 3 entries */
+  angel::synthesis_cache cache( 1u, 3u * bytes + bytes / 2u );
+  CHECK( cache.insert( keys[0u], ntk, 1.0 ) );
+  for ( auto i = 1u; i < keys.size(); ++i )
+  {
+    CHECK( cache.insert( keys[i], ntk ) );
+    CHECK( cache.resident_bytes() <= cache.byte_budget() );
+  }
+
+  CHECK( cache.size() == 3u );
+  CHECK( cache.num_evictions() == 5u );
+  CHECK( cache.resident_bytes() == 3u * bytes );
+
+  /* the expensive entry survives, among the cheap ones the least recently used go first */
+  CHECK( cache.find( keys[0u] ) );
+  CHECK( cache.find( keys[6u] ) );
+  CHECK( cache.find( keys[7u] ) );
+  CHECK( !cache.find( keys[5u] ) );
+
+  CHECK( cache.find( keys[6u] ) );
+  CHECK( cache.insert( keys[1u], ntk ) );
+  CHECK( cache.find( keys[6u] ) );
+  CHECK( !cache.find( keys[7u] ) );
+}
+
+TEST_CASE( "State preparation respects the cache memory budget", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  std::vector<kitty::dynamic_truth_table> functions;
+  for ( auto i = 0u; i < 32u; ++i )
+  {
+    kitty::dynamic_truth_table tt{5u};
+    kitty::create_random( tt, 200u + i );
+    functions.emplace_back( tt );
+  }
+
+  angel::no_reordering no_reorder;
+  angel::no_deps_analysis_params no_deps_ps;
+  angel::no_deps_analysis_stats no_deps_st;
+  angel::no_deps_analysis no_deps( no_deps_ps, no_deps_st );
+
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  ps.cache_byte_budget = 16u * 1024u;
+  angel::state_preparation_statistics st;
+  angel::qsp_deps<decltype( ntk ), decltype( no_deps ), decltype( no_reorder )> p( ntk, no_deps, no_reorder, ps, st );
+
+  for ( auto const& tt : functions )
+  {
+    CHECK( prepares( p( tt ), tt ) );
+  }
+  for ( auto const& tt : functions )
+  {
+    CHECK( prepares( p( tt ), tt ) );
+  }
+
+  CHECK( st.num_functions == 64u );
+  CHECK( st.num_evictions > 0u );
+  CHECK( st.resident_bytes > 0u );
+  CHECK( st.resident_bytes <= ps.cache_byte_budget );
+  CHECK( st.num_unique_functions + st.num_p_hits == 64u );
+  CHECK( st.hit_ratio() == double( st.num_p_hits ) / 64u );
+}
+
+TEST_CASE( "Gate generator reproduces the recursive generation", "[qsp_deps]" )
+{
+  using kind = angel::dependency_analysis_types::pattern_kind;
+
+  struct expected_gate
+  {
+    uint32_t target;
+    double angle;
+    std::vector<uint32_t> controls;
+  };
+
+  /* rotation that moves probability 1 - p to the 1-cofactor */
+  auto const ry = []( double p ) { return 2 * std::acos( std::sqrt( p ) ); };
+
+  /* gates of the recursive MC_qg_generation overloads that were replaced by mc_qg_generator */
+  struct generation_case
+  {
+    uint32_t num_vars;
+    std::string hex;
+    angel::pattern_based_dependencies_t pattern_dependencies;
+    std::vector<expected_gate> pattern_gates;
+    angel::esop_based_dependencies_t esop_dependencies;
+    std::vector<expected_gate> esop_gates;
+    std::vector<expected_gate> plain_gates;
+  };
+
+  std::vector<generation_case> const cases{
+      {4u, "6201",
+       {{0u, {kind::XOR, {2u, 6u}}}},
+       {{3u, ry( 1.0 / 4 ), {}}, {2u, ry( 1.0 / 3 ), {6u}}, {1u, M_PI / 2, {6u, 4u}}, {0u, M_PI, {2u}}, {0u, M_PI, {6u}}},
+       {{0u, {{2u}, {6u}}}},
+       {{3u, ry( 1.0 / 4 ), {}}, {2u, ry( 1.0 / 3 ), {6u}}, {1u, M_PI / 2, {6u, 4u}}, {0u, M_PI, {2u}}, {0u, M_PI, {6u}}},
+       {{3u, ry( 1.0 / 4 ), {}}, {2u, ry( 1.0 / 3 ), {6u}}, {1u, M_PI / 2, {6u, 4u}}, {0u, M_PI, {6u, 5u, 3u}}, {0u, M_PI, {6u, 4u, 3u}}}},
+      {4u, "0820",
+       {{1u, {kind::EQUAL, {6u}}}},
+       {{3u, M_PI / 2, {}}, {2u, M_PI, {7u}}, {1u, M_PI, {6u}}, {0u, M_PI, {}}},
+       {},
+       {},
+       {{3u, M_PI / 2, {}}, {2u, M_PI, {7u}}, {1u, M_PI, {6u, 5u}}, {0u, M_PI, {}}}},
+      {5u, "14102400",
+       {{0u, {kind::AND, {4u, 9u}}}},
+       {{4u, ry( 2.0 / 5 ), {}}, {3u, M_PI, {9u}}, {3u, ry( 1.0 / 3 ), {8u}}, {2u, M_PI / 2, {9u, 6u}}, {2u, M_PI, {8u, 7u}}, {2u, M_PI / 2, {8u, 6u}}, {1u, M_PI, {9u, 6u, 5u}}, {1u, M_PI, {8u, 6u, 5u}}, {0u, M_PI, {9u, 4u}}},
+       {{0u, {{9u, 2u}, {9u}}}},
+       {{4u, ry( 2.0 / 5 ), {}}, {3u, M_PI, {9u}}, {3u, ry( 1.0 / 3 ), {8u}}, {2u, M_PI / 2, {9u, 6u}}, {2u, M_PI, {8u, 7u}}, {2u, M_PI / 2, {8u, 6u}}, {1u, M_PI, {9u, 6u, 5u}}, {1u, M_PI, {8u, 6u, 5u}}, {0u, M_PI, {9u, 2u}}, {0u, M_PI, {9u}}},
+       {{4u, ry( 2.0 / 5 ), {}}, {3u, M_PI, {9u}}, {3u, ry( 1.0 / 3 ), {8u}}, {2u, M_PI / 2, {9u, 6u}}, {2u, M_PI, {8u, 7u}}, {2u, M_PI / 2, {8u, 6u}}, {1u, M_PI, {9u, 6u, 5u}}, {1u, M_PI, {8u, 6u, 5u}}, {0u, M_PI, {9u, 6u, 4u, 3u}}}},
+      {5u, "18084008",
+       {{1u, {kind::NAND, {4u, 8u}}}},
+       {{4u, ry( 2.0 / 5 ), {}}, {3u, M_PI / 2, {9u}}, {3u, ry( 1.0 / 3 ), {8u}}, {2u, M_PI, {9u, 6u}}, {2u, M_PI / 2, {8u, 6u}}, {1u, M_PI, {8u, 4u}}, {1u, M_PI, {}}, {0u, M_PI, {9u, 7u, 5u}}, {0u, M_PI, {8u, 7u, 5u}}, {0u, M_PI, {8u, 6u, 5u}}},
+       {},
+       {},
+       {{4u, ry( 2.0 / 5 ), {}}, {3u, M_PI / 2, {9u}}, {3u, ry( 1.0 / 3 ), {8u}}, {2u, M_PI, {9u, 6u}}, {2u, M_PI / 2, {8u, 6u}}, {1u, M_PI, {9u, 7u, 5u}}, {1u, M_PI, {9u, 6u, 4u}}, {1u, M_PI, {8u, 7u, 5u}}, {1u, M_PI, {8u, 6u, 5u}}, {0u, M_PI, {9u, 7u, 5u, 2u}}, {0u, M_PI, {8u, 7u, 5u, 2u}}, {0u, M_PI, {8u, 6u, 5u, 2u}}}},
+      {4u, "6249",
+       {},
+       {},
+       {{0u, {{5u, 7u}, {3u}}}},
+       {{3u, M_PI / 2, {}}, {2u, ry( 2.0 / 3 ), {7u}}, {2u, ry( 1.0 / 3 ), {6u}}, {1u, M_PI / 2, {7u, 5u}}, {1u, M_PI, {7u, 4u}}, {1u, M_PI / 2, {6u, 4u}}, {0u, M_PI, {7u, 5u}}, {0u, M_PI, {3u}}},
+       {{3u, M_PI / 2, {}}, {2u, ry( 2.0 / 3 ), {7u}}, {2u, ry( 1.0 / 3 ), {6u}}, {1u, M_PI / 2, {7u, 5u}}, {1u, M_PI, {7u, 4u}}, {1u, M_PI / 2, {6u, 4u}}, {0u, M_PI, {7u, 5u, 2u}}, {0u, M_PI, {6u, 5u, 3u}}, {0u, M_PI, {6u, 4u, 3u}}}},
+      {4u, "748c",
+       {},
+       {},
+       {},
+       {},
+       {{3u, ry( 3.0 / 7 ), {}}, {2u, ry( 2.0 / 3 ), {7u}}, {2u, ry( 1.0 / 4 ), {6u}}, {1u, M_PI, {7u, 5u}}, {1u, M_PI, {7u, 4u}}, {1u, M_PI, {6u, 5u}}, {1u, ry( 2.0 / 3 ), {6u, 4u}}, {0u, M_PI / 2, {7u, 5u, 2u}}, {0u, M_PI, {7u, 4u, 2u}}, {0u, M_PI / 2, {6u, 4u, 3u}}}}};
+
+  auto const check = []( angel::gate_list const& gates, std::vector<expected_gate> const& expected ) {
+    REQUIRE( gates.size() == expected.size() );
+    for ( auto g = 0u; g < gates.size(); ++g )
+    {
+      CHECK( gates.target( g ) == expected[g].target );
+      CHECK( gates.angle( g ) == Approx( expected[g].angle ) );
+      CHECK( gates.controls( g ) == expected[g].controls );
+    }
+  };
+
+  /* one generator per kind reuses its buffers across all functions, twice in opposite orders */
+  angel::mc_qg_generator<angel::pattern_based_dependencies_t> pattern_generator;
+  angel::mc_qg_generator<angel::esop_based_dependencies_t> esop_generator;
+  for ( auto round = 0u; round < 2u; ++round )
+  {
+    for ( auto c = 0u; c < cases.size(); ++c )
+    {
+      auto const& fixed = cases[round == 0u ? c : cases.size() - 1u - c];
+      uint32_t const n = fixed.num_vars;
+      kitty::dynamic_truth_table tt( n );
+      kitty::create_from_hex_string( tt, fixed.hex );
+
+      std::vector<uint32_t> zero_lines, one_lines;
+      angel::extract_independent_vars( zero_lines, one_lines, tt );
+
+      angel::gate_list gates;
+      if ( !fixed.pattern_dependencies.empty() )
+      {
+        pattern_generator( gates, n, tt, n - 1u, {}, fixed.pattern_dependencies, zero_lines, one_lines );
+        check( gates, fixed.pattern_gates );
+      }
+      if ( !fixed.esop_dependencies.empty() )
+      {
+        esop_generator( gates, n, tt, n - 1u, {}, fixed.esop_dependencies, zero_lines, one_lines );
+        check( gates, fixed.esop_gates );
+      }
+      esop_generator( gates, n, tt, n - 1u, {}, {}, zero_lines, one_lines );
+      check( gates, fixed.plain_gates );
+      CHECK( prepares( angel::network{gates, {0u, 0u}}, tt ) );
+    }
+  }
+}
+
+TEST_CASE( "Cost-only gate generation agrees with the generated gates", "[qsp_deps]" )
+{
+  angel::mc_qg_generator<angel::pattern_based_dependencies_t> pattern_generator;
+  angel::mc_qg_generator<angel::esop_based_dependencies_t> esop_generator;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+  angel::esop_deps_analysis_params esop_ps;
+  angel::esop_deps_analysis_stats esop_st;
+  angel::esop_deps_analysis esop( esop_ps, esop_st );
+
+  auto const check = []( auto& generator, uint32_t n, kitty::dynamic_truth_table const& tt, auto const& dependencies ) {
+    std::vector<uint32_t> zero_lines, one_lines;
+    angel::extract_independent_vars( zero_lines, one_lines, tt );
+
+    angel::gate_list gates;
+    generator( gates, n, tt, n - 1u, {}, dependencies, zero_lines, one_lines );
+    angel::qsp_1bench_stats st;
+    angel::gates_statistics( gates, dependencies, st );
+    CHECK( generator.cost( n, tt, n - 1u, {}, dependencies, zero_lines, one_lines ) == st.gates_count );
+
+    /* a bound above the cost does not change it, a bound at or below it is reached */
+    auto const cnots = st.gates_count.first;
+    CHECK( generator.cost( n, tt, n - 1u, {}, dependencies, zero_lines, one_lines, cnots + 1u ) == st.gates_count );
+    CHECK( generator.cost( n, tt, n - 1u, {}, dependencies, zero_lines, one_lines, cnots / 2u ).first >= cnots / 2u );
+  };
+
+  for ( auto n = 2u; n <= 8u; ++n )
+  {
+    for ( auto i = 0u; i < 8u; ++i )
+    {
+      kitty::dynamic_truth_table tt( n ), mask( n );
+      kitty::create_random( tt, 600u + 8u * n + i );
+      kitty::create_random( mask, 700u + 8u * n + i );
+      if ( i % 2u )
+        tt &= mask;
+      if ( kitty::is_const0( tt ) )
+        continue;
+
+      check( pattern_generator, n, tt, pattern.run( tt ).dependencies );
+      check( esop_generator, n, tt, esop.run( tt ).dependencies );
+      check( esop_generator, n, tt, angel::esop_based_dependencies_t{} );
+    }
+  }
+}
+
+TEST_CASE( "Only the best reordering candidate is synthesized", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  angel::exhaustive_reordering exhaustive;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  angel::state_preparation_statistics st;
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( exhaustive )> p( ntk, pattern, exhaustive, ps, st );
+
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    kitty::dynamic_truth_table tt{5u};
+    kitty::create_random( tt, 800u + i );
+
+    uint32_t best_cost = std::numeric_limits<uint32_t>::max();
+    exhaustive.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+      auto const ntk = p.synthesize_network( candidate );
+      best_cost = std::min( best_cost, ntk.cnots_sqgs.first );
+      return ntk.cnots_sqgs.first;
+    } );
+
+    auto const result = p( tt );
+    CHECK( result.cnots_sqgs.first == best_cost );
+    /* the network prepares the best candidate */
+    CHECK( ( prepares( result, tt ) || prepares( result, kitty::swap( tt, 0u, 1u ) ) ) );
+  }
+
+  /* all candidates after the first one that do not improve are abandoned */
+  CHECK( st.num_candidates == 8u * 120u );
+  CHECK( st.num_pruned_candidates > 0u );
+  CHECK( st.num_pruned_candidates < st.num_candidates );
+}
+
+TEST_CASE( "Parallel costing of reordering candidates selects the sequential result", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  angel::exhaustive_reordering exhaustive;
+  angel::random_reordering random( 0xcafeaffe, 20u );
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st, parallel_pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+  angel::pattern_deps_analysis parallel_pattern( pattern_ps, parallel_pattern_st );
+
+  auto const check = [&]( auto& strategy ) {
+    angel::state_preparation_parameters ps, parallel_ps;
+    parallel_ps.num_reordering_threads = 4u;
+    parallel_ps.reordering_batch_size = 16u;
+    angel::state_preparation_statistics st, parallel_st;
+    using strategy_t = std::decay_t<decltype( strategy )>;
+    angel::qsp_deps<decltype( ntk ), decltype( pattern ), strategy_t> p( ntk, pattern, strategy, ps, st );
+    angel::qsp_deps<decltype( ntk ), decltype( pattern ), strategy_t> parallel_p( ntk, parallel_pattern, strategy, parallel_ps, parallel_st );
+
+    for ( auto i = 0u; i < 12u; ++i )
+    {
+      /* sparse functions have many orders of equal cost */
+      kitty::dynamic_truth_table tt{5u}, mask{5u};
+      kitty::create_random( tt, 1200u + i );
+      kitty::create_random( mask, 1300u + i );
+      tt &= mask;
+
+      auto const expected = p( tt );
+      auto const result = parallel_p( tt );
+      CHECK( result.cnots_sqgs == expected.cnots_sqgs );
+      CHECK( result.gates == expected.gates );
+    }
+
+    CHECK( parallel_st.num_candidates == st.num_candidates );
+    CHECK( parallel_pattern_st.num_analysed_patterns == pattern_st.num_analysed_patterns );
+    pattern_st.reset();
+    parallel_pattern_st.reset();
+  };
+
+  check( exhaustive );
+  check( random );
+}
+
+namespace
+{
+
+/* passes every candidate twice, in the order tt, swap( tt, 0, 1 ), tt, swap( tt, 0, 1 ) */
+struct repeating_reordering
+{
+  template<typename Fn>
+  void foreach_reordering( kitty::dynamic_truth_table const& tt, Fn&& fn, std::optional<uint32_t> initial_cost = std::nullopt ) const
+  {
+    (void)initial_cost;
+    auto const swapped = kitty::swap( tt, 0u, 1u );
+    for ( auto const& candidate : {tt, swapped, tt, swapped} )
+    {
+      fn( candidate );
+    }
+  }
+
+  template<typename Fn>
+  void foreach_reordering_batch( kitty::dynamic_truth_table const& tt, uint32_t batch_size, Fn&& fn ) const
+  {
+    angel::detail::foreach_reordering_in_batches( *this, tt, batch_size, fn );
+  }
+};
+
+} // namespace
+
+TEST_CASE( "Reordering candidates are costed once per function", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  repeating_reordering repeating;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+
+  kitty::dynamic_truth_table tt{4u};
+  kitty::create_from_hex_string( tt, "8e2a" );
+  REQUIRE( kitty::swap( tt, 0u, 1u ) != tt );
+
+  for ( auto num_threads : {1u, 2u} )
+  {
+    angel::state_preparation_parameters ps;
+    ps.use_upperbound = false;
+    ps.num_reordering_threads = num_threads;
+    ps.reordering_batch_size = 2u;
+    angel::state_preparation_statistics st;
+    angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( repeating )> p( ntk, pattern, repeating, ps, st );
+
+    auto const result = p( tt );
+    /* the network prepares the best candidate */
+    CHECK( ( prepares( result, tt ) || prepares( result, kitty::swap( tt, 0u, 1u ) ) ) );
+    CHECK( st.num_candidates == 2u );
+    CHECK( st.num_memo_hits == 2u );
+
+    ps.candidate_memo_capacity = 0u;
+    angel::state_preparation_statistics no_memo_st;
+    angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( repeating )> no_memo( ntk, pattern, repeating, ps, no_memo_st );
+    CHECK( no_memo( tt ).cnots_sqgs == result.cnots_sqgs );
+    CHECK( no_memo_st.num_candidates == 4u );
+    CHECK( no_memo_st.num_memo_hits == 0u );
+  }
+}
+
+TEST_CASE( "LUT patterns of the pattern catalog prepare the state", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  angel::no_reordering none;
+  angel::pattern_deps_analysis_params pattern_ps;
+  pattern_ps.use_pattern_catalog = true;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  angel::state_preparation_statistics st;
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( none )> p( ntk, pattern, none, ps, st );
+  angel::mc_qg_generator<angel::pattern_based_dependencies_t> generator;
+
+  auto num_lut_functions = 0u;
+  for ( auto n = 4u; n <= 7u; ++n )
+  {
+    for ( auto i = 0u; i < 8u; ++i )
+    {
+      /* x0 = MAJ( x1, x2, x3 ) for half of the functions */
+      kitty::dynamic_truth_table tt( n ), mask( n );
+      kitty::create_random( tt, 1100u + 8u * n + i );
+      kitty::create_random( mask, 1200u + 8u * n + i );
+      tt &= mask;
+      for ( auto m = 0u; m < tt.num_bits() && i % 2u; ++m )
+      {
+        auto const maj = __builtin_popcount( m & 0xeu ) >= 2 ? 1u : 0u;
+        if ( ( m & 1u ) != maj )
+          kitty::clear_bit( tt, m );
+      }
+      if ( kitty::is_const0( tt ) )
+        continue;
+
+      auto const dependencies = pattern.run( tt ).dependencies;
+      auto const has_lut = std::any_of( dependencies.begin(), dependencies.end(), []( auto const& d ) {
+        return d.second.first == angel::dependency_analysis_types::pattern_kind::LUT;
+      } );
+      if ( has_lut )
+      {
+        ++num_lut_functions;
+        CHECK( prepares( p( tt ), tt ) );
+      }
+
+      /* cost-only generation agrees with the generated gates */
+      std::vector<uint32_t> zero_lines, one_lines;
+      angel::extract_independent_vars( zero_lines, one_lines, tt );
+      angel::gate_list gates;
+      generator( gates, n, tt, n - 1u, {}, dependencies, zero_lines, one_lines );
+      angel::qsp_1bench_stats gate_st;
+      angel::gates_statistics( gates, dependencies, gate_st );
+      CHECK( generator.cost( n, tt, n - 1u, {}, dependencies, zero_lines, one_lines ) == gate_st.gates_count );
+    }
+  }
+  CHECK( num_lut_functions > 0u );
+}
+
+TEST_CASE( "Complemented EQUAL patterns prepare the state", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  angel::no_reordering none;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  angel::state_preparation_statistics st;
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( none )> p( ntk, pattern, none, ps, st );
+
+  /* x0 = ~x2 on a random function of x1, x2, x3 */
+  kitty::dynamic_truth_table g( 3u );
+  kitty::create_random( g, 1400u );
+  kitty::set_bit( g, 5u );
+  auto const tt = angel_test::planted_function( 4u, 0xeu, g, []( uint32_t, uint64_t m ) { return 1u - ( ( m >> 2u ) & 1u ); } );
+
+  auto const dependencies = pattern.run( tt ).dependencies;
+  REQUIRE( dependencies.count( 0u ) == 1u );
+  CHECK( dependencies.at( 0u ) == std::make_pair( angel::dependency_analysis_types::pattern_kind::EQUAL, std::vector<uint32_t>{5u} ) );
+  CHECK( prepares( p( tt ), tt ) );
+}
+
+TEST_CASE( "Duplicate lines are prepared with CNOTs", "[qsp_deps]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+
+  angel::no_reordering none;
+  angel::no_deps_analysis_params no_deps_ps;
+  angel::no_deps_analysis_stats no_deps_st;
+  angel::no_deps_analysis no_deps( no_deps_ps, no_deps_st );
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    /* x0 = x3 and x1 = ~x4 on a random function of x2, ..., x5 */
+    auto const tt = angel_test::planted_function( 6u, 0x3cu, 1300u + i, []( uint32_t v, uint64_t m ) {
+      return v == 0u ? ( m >> 3u ) & 1u : 1u - ( ( m >> 4u ) & 1u );
+    } );
+    if ( kitty::is_const0( tt ) )
+      continue;
+
+    std::vector<uint32_t> zero_lines, one_lines;
+    std::vector<std::pair<uint32_t, uint32_t>> duplicate_lines;
+    angel::extract_independent_vars( zero_lines, one_lines, duplicate_lines, tt );
+    REQUIRE( std::count( duplicate_lines.begin(), duplicate_lines.end(), std::make_pair( 0u, 6u ) ) == 1 );
+    REQUIRE( std::count( duplicate_lines.begin(), duplicate_lines.end(), std::make_pair( 1u, 9u ) ) == 1 );
+
+    angel::state_preparation_parameters ps;
+    ps.use_upperbound = false;
+    auto without_ps = ps;
+    without_ps.use_duplicate_lines = false;
+    angel::state_preparation_statistics st;
+    angel::qsp_deps<decltype( ntk ), decltype( no_deps ), decltype( none )> p( ntk, no_deps, none, ps, st ), p_without( ntk, no_deps, none, without_ps, st );
+    angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( none )> p_pattern( ntk, pattern, none, ps, st );
+
+    auto const ntk_dup = p( tt ), ntk_without = p_without( tt ), ntk_pattern = p_pattern( tt );
+    CHECK( prepares( ntk_dup, tt ) );
+    CHECK( prepares( ntk_without, tt ) );
+    CHECK( prepares( ntk_pattern, tt ) );
+    CHECK( ntk_dup.cnots_sqgs.first < ntk_without.cnots_sqgs.first );
+    CHECK( p.cost_model_tag() != p_without.cost_model_tag() );
+  }
+}
@@ -0,0 +1,110 @@
+#include <catch.hpp>
+
+#include <angel/reordering/annealing_reordering.hpp>
+#include <angel/reordering/dp_reordering.hpp>
+#include <angel/reordering/greedy_reordering.hpp>
+#include <kitty/kitty.hpp>
+
+#include "../test_functions.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using angel_test::toy_cost;
+
+TEST_CASE( "Annealing reordering respects the evaluation budget", "[annealing_reordering]" )
+{
+  angel::annealing_reordering_params ps;
+  ps.max_evaluations = 50u;
+  angel::annealing_reordering_stats st;
+  angel::annealing_reordering annealing( ps, st );
+
+  kitty::dynamic_truth_table tt{8u};
+  kitty::create_random( tt, 1700u );
+
+  std::vector<kitty::dynamic_truth_table> candidates;
+  auto best = std::numeric_limits<uint32_t>::max();
+  annealing.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    candidates.emplace_back( candidate );
+    best = std::min( best, toy_cost( candidate ) );
+    return toy_cost( candidate );
+  } );
+
+  CHECK( candidates.front() == tt );
+  CHECK( candidates.size() == 50u );
+  CHECK( st.num_functions == 1u );
+  CHECK( st.num_evaluations == candidates.size() );
+  CHECK( st.best_cost_sum == best );
+
+  /* the search is reproducible */
+  std::vector<kitty::dynamic_truth_table> again;
+  angel::annealing_reordering( ps ).foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    again.emplace_back( candidate );
+    return toy_cost( candidate );
+  } );
+  CHECK( again == candidates );
+}
+
+TEST_CASE( "Annealing reordering improves on greedy reordering", "[annealing_reordering]" )
+{
+  angel::annealing_reordering_params ps;
+  ps.max_evaluations = 300u;
+  angel::annealing_reordering annealing( ps );
+  angel::greedy_reordering greedy;
+
+  uint64_t total_greedy{0u}, total_annealing{0u}, total_optimum{0u};
+  for ( auto i = 0u; i < 10u; ++i )
+  {
+    kitty::dynamic_truth_table tt{6u};
+    kitty::create_random( tt, 1710u + i );
+
+    auto const best_of = [&]( auto const& strategy ) {
+      auto best = std::numeric_limits<uint32_t>::max();
+      strategy.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+        best = std::min( best, toy_cost( candidate ) );
+        return toy_cost( candidate );
+      } );
+      return best;
+    };
+
+    std::vector<uint32_t> order( 6u );
+    std::iota( order.begin(), order.end(), 0u );
+    auto optimum = std::numeric_limits<uint32_t>::max();
+    do
+    {
+      optimum = std::min( optimum, toy_cost( angel::dp_reordering::reorder( tt, order ) ) );
+    } while ( std::next_permutation( order.begin(), order.end() ) );
+
+    auto const annealing_cost = best_of( annealing );
+    CHECK( annealing_cost >= optimum );
+    total_annealing += annealing_cost;
+    total_greedy += best_of( greedy );
+    total_optimum += optimum;
+  }
+
+  CHECK( total_annealing <= total_greedy );
+  CHECK( total_annealing <= total_optimum + total_optimum / 10u );
+}
+
+TEST_CASE( "Annealing reordering respects the time budget", "[annealing_reordering]" )
+{
+  angel::annealing_reordering_params ps;
+  ps.max_evaluations = 1000000u;
+  ps.time_budget = 0.05;
+  angel::annealing_reordering_stats st;
+  angel::annealing_reordering annealing( ps, st );
+
+  kitty::dynamic_truth_table tt{10u};
+  kitty::create_random( tt, 1720u );
+  annealing.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    return toy_cost( candidate );
+  } );
+
+  CHECK( st.num_evaluations > 1u );
+  CHECK( st.num_evaluations < 1000u );
+}
@@ -0,0 +1,92 @@
+#include <catch.hpp>
+
+#include <angel/dependency_analysis/pattern_based_dependency_analysis.hpp>
+#include <angel/quantum_state_preparation/qsp_deps.hpp>
+#include <angel/reordering/dependency_guided_reordering.hpp>
+#include <angel/reordering/exhaustive_reordering.hpp>
+#include <angel/reordering/no_reordering.hpp>
+#include <kitty/kitty.hpp>
+#include <tweedledum/gates/mcmt_gate.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+#include "../test_functions.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+/* onset: x6 = x0 & x1, x5 = x2 ^ x3, and g( x0, ..., x4 ); the dependent variables are on top */
+kitty::dynamic_truth_table dependent_function( uint64_t seed )
+{
+  return angel_test::planted_function( 7u, 0x1fu, seed, []( uint32_t i, uint64_t m ) {
+    auto const x = [&]( uint32_t j ) { return ( m >> j ) & 1u; };
+    return i == 6u ? x( 0 ) & x( 1 ) : x( 2 ) ^ x( 3 );
+  } );
+}
+
+} // namespace
+
+TEST_CASE( "Dependency-guided reordering places dependent variables below their support", "[dependency_guided_reordering]" )
+{
+  angel::dependency_guided_reordering guided;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    auto const tt = dependent_function( 1600u + i );
+    if ( kitty::count_ones( tt ) < 2u )
+      continue;
+
+    auto const orders = guided.candidate_orders( tt );
+    REQUIRE( !orders.empty() );
+    CHECK( orders.size() <= 4u );
+
+    /* the onset may have further dependencies, but one candidate uses the constructed ones */
+    auto const below_support = [&]( std::vector<uint32_t> const& order ) {
+      auto const position = [&]( uint32_t v ) { return std::find( order.begin(), order.end(), v ) - order.begin(); };
+      return position( 6u ) > std::max( position( 0u ), position( 1u ) ) && position( 5u ) > std::max( position( 2u ), position( 3u ) );
+    };
+    CHECK( std::any_of( orders.begin(), orders.end(), below_support ) );
+  }
+}
+
+TEST_CASE( "Dependency-guided reordering evaluates few candidates", "[dependency_guided_reordering]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  angel::state_preparation_statistics st_none, st_guided, st_exhaustive;
+
+  angel::no_reordering none;
+  angel::dependency_guided_reordering guided;
+  angel::exhaustive_reordering exhaustive;
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( none )> p_none( ntk, pattern, none, ps, st_none );
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( guided )> p_guided( ntk, pattern, guided, ps, st_guided );
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( exhaustive )> p_exhaustive( ntk, pattern, exhaustive, ps, st_exhaustive );
+
+  uint64_t cost_none{0u}, cost_guided{0u};
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    auto const tt = dependent_function( 1650u + i );
+    if ( kitty::is_const0( tt ) )
+      continue;
+
+    auto const c_none = p_none( tt ).cnots_sqgs.first;
+    auto const c_guided = p_guided( tt ).cnots_sqgs.first;
+    CHECK( c_guided <= c_none );
+    cost_none += c_none;
+    cost_guided += c_guided;
+
+    /* the exhaustive search evaluates 5040 orders */
+    if ( i < 2u )
+    {
+      CHECK( p_exhaustive( tt ).cnots_sqgs.first == c_guided );
+    }
+  }
+
+  CHECK( cost_guided < cost_none );
+  CHECK( st_guided.num_candidates <= 5u * 8u );
+}
@@ -0,0 +1,114 @@
+#include <catch.hpp>
+
+#include <angel/dependency_analysis/pattern_based_dependency_analysis.hpp>
+#include <angel/quantum_state_preparation/qsp_deps.hpp>
+#include <angel/reordering/dp_reordering.hpp>
+#include <angel/reordering/no_reordering.hpp>
+#include <kitty/kitty.hpp>
+#include <tweedledum/gates/mcmt_gate.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+#include "../test_functions.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+
+/* onset: x3 = x0 & x1, x4 = x1 ^ x2, and g( x0, x1, x2 ) */
+kitty::dynamic_truth_table dependent_function( uint64_t seed )
+{
+  return angel_test::planted_function( 5u, 0x7u, seed, []( uint32_t i, uint64_t m ) {
+    auto const x = [&]( uint32_t j ) { return ( m >> j ) & 1u; };
+    return i == 3u ? x( 0 ) & x( 1 ) : x( 1 ) ^ x( 2 );
+  } );
+}
+
+} // namespace
+
+TEST_CASE( "DP reordering finds the cheapest order of its cost model", "[dp_reordering]" )
+{
+  angel::dp_reordering dp;
+  for ( auto i = 0u; i < 16u; ++i )
+  {
+    kitty::dynamic_truth_table tt{5u};
+    if ( i % 2u )
+      tt = dependent_function( 900u + i );
+    else
+      kitty::create_random( tt, 900u + i );
+    if ( kitty::is_const0( tt ) )
+      continue;
+
+    std::vector<uint32_t> order( 5u );
+    std::iota( order.begin(), order.end(), 0u );
+    auto best = std::numeric_limits<uint32_t>::max();
+    do
+    {
+      best = std::min( best, dp.estimated_cost( tt, order ) );
+    } while ( std::next_permutation( order.begin(), order.end() ) );
+
+    CHECK( dp.estimated_cost( tt, dp.best_order( tt ) ) == best );
+  }
+}
+
+TEST_CASE( "DP reordering places fanins of dependencies on top", "[dp_reordering]" )
+{
+  tweedledum::netlist<tweedledum::mcmt_gate> ntk;
+  angel::pattern_deps_analysis_params pattern_ps;
+  angel::pattern_deps_analysis_stats pattern_st;
+  angel::pattern_deps_analysis pattern( pattern_ps, pattern_st );
+  angel::state_preparation_parameters ps;
+  ps.use_upperbound = false;
+  angel::state_preparation_statistics st;
+
+  angel::no_reordering none;
+  angel::dp_reordering dp;
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( none )> p_none( ntk, pattern, none, ps, st );
+  angel::qsp_deps<decltype( ntk ), decltype( pattern ), decltype( dp )> p_dp( ntk, pattern, dp, ps, st );
+
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    auto const tt = dependent_function( 950u + i );
+    if ( kitty::is_const0( tt ) )
+      continue;
+
+    /* x3 and x4 are below their fanins */
+    auto const order = dp.best_order( tt );
+    auto const position = [&]( uint32_t v ) { return std::find( order.begin(), order.end(), v ) - order.begin(); };
+    CHECK( position( 3u ) > std::max( position( 0u ), position( 1u ) ) );
+    CHECK( position( 4u ) > std::max( position( 1u ), position( 2u ) ) );
+
+    CHECK( p_dp( tt ).cnots_sqgs.first <= p_none( tt ).cnots_sqgs.first );
+  }
+}
+
+TEST_CASE( "DP reordering moves variables to the positions of the order", "[dp_reordering]" )
+{
+  std::vector<uint32_t> const order{2u, 0u, 3u, 1u};
+  for ( auto p = 0u; p < order.size(); ++p )
+  {
+    kitty::dynamic_truth_table var{4u}, expected{4u};
+    kitty::create_nth_var( var, order[p] );
+    kitty::create_nth_var( expected, 3u - p );
+    CHECK( angel::dp_reordering::reorder( var, order ) == expected );
+  }
+}
+
+TEST_CASE( "DP reordering falls back to greedy reordering for large functions", "[dp_reordering]" )
+{
+  angel::dp_reordering_params ps;
+  ps.max_exact_vars = 4u;
+  angel::dp_reordering dp( ps );
+  angel::greedy_reordering greedy;
+
+  kitty::dynamic_truth_table tt{6u};
+  kitty::create_random( tt, 990u );
+  auto const cost = []( kitty::dynamic_truth_table const& candidate ) { return static_cast<uint32_t>( kitty::count_ones( candidate & ( candidate >> 1u ) ) ); };
+
+  std::vector<kitty::dynamic_truth_table> from_dp, from_greedy;
+  dp.foreach_reordering( tt, [&]( auto const& candidate ) { from_dp.push_back( candidate ); return cost( candidate ); } );
+  greedy.foreach_reordering( tt, [&]( auto const& candidate ) { from_greedy.push_back( candidate ); return cost( candidate ); } );
+  CHECK( from_dp == from_greedy );
+}
@@ -0,0 +1,101 @@
+#include <catch.hpp>
+
+#include <angel/reordering/dp_reordering.hpp>
+#include <angel/reordering/exhaustive_reordering.hpp>
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <vector>
+
+namespace
+{
+
+std::set<kitty::dynamic_truth_table> all_reorderings( kitty::dynamic_truth_table const& tt )
+{
+  std::set<kitty::dynamic_truth_table> result;
+  std::vector<uint32_t> order( tt.num_vars() );
+  std::iota( order.begin(), order.end(), 0u );
+  do
+  {
+    result.insert( angel::dp_reordering::reorder( tt, order ) );
+  } while ( std::next_permutation( order.begin(), order.end() ) );
+  return result;
+}
+
+std::vector<kitty::dynamic_truth_table> exhaustive_candidates( kitty::dynamic_truth_table const& tt )
+{
+  std::vector<kitty::dynamic_truth_table> candidates;
+  angel::exhaustive_reordering{}.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    candidates.push_back( candidate );
+    return 0u;
+  } );
+  return candidates;
+}
+
+} // namespace
+
+TEST_CASE( "Exhaustive reordering enumerates all orders by adjacent swaps", "[exhaustive_reordering]" )
+{
+  for ( auto n = 1u; n <= 6u; ++n )
+  {
+    /* a function without symmetric variables */
+    kitty::dynamic_truth_table tt( n );
+    for ( auto seed = 1000u + n;; ++seed )
+    {
+      kitty::create_random( tt, seed );
+      auto symmetric = false;
+      for ( auto i = 0u; i < n; ++i )
+        for ( auto j = i + 1u; j < n; ++j )
+          symmetric = symmetric || kitty::is_symmetric_in( tt, i, j );
+      if ( !symmetric )
+        break;
+    }
+
+    auto const candidates = exhaustive_candidates( tt );
+    CHECK( candidates.front() == tt );
+
+    auto factorial = 1u;
+    for ( auto i = 2u; i <= n; ++i )
+      factorial *= i;
+    CHECK( candidates.size() == factorial );
+
+    /* consecutive candidates differ by one adjacent swap */
+    for ( auto i = 1u; i < candidates.size(); ++i )
+    {
+      auto found = false;
+      for ( auto v = 0u; v + 1u < n && !found; ++v )
+      {
+        found = kitty::swap_adjacent( candidates[i - 1u], v ) == candidates[i];
+      }
+      CHECK( found );
+    }
+
+    CHECK( std::set<kitty::dynamic_truth_table>( candidates.begin(), candidates.end() ) == all_reorderings( tt ) );
+  }
+}
+
+TEST_CASE( "Exhaustive reordering skips orders of symmetric variables", "[exhaustive_reordering]" )
+{
+  /* majority of x0, x1, x2 and x3 ^ x4: two symmetry classes {0, 1, 2} and {3, 4} */
+  kitty::dynamic_truth_table a{5u}, b{5u}, c{5u}, d{5u}, e{5u};
+  kitty::create_nth_var( a, 0u );
+  kitty::create_nth_var( b, 1u );
+  kitty::create_nth_var( c, 2u );
+  kitty::create_nth_var( d, 3u );
+  kitty::create_nth_var( e, 4u );
+  auto const tt = kitty::ternary_majority( a, b, c ) & ( d ^ e );
+
+  auto const candidates = exhaustive_candidates( tt );
+  std::set<kitty::dynamic_truth_table> const distinct( candidates.begin(), candidates.end() );
+  CHECK( candidates.size() == 120u / ( 6u * 2u ) );
+  CHECK( distinct.size() == candidates.size() );
+  CHECK( distinct == all_reorderings( tt ) );
+
+  angel::exhaustive_reordering_stats st;
+  angel::exhaustive_reordering( st ).foreach_reordering( tt, []( kitty::dynamic_truth_table const& ) { return 0u; } );
+  CHECK( st.num_functions == 1u );
+  CHECK( st.num_orders == candidates.size() );
+  CHECK( st.num_skipped == 120u - candidates.size() );
+}
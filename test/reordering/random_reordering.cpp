@@ -0,0 +1,133 @@
+#include <catch.hpp>
+
+#include <angel/reordering/random_reordering.hpp>
+#include <kitty/kitty.hpp>
+
+#include "../test_functions.hpp"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+using angel_test::toy_cost;
+
+TEST_CASE( "Random reordering samples every order once", "[random_reordering]" )
+{
+  kitty::dynamic_truth_table tt{4u};
+  kitty::create_random( tt, 1501u );
+
+  angel::random_reordering_stats st;
+  angel::random_reordering random( 42u, 200u, st );
+
+  std::vector<kitty::dynamic_truth_table> candidates;
+  random.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    candidates.emplace_back( candidate );
+    return toy_cost( candidate );
+  } );
+
+  /* 200 samples of 24 orders */
+  CHECK( candidates.front() == tt );
+  CHECK( candidates.size() <= 24u );
+  CHECK( st.num_samples == 201u );
+  CHECK( st.num_duplicates == 201u - candidates.size() );
+
+  std::set<std::vector<uint32_t>> orders;
+  for ( auto i = 0u; i < 200u; ++i )
+  {
+    auto const order = random.order( 4u, i );
+    CHECK( std::is_permutation( order.begin(), order.end(), std::vector<uint32_t>{0u, 1u, 2u, 3u}.begin() ) );
+    orders.insert( order );
+  }
+  CHECK( orders.size() == 24u );
+}
+
+TEST_CASE( "Random reordering is reproducible and independent of the batch size", "[random_reordering]" )
+{
+  kitty::dynamic_truth_table tt{6u};
+  kitty::create_random( tt, 1502u );
+
+  angel::random_reordering random( 0xcafeaffe, 30u );
+  std::vector<kitty::dynamic_truth_table> sequential, batched;
+  random.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    sequential.emplace_back( candidate );
+    return 0u;
+  } );
+  random.foreach_reordering_batch( tt, 7u, [&]( std::vector<kitty::dynamic_truth_table> const& batch ) {
+    CHECK( batch.size() <= 7u );
+    batched.insert( batched.end(), batch.begin(), batch.end() );
+    return std::vector<uint32_t>( batch.size(), 0u );
+  } );
+  CHECK( sequential == batched );
+
+  std::vector<kitty::dynamic_truth_table> again;
+  angel::random_reordering( 0xcafeaffe, 30u ).foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    again.emplace_back( candidate );
+    return 0u;
+  } );
+  CHECK( sequential == again );
+
+  /* a prefix of the samples does not depend on their number */
+  angel::random_reordering shorter( 0xcafeaffe, 10u );
+  for ( auto i = 0u; i < 10u; ++i )
+  {
+    CHECK( shorter.order( 6u, i ) == random.order( 6u, i ) );
+  }
+}
+
+TEST_CASE( "Random reordering records the best cost per number of samples", "[random_reordering]" )
+{
+  angel::random_reordering_stats st;
+  angel::random_reordering random( 7u, 100u, st );
+
+  uint64_t total_best{0u};
+  for ( auto i = 0u; i < 5u; ++i )
+  {
+    kitty::dynamic_truth_table tt{7u};
+    kitty::create_random( tt, 1510u + i );
+
+    auto best = std::numeric_limits<uint32_t>::max();
+    random.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+      best = std::min( best, toy_cost( candidate ) );
+      return toy_cost( candidate );
+    } );
+    total_best += best;
+  }
+
+  CHECK( st.num_functions == 5u );
+  CHECK( st.checkpoints == std::vector<uint64_t>{1u, 2u, 4u, 8u, 16u, 32u, 64u, 101u} );
+  REQUIRE( st.best_cost_sum.size() == st.checkpoints.size() );
+  CHECK( std::is_sorted( st.best_cost_sum.rbegin(), st.best_cost_sum.rend() ) );
+  CHECK( st.best_cost_sum.back() == total_best );
+}
+
+TEST_CASE( "Random reordering handles many samples", "[random_reordering]" )
+{
+  kitty::dynamic_truth_table tt{14u};
+  kitty::create_random( tt, 1520u );
+
+  angel::random_reordering_stats st;
+  angel::random_reordering random( 1u, 5000u, st );
+  uint64_t num_candidates{0u};
+  random.foreach_reordering_batch( tt, 256u, [&]( std::vector<kitty::dynamic_truth_table> const& batch ) {
+    num_candidates += batch.size();
+    return std::vector<uint32_t>( batch.size(), 0u );
+  } );
+  CHECK( num_candidates + st.num_duplicates == 5001u );
+}
+
+TEST_CASE( "Random reordering passes the input order of symmetric functions", "[random_reordering]" )
+{
+  /* majority of five variables: every order leaves it unchanged */
+  kitty::dynamic_truth_table tt( 5u );
+  kitty::create_majority( tt );
+
+  for ( auto const num_reordering : {0u, 20u} )
+  {
+    std::vector<kitty::dynamic_truth_table> candidates;
+    angel::random_reordering( 3u, num_reordering ).foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+      candidates.emplace_back( candidate );
+      return toy_cost( candidate );
+    } );
+    CHECK( candidates == std::vector<kitty::dynamic_truth_table>{tt} );
+  }
+}
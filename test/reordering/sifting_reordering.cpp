@@ -0,0 +1,67 @@
+#include <catch.hpp>
+
+#include <angel/reordering/dp_reordering.hpp>
+#include <angel/reordering/sifting_reordering.hpp>
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <vector>
+
+TEST_CASE( "Sifting reordering sorts a variable order by inversions", "[sifting_reordering]" )
+{
+  uint32_t const n = 6u;
+
+  /* a function without symmetric variables identifies each order by its truth table */
+  kitty::dynamic_truth_table tt{n};
+  kitty::create_random( tt, 1100u );
+  std::map<kitty::dynamic_truth_table, std::vector<uint32_t>> orders;
+  std::vector<uint32_t> order( n );
+  std::iota( order.begin(), order.end(), 0u );
+  do
+  {
+    orders.emplace( angel::dp_reordering::reorder( tt, order ), order );
+  } while ( std::next_permutation( order.begin(), order.end() ) );
+  REQUIRE( orders.size() == 720u );
+
+  /* number of pairs of variables out of the order 3, 0, 5, 1, 4, 2 (top to bottom) */
+  std::vector<uint32_t> const target{3u, 0u, 5u, 1u, 4u, 2u};
+  auto const inversions = [&]( kitty::dynamic_truth_table const& candidate ) {
+    auto const& o = orders.at( candidate );
+    auto const rank = [&]( uint32_t v ) { return std::find( target.begin(), target.end(), v ) - target.begin(); };
+    auto count = 0u;
+    for ( auto i = 0u; i < n; ++i )
+      for ( auto j = i + 1u; j < n; ++j )
+        count += rank( o[i] ) > rank( o[j] ) ? 1u : 0u;
+    return count;
+  };
+
+  angel::sifting_reordering sifting;
+  auto evaluations = 0u;
+  auto best = std::numeric_limits<uint32_t>::max();
+  sifting.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    ++evaluations;
+    best = std::min( best, inversions( candidate ) );
+    return inversions( candidate );
+  } );
+
+  /* one round moves every variable to its best position, like an insertion sort */
+  CHECK( best == 0u );
+  CHECK( evaluations == 1u + n * ( n - 1u ) );
+}
+
+TEST_CASE( "Sifting reordering stops after a round without improvement", "[sifting_reordering]" )
+{
+  kitty::dynamic_truth_table tt{4u};
+  kitty::create_random( tt, 1101u );
+
+  angel::sifting_reordering_params ps;
+  ps.max_rounds = 3u;
+  angel::sifting_reordering sifting( ps );
+
+  /* every order costs the same, so no round improves */
+  auto evaluations = 0u;
+  sifting.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& ) { ++evaluations; return 5u; }, 5u );
+  CHECK( evaluations == 1u + 4u * 3u );
+}
@@ -0,0 +1,100 @@
+#include <catch.hpp>
+
+#include <angel/reordering/greedy_reordering.hpp>
+#include <angel/reordering/random_reordering.hpp>
+#include <angel/reordering/symmetry_classes.hpp>
+#include <angel/utils/permutation.hpp>
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <vector>
+
+namespace
+{
+
+/* majority of x0, x2 and x4 and x1 ^ x3 ^ x5: classes {0, 2, 4}, {1, 3, 5} */
+kitty::dynamic_truth_table partially_symmetric_function()
+{
+  std::vector<kitty::dynamic_truth_table> x( 6u, kitty::dynamic_truth_table( 6u ) );
+  for ( auto i = 0u; i < 6u; ++i )
+  {
+    kitty::create_nth_var( x[i], i );
+  }
+  return kitty::ternary_majority( x[0], x[2], x[4] ) & ( x[1] ^ x[3] ^ x[5] );
+}
+
+} // namespace
+
+TEST_CASE( "Symmetry classes of a partially symmetric function", "[symmetry_classes]" )
+{
+  auto const tt = partially_symmetric_function();
+  angel::symmetry_classes const classes( tt );
+
+  CHECK( classes.num_classes() == 2u );
+  CHECK( !classes.is_trivial() );
+  CHECK( classes.representative( 4u ) == 0u );
+  CHECK( classes.representative( 5u ) == 1u );
+  CHECK( classes.are_symmetric( 2u, 4u ) );
+  CHECK( !classes.are_symmetric( 0u, 1u ) );
+  CHECK( classes.num_orders() == 20.0 );
+
+  /* canonical orders give the same truth table and represent every truth table once */
+  std::vector<uint32_t> perm( 6u );
+  std::iota( perm.begin(), perm.end(), 0u );
+  std::set<kitty::dynamic_truth_table> all, canonical;
+  do
+  {
+    auto const reordered = angel::permute_variables( tt, perm );
+    auto const representative = classes.canonical( perm );
+    CHECK( classes.is_canonical( representative ) );
+    CHECK( classes.is_canonical( perm ) == ( representative == perm ) );
+    CHECK( angel::permute_variables( tt, representative ) == reordered );
+
+    all.insert( reordered );
+    if ( classes.is_canonical( perm ) )
+    {
+      CHECK( canonical.insert( reordered ).second );
+    }
+  } while ( std::next_permutation( perm.begin(), perm.end() ) );
+  CHECK( canonical == all );
+  CHECK( canonical.size() == 20u );
+}
+
+TEST_CASE( "Symmetry classes of a function without symmetric variables", "[symmetry_classes]" )
+{
+  kitty::dynamic_truth_table tt{3u};
+  kitty::create_from_hex_string( tt, "d8" ); /* x0 ? x1 : x2 */
+  angel::symmetry_classes const classes( tt );
+  CHECK( classes.is_trivial() );
+  CHECK( classes.num_orders() == 6.0 );
+  CHECK( classes.canonical( {2u, 0u, 1u} ) == std::vector<uint32_t>{2u, 0u, 1u} );
+}
+
+TEST_CASE( "Reordering strategies skip orders of symmetric variables", "[symmetry_classes]" )
+{
+  auto const tt = partially_symmetric_function();
+
+  angel::greedy_reordering_stats greedy_st;
+  angel::greedy_reordering greedy( greedy_st );
+  uint64_t num_greedy{0u};
+  greedy.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    ++num_greedy;
+    return static_cast<uint32_t>( kitty::count_ones( candidate & ( candidate >> 1u ) ) );
+  } );
+  CHECK( greedy_st.num_functions == 1u );
+  CHECK( greedy_st.num_orders == num_greedy );
+
+  angel::random_reordering_stats random_st;
+  angel::random_reordering random( 3u, 500u, random_st );
+  std::vector<kitty::dynamic_truth_table> candidates;
+  random.foreach_reordering( tt, [&]( kitty::dynamic_truth_table const& candidate ) {
+    candidates.emplace_back( candidate );
+    return 0u;
+  } );
+  CHECK( candidates.size() <= 20u );
+  CHECK( std::set<kitty::dynamic_truth_table>( candidates.begin(), candidates.end() ).size() == candidates.size() );
+  CHECK( random_st.num_symmetric > 0u );
+  CHECK( random_st.num_duplicates == 501u - candidates.size() );
+}
@@ -0,0 +1,72 @@
+/*!
+  \file test_functions.hpp
+
+  \brief Functions and cost models shared by the tests
+*/
+
+#pragma once
+
+#include <kitty/kitty.hpp>
+
+#include <cstdint>
+
+namespace angel_test
+{
+
+/*! \brief Onset of `g` over the free variables in which every other variable is planted.
+ *
+ * Bit `j` of the input of `g` is the `j`-th free variable (bit in
+ * `free_vars`), and every other variable `x_i` equals `define( i, m )` in
+ * every minterm `m` of the onset.
+ */
+template<typename Define>
+kitty::dynamic_truth_table planted_function( uint32_t num_vars, uint64_t free_vars, kitty::dynamic_truth_table const& g, Define&& define )
+{
+  kitty::dynamic_truth_table tt( num_vars );
+  for ( uint64_t m = 0u; m < tt.num_bits(); ++m )
+  {
+    uint64_t input{0u};
+    auto valid = true;
+    for ( auto i = 0u, j = 0u; i < num_vars && valid; ++i )
+    {
+      if ( ( free_vars >> i ) & 1u )
+      {
+        input |= ( ( m >> i ) & 1u ) << j++;
+      }
+      else
+      {
+        valid = ( ( m >> i ) & 1u ) == static_cast<uint64_t>( define( i, m ) );
+      }
+    }
+    if ( valid && kitty::get_bit( g, input ) )
+    {
+      kitty::set_bit( tt, m );
+    }
+  }
+  return tt;
+}
+
+/*! \brief As above for a random `g` created from `seed`. */
+template<typename Define>
+kitty::dynamic_truth_table planted_function( uint32_t num_vars, uint64_t free_vars, uint64_t seed, Define&& define )
+{
+  kitty::dynamic_truth_table g( __builtin_popcountll( free_vars ) );
+  kitty::create_random( g, seed );
+  return planted_function( num_vars, free_vars, g, define );
+}
+
+/*! \brief As above for the constant-1 `g`. */
+template<typename Define>
+kitty::dynamic_truth_table planted_function( uint32_t num_vars, uint64_t free_vars, Define&& define )
+{
+  kitty::dynamic_truth_table g( __builtin_popcountll( free_vars ) );
+  return planted_function( num_vars, free_vars, ~g, define );
+}
+
+/*! \brief Toy reordering cost: number of minterms with both the smallest and the next variable set. */
+inline uint32_t toy_cost( kitty::dynamic_truth_table const& tt )
+{
+  return static_cast<uint32_t>( kitty::count_ones( tt & ( tt >> 1u ) ) );
+}
+
+} // namespace angel_test
@@ -0,0 +1,29 @@
+#include <catch.hpp>
+
+#include <angel/utils/ones_pyramid.hpp>
+#include <kitty/kitty.hpp>
+
+TEST_CASE( "Ones pyramid counts the ones of all aligned segments", "[ones_pyramid]" )
+{
+  angel::ones_pyramid pyramid;
+  for ( auto n = 0u; n <= 10u; ++n )
+  {
+    kitty::dynamic_truth_table tt( n );
+    kitty::create_random( tt, 500u + n );
+    pyramid.build( tt );
+
+    for ( auto level = 0u; level <= n; ++level )
+    {
+      /* the segments of a level are the cofactors w.r.t. the variables level, ..., n - 1 */
+      for ( auto k = 0u; k < ( 1u << ( n - level ) ); ++k )
+      {
+        auto cof = tt;
+        for ( auto v = level; v < n; ++v )
+        {
+          cof = ( ( k >> ( v - level ) ) & 1u ) ? kitty::cofactor1( cof, v ) : kitty::cofactor0( cof, v );
+        }
+        CHECK( pyramid.count( uint64_t( k ) << level, level ) == kitty::count_ones( kitty::shrink_to( cof, level ) ) );
+      }
+    }
+  }
+}
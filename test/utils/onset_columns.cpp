@@ -0,0 +1,142 @@
+#include <catch.hpp>
+
+#include <angel/utils/helper_functions.hpp>
+#include <angel/utils/onset_columns.hpp>
+#include <kitty/kitty.hpp>
+
+#include "../test_functions.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/* onset: x1 = x0, x3 = !x0, x4 = 1, x5 = 0, x6 = x2 ^ x7, and g( x0, x2, x7 ) given as 8 bits */
+kitty::dynamic_truth_table duplicate_function( uint32_t g )
+{
+  kitty::dynamic_truth_table g_tt( 3 );
+  g_tt._bits[0] = g;
+  return angel_test::planted_function( 8u, 0x85u, g_tt, []( uint32_t i, uint64_t m ) {
+    auto const x = [&]( uint32_t j ) { return ( m >> j ) & 1u; };
+    switch ( i )
+    {
+    case 1u:
+      return x( 0 );
+    case 3u:
+      return 1u - x( 0 );
+    case 4u:
+      return uint64_t( 1u );
+    case 5u:
+      return uint64_t( 0u );
+    default:
+      return x( 2 ) ^ x( 7 );
+    }
+  } );
+}
+
+} // namespace
+
+TEST_CASE( "Onset columns hold the variables of the onset minterms", "[onset_columns]" )
+{
+  for ( auto n : {3u, 7u, 9u} )
+  {
+    kitty::dynamic_truth_table tt( n );
+    kitty::create_random( tt, 60u + n );
+    auto const minterms = kitty::get_minterms( tt );
+
+    std::vector<uint64_t> columns;
+    uint64_t last_mask{0u};
+    auto const num_words = angel::pack_onset_columns( tt, columns, last_mask );
+    CHECK( num_words == std::max<uint32_t>( 1u, ( minterms.size() + 63u ) / 64u ) );
+    CHECK( __builtin_popcountll( last_mask ) == ( minterms.size() % 64u ? minterms.size() % 64u : 64u ) );
+
+    for ( auto j = 0u; j < minterms.size(); ++j )
+    {
+      for ( auto i = 0u; i < n; ++i )
+      {
+        CHECK( ( ( columns[i * num_words + j / 64u] >> ( j % 64u ) ) & 1u ) == ( ( minterms[j] >> i ) & 1u ) );
+      }
+    }
+  }
+}
+
+TEST_CASE( "Onset columns are classified into equal and complemented columns", "[onset_columns]" )
+{
+  /* majority and not-all-equal: x0, x2, x6, and x7 are pairwise distinct */
+  for ( auto g : {0xe8u, 0x7eu} )
+  {
+    auto const tt = duplicate_function( g );
+
+    std::vector<uint64_t> columns;
+    uint64_t last_mask{0u};
+    auto const num_words = angel::pack_onset_columns( tt, columns, last_mask );
+    auto const classes = angel::classify_columns( columns, 8u, num_words, last_mask );
+
+    CHECK( classes.constant[4u] );
+    CHECK( classes.constant[5u] );
+    CHECK( classes.polarity[4u] == 1u );
+    CHECK( classes.polarity[5u] == 0u );
+    CHECK( classes.representative[0u] == 3u );
+    CHECK( classes.representative[1u] == 3u );
+    CHECK( classes.literal( 0u ) == 7u );
+    CHECK( classes.literal( 1u ) == 7u );
+    CHECK( classes.literal( 3u ) == 6u );
+
+    /* classes agree with comparing all pairs of columns */
+    for ( auto i = 0u; i < 8u; ++i )
+    {
+      for ( auto j = 0u; j < 8u; ++j )
+      {
+        auto equal = true, complement = true;
+        for ( auto w = 0u; w < num_words; ++w )
+        {
+          auto const mask = w + 1u == num_words ? last_mask : ~uint64_t( 0u );
+          equal = equal && ( ( columns[i * num_words + w] ^ columns[j * num_words + w] ) & mask ) == 0u;
+          complement = complement && ( ( ~columns[i * num_words + w] ^ columns[j * num_words + w] ) & mask ) == 0u;
+        }
+        CHECK( ( classes.representative[i] == classes.representative[j] ) == ( equal || complement ) );
+      }
+    }
+  }
+}
+
+TEST_CASE( "Independent variables include duplicate lines", "[onset_columns]" )
+{
+  auto const tt = duplicate_function( 0xe8u );
+
+  std::vector<uint32_t> zero_lines, one_lines;
+  std::vector<std::pair<uint32_t, uint32_t>> duplicate_lines;
+  angel::extract_independent_vars( zero_lines, one_lines, duplicate_lines, tt );
+  CHECK( zero_lines == std::vector<uint32_t>{5u} );
+  CHECK( one_lines == std::vector<uint32_t>{4u} );
+  CHECK( duplicate_lines == std::vector<std::pair<uint32_t, uint32_t>>{{1u, 7u}, {0u, 7u}} );
+
+  std::vector<uint32_t> zero_lines_only, one_lines_only;
+  angel::extract_independent_vars( zero_lines_only, one_lines_only, tt );
+  CHECK( zero_lines_only == zero_lines );
+  CHECK( one_lines_only == one_lines );
+}
+
+TEST_CASE( "Onset patterns are matched with their costs", "[onset_columns]" )
+{
+  /* x7 = x0 & x2 in the onset */
+  angel::onset_pattern_matcher matcher( duplicate_function( 0x87u ) );
+  auto const fanins = []( std::vector<uint32_t> const& vars ) {
+    uint64_t mask{0u};
+    for ( auto const& v : vars )
+      mask |= uint64_t( 1u ) << v;
+    return mask;
+  };
+
+  CHECK( matcher.is_constant( 4u ) );
+  CHECK( matcher.is_constant( 5u ) );
+  CHECK( !matcher.is_constant( 0u ) );
+  CHECK( matcher.pattern_cost( 1u, fanins( {0u} ) ) == 1u );
+  CHECK( matcher.pattern_cost( 3u, fanins( {0u} ) ) == 1u );
+  CHECK( matcher.pattern_cost( 6u, fanins( {2u, 7u} ) ) == 2u );
+  CHECK( matcher.pattern_cost( 7u, fanins( {0u, 2u} ) ) == 4u );
+  CHECK( matcher.pattern_cost( 7u, fanins( {2u, 3u} ) ) == 4u );
+  CHECK( !matcher.pattern_cost( 0u, fanins( {2u} ) ) );
+  CHECK( !matcher.pattern_cost( 2u, fanins( {0u, 7u} ) ) );
+}
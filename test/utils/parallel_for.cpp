@@ -0,0 +1,76 @@
+#include <catch.hpp>
+
+#include <angel/utils/parallel_for.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE( "parallel_for visits every index exactly once", "[parallel_for]" )
+{
+  for ( auto const num_threads : {1u, 3u, 8u} )
+  {
+    std::vector<std::atomic<uint32_t>> visits( 1000u );
+    std::atomic<uint32_t> max_worker{0u};
+    angel::parallel_for( visits.size(), num_threads, 7u, [&]( uint32_t worker, uint64_t index ) {
+      /* Catch assertions are not thread-safe, only record here */
+      ++visits[index];
+      auto current = max_worker.load();
+      while ( worker > current && !max_worker.compare_exchange_weak( current, worker ) )
+      {
+      }
+    } );
+
+    CHECK( max_worker < num_threads );
+
+    for ( auto const& v : visits )
+    {
+      CHECK( v == 1u );
+    }
+  }
+}
+
+TEST_CASE( "thread_pool runs many loops on the same threads", "[parallel_for]" )
+{
+  for ( auto const num_threads : {1u, 3u, 8u} )
+  {
+    angel::thread_pool pool( num_threads );
+    CHECK( pool.num_threads() == num_threads );
+
+    for ( auto const num_items : {0u, 1u, 5u, 1000u} )
+    {
+      std::vector<std::atomic<uint32_t>> visits( num_items );
+      std::atomic<uint32_t> max_worker{0u};
+      pool.parallel_for( visits.size(), 3u, [&]( uint32_t worker, uint64_t index ) {
+        ++visits[index];
+        auto current = max_worker.load();
+        while ( worker > current && !max_worker.compare_exchange_weak( current, worker ) )
+        {
+        }
+      } );
+
+      CHECK( max_worker < num_threads );
+      for ( auto const& v : visits )
+      {
+        CHECK( v == 1u );
+      }
+    }
+  }
+}
+
+TEST_CASE( "thread_pool rethrows the exception of a loop", "[parallel_for]" )
+{
+  angel::thread_pool pool( 4u );
+  CHECK_THROWS_AS( pool.parallel_for( 100u, 1u, [&]( uint32_t, uint64_t index ) {
+                     if ( index == 42u )
+                     {
+                       throw std::runtime_error( "failed" );
+                     }
+                   } ),
+                   std::runtime_error );
+
+  /* the pool is still usable */
+  std::atomic<uint64_t> sum{0u};
+  pool.parallel_for( 100u, 1u, [&]( uint32_t, uint64_t index ) { sum += index; } );
+  CHECK( sum == 4950u );
+}
@@ -0,0 +1,99 @@
+#include <catch.hpp>
+
+#include <angel/utils/helper_functions.hpp>
+#include <angel/utils/permutation.hpp>
+#include <kitty/kitty.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/* variable i of tt becomes variable perm[i], bit by bit */
+kitty::dynamic_truth_table permute_bitwise( kitty::dynamic_truth_table const& tt, std::vector<uint32_t> const& perm )
+{
+  auto result = tt.construct();
+  for ( uint64_t x = 0u; x < tt.num_bits(); ++x )
+  {
+    uint64_t y{0u};
+    for ( auto i = 0u; i < perm.size(); ++i )
+    {
+      y |= ( ( x >> i ) & 1u ) << perm[i];
+    }
+    if ( kitty::get_bit( tt, x ) )
+    {
+      kitty::set_bit( result, y );
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE( "Permute variables of truth tables in one pass", "[permutation]" )
+{
+  std::mt19937 random_engine( 1800u );
+  for ( auto n = 1u; n <= 11u; ++n )
+  {
+    for ( auto i = 0u; i < 20u; ++i )
+    {
+      kitty::dynamic_truth_table tt( n );
+      kitty::create_random( tt, 1800u + 100u * n + i );
+
+      std::vector<uint32_t> perm( n );
+      std::iota( perm.begin(), perm.end(), 0u );
+      std::shuffle( perm.begin(), perm.end(), random_engine );
+      CHECK( angel::permute_variables( tt, perm ) == permute_bitwise( tt, perm ) );
+    }
+  }
+}
+
+TEST_CASE( "Permute variables by transpositions", "[permutation]" )
+{
+  for ( auto n : {3u, 6u, 8u} )
+  {
+    kitty::dynamic_truth_table tt( n );
+    kitty::create_random( tt, 1850u + n );
+    for ( auto i = 0u; i < n; ++i )
+    {
+      for ( auto j = i + 1u; j < n; ++j )
+      {
+        std::vector<uint32_t> perm( n );
+        std::iota( perm.begin(), perm.end(), 0u );
+        std::swap( perm[i], perm[j] );
+        CHECK( angel::permute_variables( tt, perm ) == kitty::swap( tt, i, j ) );
+      }
+    }
+  }
+}
+
+TEST_CASE( "Reordering on truth tables applies its transpositions", "[permutation]" )
+{
+  std::mt19937 random_engine( 1860u );
+  for ( auto n = 2u; n <= 9u; ++n )
+  {
+    kitty::dynamic_truth_table tt( n );
+    kitty::create_random( tt, 1860u + n );
+
+    std::vector<uint32_t> orders( n );
+    std::iota( orders.begin(), orders.end(), 0u );
+    std::shuffle( orders.begin(), orders.end(), random_engine );
+
+    /* chain of swaps */
+    auto expected = tt;
+    for ( auto i = 0u; i < n; ++i )
+    {
+      if ( orders[n - 1u - i] > i )
+      {
+        kitty::swap_inplace( expected, i, orders[n - 1u - i] );
+      }
+    }
+
+    auto reordered = tt;
+    angel::reordering_on_tt_inplace( reordered, orders );
+    CHECK( reordered == expected );
+  }
+}